@@ -0,0 +1,189 @@
+// data URI(base64) 디코딩 속도를 예전 스칼라 디코더와 비교한다.
+// 결과가 같은지도 함께 확인한다(경계 길이, '=' 패딩, 중간의 잘못된 문자 포함).
+//
+// 사용법: ./base64_bench [입력 크기(MB)] [반복 횟수]
+
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+#include "../../glTF/tiny_gltf.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <vector>
+
+// tiny_gltf.h가 원래 쓰던 디코더(비교 기준).
+static const std::string legacy_chars =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+    "abcdefghijklmnopqrstuvwxyz"
+    "0123456789+/";
+
+static inline bool legacy_is_base64(unsigned char c)
+{
+  return (isalnum(c) || (c == '+') || (c == '/'));
+}
+
+std::string legacy_decode(std::string const &encoded_string)
+{
+  int in_len = static_cast<int>(encoded_string.size());
+  int i = 0;
+  int j = 0;
+  int in_ = 0;
+  unsigned char char_array_4[4], char_array_3[3];
+  std::string ret;
+
+  while (in_len-- && (encoded_string[in_] != '=') &&
+         legacy_is_base64(encoded_string[in_]))
+  {
+    char_array_4[i++] = encoded_string[in_];
+    in_++;
+    if (i == 4)
+    {
+      for (i = 0; i < 4; i++)
+        char_array_4[i] = static_cast<unsigned char>(legacy_chars.find(char_array_4[i]));
+
+      char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
+      char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
+      char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+
+      for (i = 0; (i < 3); i++)
+        ret += char_array_3[i];
+      i = 0;
+    }
+  }
+
+  if (i)
+  {
+    for (j = i; j < 4; j++)
+      char_array_4[j] = 0;
+
+    for (j = 0; j < 4; j++)
+      char_array_4[j] = static_cast<unsigned char>(legacy_chars.find(char_array_4[j]));
+
+    char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
+    char_array_3[1] = ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
+    char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+
+    for (j = 0; (j < i - 1); j++)
+      ret += char_array_3[j];
+  }
+
+  return ret;
+}
+
+std::string decode(const std::string &in)
+{
+  std::string out(in.size() / 4 * 3 + 3, '\0');
+  size_t n = tinygltf::base64_decode_into(in.data(), in.size(),
+                                          reinterpret_cast<unsigned char *>(&out[0]));
+  out.resize(n);
+  return out;
+}
+
+std::string random_bytes(std::mt19937 &rng, size_t size)
+{
+  std::string bytes(size, '\0');
+  for (size_t i = 0; i < size; ++i)
+    bytes[i] = static_cast<char>(rng() & 0xff);
+  return bytes;
+}
+
+std::string encode(const std::string &bytes)
+{
+  return tinygltf::base64_encode(reinterpret_cast<const unsigned char *>(bytes.data()),
+                                 static_cast<unsigned int>(bytes.size()));
+}
+
+// 두 디코더의 결과가 다르면 그 입력을 출력하고 false.
+bool check(const std::string &in)
+{
+  if (decode(in) == legacy_decode(in))
+    return true;
+
+  std::fprintf(stderr, "mismatch (length %zu): %.80s\n", in.size(), in.c_str());
+  return false;
+}
+
+bool check_all(std::mt19937 &rng)
+{
+  const char invalid[] = {'=', ' ', '\n', '-', '_', '*', '\0', '\x80', '\xff'};
+  int failures = 0;
+
+  for (size_t size = 0; size < 200; ++size)
+  {
+    std::string in = encode(random_bytes(rng, size));
+    failures += !check(in);
+
+    // 패딩을 뗀 입력
+    std::string unpadded = in.substr(0, in.find('='));
+    failures += !check(unpadded);
+
+    // 중간에 잘못된 문자가 끼어든 입력
+    for (size_t pos = 0; pos < in.size(); pos += 1 + pos / 8)
+    {
+      for (char c : invalid)
+      {
+        std::string broken = in;
+        broken[pos] = c;
+        failures += !check(broken);
+      }
+    }
+  }
+
+  return failures == 0;
+}
+
+template <typename Function>
+double best_seconds(int repeat, Function function)
+{
+  double best = 1e30;
+  for (int i = 0; i < repeat; ++i)
+  {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    function();
+    best = std::min(best, std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - begin)
+                              .count());
+  }
+  return best;
+}
+
+int main(int argc, char **argv)
+{
+  size_t megabytes = argc > 1 ? std::max(1, atoi(argv[1])) : 64;
+  int repeat = argc > 2 ? std::max(1, atoi(argv[2])) : 5;
+
+  std::mt19937 rng(1234);
+  if (!check_all(rng))
+  {
+    std::fprintf(stderr, "base64_decode_into differs from the legacy decoder\n");
+    return 1;
+  }
+  std::printf("edge cases: ok\n");
+
+  std::string in = encode(random_bytes(rng, megabytes * 1024 * 1024 / 4 * 3));
+  std::string legacy_out;
+  std::string new_out;
+
+  double legacy_s = best_seconds(repeat, [&]() { legacy_out = legacy_decode(in); });
+  double new_s = best_seconds(repeat, [&]() { new_out = decode(in); });
+
+  if (legacy_out != new_out)
+  {
+    std::fprintf(stderr, "outputs differ on the %zu MB input\n", megabytes);
+    return 1;
+  }
+
+  double gb = in.size() / 1e9;
+  std::printf("input: %.1f MB of base64\n", in.size() / 1e6);
+  std::printf("legacy base64_decode : %8.3f ms  %6.2f GB/s\n", legacy_s * 1e3, gb / legacy_s);
+  std::printf("base64_decode_into   : %8.3f ms  %6.2f GB/s  (x%.1f)\n", new_s * 1e3,
+              gb / new_s, legacy_s / new_s);
+
+  return 0;
+}
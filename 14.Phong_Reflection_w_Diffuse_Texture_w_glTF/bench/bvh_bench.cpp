@@ -0,0 +1,184 @@
+// 노드 수를 1k에서 1M까지 늘려 가며 BVH build/refit과 질의 시간을 잰다.
+// 합성 scene은 넓은 바닥 위에 작은 상자를 흩어 놓고, 그 안에 선 카메라가 한쪽을
+// 바라보는 실내 walkthrough에 가깝게 만든다. 절두체 질의는 선형 SIMD 컬링
+// (culling::cull_boxes)과 결과를 비교한다. refit은 노드의 0.1%/1%를 움직였을 때와
+// refit_all()을 따로 재어, 선형 컬링보다 느려지는 지점(bvh::refit_linear_ratio)을 확인한다.
+//
+// 사용법: ./bvh_bench [반복 횟수]
+
+#include "../bvh.hpp"
+#include "../../common/transform.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+double elapsed_ms(Clock::time_point begin)
+{
+  return std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+}
+
+double median(std::vector<double> values)
+{
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+void make_scene(size_t num_nodes, std::mt19937 &rng, culling::BoxSet &boxes)
+{
+  // 노드 수가 늘어도 밀도가 비슷하도록 바닥 넓이를 키운다.
+  float half_size = 2.0f * std::sqrt(float(num_nodes));
+  std::uniform_real_distribution<float> floor(-half_size, half_size);
+  std::uniform_real_distribution<float> height(0.0f, 10.0f);
+  std::uniform_real_distribution<float> size(0.2f, 1.5f);
+
+  boxes.clear();
+  for (size_t i = 0; i < num_nodes; ++i)
+  {
+    const float center[3] = {floor(rng), height(rng), floor(rng)};
+    const float extent[3] = {size(rng), size(rng), size(rng)};
+    boxes.push_back(center, extent);
+  }
+}
+
+// 상자 num_changed개를 조금씩 움직인 뒤 refit하는 시간
+double time_refit(bvh::Bvh &tree, culling::BoxSet &boxes, std::mt19937 &rng,
+                  size_t num_changed, int repeat)
+{
+  std::uniform_int_distribution<uint32_t> pick(0, static_cast<uint32_t>(boxes.size() - 1));
+  std::uniform_real_distribution<float> nudge(-0.5f, 0.5f);
+  std::vector<double> times;
+  for (int r = 0; r < repeat; ++r)
+  {
+    std::vector<uint32_t> changed;
+    for (size_t i = 0; i < std::max<size_t>(1, num_changed); ++i)
+    {
+      uint32_t item = pick(rng);
+      boxes.center_x[item] += nudge(rng);
+      boxes.center_z[item] += nudge(rng);
+      changed.push_back(item);
+    }
+    Clock::time_point begin = Clock::now();
+    bvh::refit(tree, boxes, changed);
+    times.push_back(elapsed_ms(begin));
+  }
+  return median(times);
+}
+
+int main(int argc, char **argv)
+{
+  int repeat = argc > 1 ? std::max(1, atoi(argv[1])) : 11;
+
+  kmuvcl::math::mat4f view = kmuvcl::math::lookAt<float>(0.0f, 2.0f, 0.0f,
+                                                         1.0f, 2.0f, 0.3f,
+                                                         0.0f, 1.0f, 0.0f);
+  kmuvcl::math::mat4f proj = kmuvcl::math::perspective<float>(60.0f, 16.0f / 9.0f, 0.1f, 100.0f);
+  kmuvcl::math::mat4f vp = proj * view;
+  const float *m = vp;
+  culling::Frustum frustum = culling::extract_frustum(m);
+
+  std::printf("median of %d runs (ms); rays/boxes: 1000 queries\n", repeat);
+  std::printf("%10s%10s%11s%10s%11s%10s%12s%12s%10s%10s%10s\n", "nodes", "build",
+              "refit0.1%", "refit1%", "refit all", "linear", "bvh cull", "visible", "diff",
+              "rays", "boxes");
+
+  std::mt19937 rng(7);
+  const size_t sizes[] = {1000, 10000, 100000, 1000000};
+  for (size_t num_nodes : sizes)
+  {
+    culling::BoxSet boxes;
+    make_scene(num_nodes, rng, boxes);
+
+    std::vector<uint32_t> items(num_nodes);
+    for (size_t i = 0; i < num_nodes; ++i)
+      items[i] = static_cast<uint32_t>(i);
+
+    bvh::Bvh tree;
+    std::vector<double> build_times;
+    for (int r = 0; r < std::max(1, repeat / 4); ++r)
+    {
+      Clock::time_point begin = Clock::now();
+      bvh::build(tree, boxes, items);
+      build_times.push_back(elapsed_ms(begin));
+    }
+
+    double refit_small_ms = time_refit(tree, boxes, rng, num_nodes / 1000, repeat);
+    double refit_ms = time_refit(tree, boxes, rng, num_nodes / 100, repeat);
+    std::vector<double> refit_all_times;
+    for (int r = 0; r < std::max(1, repeat / 4); ++r)
+    {
+      Clock::time_point begin = Clock::now();
+      bvh::refit_all(tree, boxes);
+      refit_all_times.push_back(elapsed_ms(begin));
+    }
+
+    std::vector<unsigned char> linear_visible;
+    std::vector<double> linear_times;
+    size_t num_visible = 0;
+    for (int r = 0; r < repeat; ++r)
+    {
+      Clock::time_point begin = Clock::now();
+      num_visible = culling::cull_boxes(frustum, boxes, linear_visible);
+      linear_times.push_back(elapsed_ms(begin));
+    }
+
+    std::vector<uint32_t> visible;
+    std::vector<double> bvh_times;
+    for (int r = 0; r < repeat; ++r)
+    {
+      visible.clear();
+      Clock::time_point begin = Clock::now();
+      bvh::query_frustum(tree, boxes, frustum, visible);
+      bvh_times.push_back(elapsed_ms(begin));
+    }
+
+    // 두 방법이 고른 상자가 다른 개수
+    std::vector<unsigned char> bvh_visible(num_nodes, 0);
+    for (uint32_t item : visible)
+      bvh_visible[item] = 1;
+    size_t diff = 0;
+    for (size_t i = 0; i < num_nodes; ++i)
+      diff += bvh_visible[i] != linear_visible[i];
+
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::vector<uint32_t> hits;
+    Clock::time_point ray_begin = Clock::now();
+    for (int q = 0; q < 1000; ++q)
+    {
+      const float origin[3] = {0.0f, 2.0f, 0.0f};
+      const float direction[3] = {unit(rng), 0.1f * unit(rng), unit(rng)};
+      hits.clear();
+      bvh::query_ray(tree, boxes, origin, direction, 50.0f, hits);
+    }
+    double ray_ms = elapsed_ms(ray_begin);
+
+    float half_size = 2.0f * std::sqrt(float(num_nodes));
+    std::uniform_real_distribution<float> floor(-half_size, half_size);
+    Clock::time_point box_begin = Clock::now();
+    for (int q = 0; q < 1000; ++q)
+    {
+      culling::Aabb query;
+      query.min[0] = floor(rng);
+      query.min[1] = 0.0f;
+      query.min[2] = floor(rng);
+      query.max[0] = query.min[0] + 5.0f;
+      query.max[1] = 10.0f;
+      query.max[2] = query.min[2] + 5.0f;
+      hits.clear();
+      bvh::query_box(tree, boxes, query, hits);
+    }
+    double box_ms = elapsed_ms(box_begin);
+
+    std::printf("%10zu%10.3f%11.3f%10.3f%11.3f%10.3f%12.3f%12zu%10zu%10.3f%10.3f\n",
+                num_nodes, median(build_times), refit_small_ms, refit_ms,
+                median(refit_all_times), median(linear_times), median(bvh_times), num_visible,
+                diff, ray_ms, box_ms);
+  }
+
+  return 0;
+}
@@ -0,0 +1,214 @@
+// test_models의 각 모델을 원본에서 읽는 시간(cold)과 scene 캐시에서 읽는 시간(warm)을
+// 비교한다. 캐시는 임시로 "<모델>.cache"에 만들었다가 지운다.
+//
+// 사용법: ./cache_bench [test_models 경로] [반복 횟수]
+
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+#include "../../glTF/tiny_gltf.h"
+#include "../scene_cache.hpp"
+
+#include <dirent.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+const char *variants[] = {"glTF", "glTF-Embedded", "glTF-Binary"};
+const size_t num_variants = sizeof(variants) / sizeof(variants[0]);
+
+std::vector<std::string> list_dir(const std::string &path)
+{
+  std::vector<std::string> names;
+
+  DIR *dir = opendir(path.c_str());
+  if (!dir)
+    return names;
+
+  while (struct dirent *entry = readdir(dir))
+  {
+    std::string name = entry->d_name;
+    if (name != "." && name != "..")
+      names.push_back(name);
+  }
+  closedir(dir);
+
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+bool has_suffix(const std::string &str, const std::string &suffix)
+{
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+std::string find_model_file(const std::string &dir)
+{
+  std::vector<std::string> names = list_dir(dir);
+  for (const std::string &name : names)
+  {
+    if (has_suffix(name, ".gltf") || has_suffix(name, ".glb"))
+      return dir + "/" + name;
+  }
+  return "";
+}
+
+// .gltf가 가리키는 외부 buffer 파일 중 없는 첫 파일의 경로. 모두 있으면 빈 문자열.
+// (저장소에 .bin이 빠진 Sponza처럼 내려받지 않은 모델은 실패로 세지 않고 건너뛴다. 없는
+// image는 로더가 경고만 하고 계속 읽으므로 보지 않는다)
+std::string find_missing_file(const std::string &filename)
+{
+  if (!has_suffix(filename, ".gltf"))
+    return "";
+
+  std::ifstream file(filename.c_str());
+  nlohmann::json document = nlohmann::json::parse(file, nullptr, false);
+  if (document.is_discarded())
+    return ""; // 읽을 수 없는 파일은 로더가 알린다.
+
+  size_t slash = filename.find_last_of("/\\");
+  std::string base_dir = slash == std::string::npos ? "" : filename.substr(0, slash + 1);
+
+  nlohmann::json::const_iterator buffers = document.find("buffers");
+  if (buffers == document.end() || !buffers->is_array())
+    return "";
+
+  for (const nlohmann::json &buffer : *buffers)
+  {
+    if (!buffer.is_object() || !buffer.count("uri") || !buffer["uri"].is_string())
+      continue;
+    std::string uri = buffer["uri"].get<std::string>();
+    if (tinygltf::IsDataURI(uri))
+      continue;
+    if (!std::ifstream((base_dir + uri).c_str()))
+      return base_dir + uri;
+  }
+  return "";
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point begin)
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin)
+      .count();
+}
+
+// 뷰어의 load_model()과 같은 설정으로 원본을 읽는다.
+bool load_cold(const std::string &filename, tinygltf::Model *model, double *ms)
+{
+  tinygltf::TinyGLTF loader;
+  std::string err;
+  std::string warn;
+
+  loader.SetParallelImageDecoding(true);
+  loader.SetStreamingJsonParse(true);
+  tinygltf::FsCallbacks fs = {
+      &tinygltf::FileExists, &tinygltf::ExpandFilePath,
+      &tinygltf::ReadWholeFile, &tinygltf::WriteWholeFile,
+      nullptr, &tinygltf::MapWholeFile};
+  loader.SetFsCallbacks(fs);
+
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  bool res = has_suffix(filename, ".glb")
+                 ? loader.LoadBinaryFromFile(model, &err, &warn, filename)
+                 : loader.LoadASCIIFromFile(model, &err, &warn, filename);
+  *ms = elapsed_ms(begin);
+
+  if (!res)
+    std::cerr << "Failed to load glTF: " << filename << ": " << err << std::endl;
+  return res;
+}
+
+double median(std::vector<double> values)
+{
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+int main(int argc, char **argv)
+{
+  std::string root = argc > 1 ? argv[1] : "../test_models/test_models";
+  int repeat = argc > 2 ? std::max(1, atoi(argv[2])) : 10;
+
+  std::printf("%-28s %-14s %10s %10s %8s %12s\n", "model (median ms)", "variant", "cold",
+              "warm", "warm %", "cache (KB)");
+
+  std::vector<std::string> models = list_dir(root);
+  for (const std::string &model_name : models)
+  {
+    for (size_t v = 0; v < num_variants; ++v)
+    {
+      std::string filename = find_model_file(root + "/" + model_name + "/" + variants[v]);
+      if (filename.empty())
+        continue;
+
+      std::string missing = find_missing_file(filename);
+      if (!missing.empty())
+      {
+        std::printf("%-28s %-14s %10s  (%s not found)\n", model_name.c_str(), variants[v],
+                    "skipped", missing.c_str());
+        continue;
+      }
+
+      std::vector<double> cold_times;
+      tinygltf::Model model;
+      for (int i = 0; i < repeat; ++i)
+      {
+        double ms = 0.0;
+        model = tinygltf::Model();
+        if (!load_cold(filename, &model, &ms))
+          break;
+        cold_times.push_back(ms);
+      }
+      if (cold_times.empty())
+        continue;
+
+      std::string cache_path = filename + ".cache";
+      std::string err;
+      if (!save_scene_cache(cache_path, filename, model, std::vector<SceneCacheNode>(),
+                            std::vector<SceneCacheInstance>(), std::vector<SceneCacheMesh>(), 0,
+                            &err))
+      {
+        std::cerr << "Failed to save scene cache: " << cache_path << ": " << err << std::endl;
+        continue;
+      }
+
+      std::vector<double> warm_times;
+      for (int i = 0; i < repeat; ++i)
+      {
+        tinygltf::Model cached;
+        std::vector<SceneCacheNode> nodes;
+        std::vector<SceneCacheInstance> instances;
+        std::vector<SceneCacheMesh> meshes;
+        std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+        if (!load_scene_cache(cache_path, filename, 0, &cached, &nodes, &instances, &meshes, &err))
+        {
+          std::cerr << "Failed to load scene cache: " << cache_path << ": " << err << std::endl;
+          break;
+        }
+        warm_times.push_back(elapsed_ms(begin));
+      }
+
+      std::ifstream cache_file(cache_path.c_str(), std::ifstream::binary | std::ifstream::ate);
+      double cache_kb = static_cast<double>(cache_file.tellg()) / 1024.0;
+      std::remove(cache_path.c_str());
+
+      if (warm_times.empty())
+        continue;
+
+      double cold = median(cold_times);
+      double warm = median(warm_times);
+      std::printf("%-28s %-14s %10.3f %10.3f %7.1f%% %12.1f\n", model_name.c_str(), variants[v],
+                  cold, warm, 100.0 * warm / cold, cache_kb);
+    }
+  }
+
+  return 0;
+}
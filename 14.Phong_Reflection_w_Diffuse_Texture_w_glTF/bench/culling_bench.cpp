@@ -0,0 +1,101 @@
+// 절두체 컬링 커널(스칼라 / SSE / AVX)을 무작위 상자로 비교한다.
+// 상자를 격자 위에 흩어 두고 안쪽에서 한쪽을 바라보는 카메라로 검사하므로
+// 실내를 걸어 다니는 경우처럼 대부분의 상자가 절두체 밖에 있다.
+//
+// 사용법: ./culling_bench [상자 수] [반복 횟수]
+
+#include "../culling.hpp"
+#include "../../common/transform.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+double median(std::vector<double> values)
+{
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+// 한 커널을 여러 번 돌려 중앙값(ms)과 보이는 상자 수를 구한다.
+double time_kernel(culling::CullFunction cull, const culling::Frustum &frustum,
+                   const culling::BoxSet &boxes, int repeat,
+                   std::vector<unsigned char> &visible, size_t *num_visible)
+{
+  visible.assign(boxes.size(), 0);
+
+  std::vector<double> times;
+  for (int i = 0; i < repeat; ++i)
+  {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    *num_visible = cull(frustum, boxes, visible.data());
+    times.push_back(std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - begin)
+                        .count());
+  }
+  return median(times);
+}
+
+int main(int argc, char **argv)
+{
+  size_t num_boxes = argc > 1 ? std::max(1, atoi(argv[1])) : 1000000;
+  int repeat = argc > 2 ? std::max(1, atoi(argv[2])) : 20;
+
+  std::mt19937 rng(12345);
+  std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+  std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+  culling::BoxSet boxes;
+  for (size_t i = 0; i < num_boxes; ++i)
+  {
+    const float center[3] = {position(rng), position(rng), position(rng)};
+    const float extent[3] = {size(rng), size(rng), size(rng)};
+    boxes.push_back(center, extent);
+  }
+
+  kmuvcl::math::mat4f view = kmuvcl::math::lookAt<float>(0.0f, 0.0f, 0.0f,
+                                                         1.0f, 0.0f, 0.2f,
+                                                         0.0f, 1.0f, 0.0f);
+  kmuvcl::math::mat4f proj = kmuvcl::math::perspective<float>(60.0f, 1.0f, 0.1f, 50.0f);
+  kmuvcl::math::mat4f vp = proj * view;
+  const float *m = vp;
+  culling::Frustum frustum = culling::extract_frustum(m);
+
+  struct Kernel
+  {
+    const char *name;
+    culling::CullFunction cull;
+  };
+  std::vector<Kernel> kernels;
+  kernels.push_back(Kernel{"scalar", &culling::cull_boxes_scalar_all});
+#ifdef CULLING_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2"))
+    kernels.push_back(Kernel{"sse (4 boxes)", &culling::cull_boxes_sse});
+  if (__builtin_cpu_supports("avx"))
+    kernels.push_back(Kernel{"avx (8 boxes)", &culling::cull_boxes_avx});
+#endif
+
+  std::printf("%zu boxes, median of %d runs\n", num_boxes, repeat);
+  std::printf("%-16s%12s%12s%12s\n", "kernel", "ms", "Mboxes/s", "visible");
+
+  std::vector<unsigned char> reference;
+  for (const Kernel &kernel : kernels)
+  {
+    std::vector<unsigned char> visible;
+    size_t num_visible = 0;
+    double ms = time_kernel(kernel.cull, frustum, boxes, repeat, visible, &num_visible);
+    std::printf("%-16s%12.3f%12.1f%12zu\n", kernel.name, ms,
+                num_boxes / ms / 1000.0, num_visible);
+
+    if (reference.empty())
+      reference = visible;
+    else if (visible != reference)
+      std::printf("  results differ from the scalar kernel!\n");
+  }
+
+  return 0;
+}
@@ -0,0 +1,178 @@
+// 큰 합성 씬(노드/메시/액세서 수십만 개)의 glTF JSON을 DOM 파서와 SAX(스트리밍)
+// 파서로 각각 읽어 파싱 시간과 최대 힙 사용량을 비교한다.
+//
+// 사용법: ./json_bench [노드 수] [반복 횟수]
+
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+#include "../../glTF/tiny_gltf.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+/// 힙 사용량 측정: 전역 operator new/delete가 현재/최대 할당량을 센다.
+////////////////////////////////////////////////////////////////////////////////
+size_t heap_live = 0;
+size_t heap_peak = 0;
+size_t heap_allocs = 0;
+
+const size_t header_size = 16;  // 할당 크기를 저장 (정렬 유지)
+
+void *operator new(size_t size)
+{
+  void *p = std::malloc(size + header_size);
+  if (!p)
+    throw std::bad_alloc();
+
+  *static_cast<size_t *>(p) = size;
+  heap_live += size;
+  heap_peak = std::max(heap_peak, heap_live);
+  heap_allocs++;
+  return static_cast<char *>(p) + header_size;
+}
+
+void operator delete(void *ptr) noexcept
+{
+  if (!ptr)
+    return;
+
+  void *p = static_cast<char *>(ptr) - header_size;
+  heap_live -= *static_cast<size_t *>(p);
+  std::free(p);
+}
+
+void *operator new[](size_t size) { return operator new(size); }
+void operator delete[](void *ptr) noexcept { operator delete(ptr); }
+////////////////////////////////////////////////////////////////////////////////
+
+// 노드마다 메시 하나(위치/법선/UV/인덱스 액세서 4개)를 가진 씬.
+// 모든 액세서는 작은 버퍼 하나를 공유한다.
+std::string make_scene(int num_nodes)
+{
+  std::ostringstream json;
+  json << "{\"asset\":{\"version\":\"2.0\",\"generator\":\"json_bench\"},";
+  json << "\"scene\":0,\"scenes\":[{\"nodes\":[";
+  for (int i = 0; i < num_nodes; ++i)
+    json << (i ? "," : "") << i;
+  json << "]}],";
+
+  json << "\"nodes\":[";
+  for (int i = 0; i < num_nodes; ++i)
+  {
+    json << (i ? "," : "") << "{\"name\":\"node_" << i << "\",\"mesh\":" << i
+         << ",\"translation\":[" << i % 100 << "," << i / 100 % 100 << "," << i / 10000
+         << "],\"rotation\":[0,0,0,1],\"scale\":[1,1,1]}";
+  }
+  json << "],";
+
+  json << "\"meshes\":[";
+  for (int i = 0; i < num_nodes; ++i)
+  {
+    json << (i ? "," : "") << "{\"primitives\":[{\"attributes\":{\"POSITION\":" << 4 * i
+         << ",\"NORMAL\":" << 4 * i + 1 << ",\"TEXCOORD_0\":" << 4 * i + 2
+         << "},\"indices\":" << 4 * i + 3 << ",\"material\":0}]}";
+  }
+  json << "],";
+
+  json << "\"accessors\":[";
+  for (int i = 0; i < num_nodes; ++i)
+  {
+    json << (i ? "," : "")
+         << "{\"bufferView\":0,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\","
+            "\"min\":[0,0,0],\"max\":[1,1,0]},"
+            "{\"bufferView\":0,\"componentType\":5126,\"count\":3,\"type\":\"VEC3\"},"
+            "{\"bufferView\":0,\"componentType\":5126,\"count\":3,\"type\":\"VEC2\"},"
+            "{\"bufferView\":1,\"componentType\":5123,\"count\":3,\"type\":\"SCALAR\"}";
+  }
+  json << "],";
+
+  json << "\"materials\":[{\"pbrMetallicRoughness\":{\"baseColorFactor\":[1,1,1,1]}}],";
+  json << "\"bufferViews\":[{\"buffer\":0,\"byteLength\":36},"
+          "{\"buffer\":0,\"byteOffset\":36,\"byteLength\":6}],";
+  json << "\"buffers\":[{\"byteLength\":42,\"uri\":\"data:application/octet-stream;base64,"
+       << std::string(56, 'A') << "\"}]}";
+
+  return json.str();
+}
+
+struct Result
+{
+  double ms;
+  size_t peak_bytes;
+  size_t model_bytes;  // 파싱이 끝난 뒤 남아 있는 Model의 크기
+  size_t allocs;
+};
+
+bool parse(const std::string &json, bool streaming, Result *result)
+{
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  size_t live_before = heap_live;
+  heap_peak = heap_live;
+  heap_allocs = 0;
+
+  bool res;
+  {
+    tinygltf::TinyGLTF loader;
+    tinygltf::Model model;
+    std::string err;
+    std::string warn;
+
+    loader.SetStreamingJsonParse(streaming);
+    res = loader.LoadASCIIFromString(&model, &err, &warn, json.c_str(),
+                                     static_cast<unsigned int>(json.size()), "");
+    if (!res)
+      std::cerr << "Failed to parse glTF: " << err << std::endl;
+
+    // Model 자체를 해제하는 시간은 빼고 잰다.
+    result->ms = std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - begin)
+                     .count();
+    result->peak_bytes = heap_peak - live_before;
+    result->model_bytes = heap_live - live_before;
+    result->allocs = heap_allocs;
+  }
+
+  return res;
+}
+
+int main(int argc, char **argv)
+{
+  int num_nodes = argc > 1 ? std::max(1, atoi(argv[1])) : 100000;
+  int repeat = argc > 2 ? std::max(1, atoi(argv[2])) : 3;
+
+  std::string json = make_scene(num_nodes);
+  std::printf("%d nodes, %d meshes, %d accessors: %.1f MB of JSON\n\n", num_nodes,
+              num_nodes, 4 * num_nodes, json.size() / 1e6);
+
+  std::printf("%-10s %12s %16s %12s %14s\n", "parser", "best ms", "peak heap (MB)",
+              "model (MB)", "allocations");
+  const char *names[] = {"DOM", "SAX"};
+  for (int streaming = 0; streaming < 2; ++streaming)
+  {
+    Result best = {1e30, 0, 0, 0};
+    for (int i = 0; i < repeat; ++i)
+    {
+      Result result;
+      if (!parse(json, streaming != 0, &result))
+        return 1;
+      best.ms = std::min(best.ms, result.ms);
+      best.peak_bytes = result.peak_bytes;
+      best.model_bytes = result.model_bytes;
+      best.allocs = result.allocs;
+    }
+    std::printf("%-10s %12.1f %16.1f %12.1f %14zu\n", names[streaming], best.ms,
+                best.peak_bytes / 1e6, best.model_bytes / 1e6, best.allocs);
+  }
+
+  return 0;
+}
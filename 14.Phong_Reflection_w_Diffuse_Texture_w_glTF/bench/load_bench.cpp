@@ -0,0 +1,544 @@
+// test_models의 각 모델을 모든 형식(glTF / glTF-Embedded / glTF-Binary / glTF-Draco /
+// glTF-pbrSpecularGlossiness)으로 여러 번 읽고, 로드 시간을 단계별로 나눠 출력한다.
+//
+//  - file I/O, JSON 파싱, base64 디코딩, buffer 준비, 이미지 디코딩: tinygltf의 GetLoadStageTimes()
+//    (buffer 파일을 매핑하면 실제로 페이지를 읽는 시간은 처음 건드리는 단계에 들어간다)
+//  - GL 업로드: 뷰어처럼 accessor가 쓰는 bufferView마다 VBO 하나, 디코딩된 image마다 텍스처
+//    하나(mipmap 포함)를 올리고 glFinish()까지 잰다. 헤드리스 EGL 컨텍스트를 만들 수 없거나
+//    --no-gl이면 건너뛴다.
+//  - peak RSS: 형식마다 해제된 heap을 돌려주고(malloc_trim) /proc/self/clear_refs로 최고치를
+//    현재 값으로 되돌린 뒤 VmHWM을 읽는다. 되돌릴 수 없으면 프로세스 전체의 최고치다.
+//  - 할당: 로드 한 번 동안의 operator new와 stb_image의 malloc/realloc 횟수와 바이트 수
+// 값은 모두 반복마다의 중앙값이라, 단계의 합이 load 중앙값과 조금 다를 수 있다.
+// tinygltf를 TINYGLTF_ENABLE_DRACO 없이 빌드하므로 glTF-Draco는 읽지 못해(accessor에
+// bufferView가 없다) 건너뛴다. 외부 buffer 파일이 없는 모델도 건너뛴다.
+//
+// 사용법: ./load_bench [test_models 경로] [반복 횟수] [--no-mmap] [--no-gl]
+
+#include <GL/glew.h>
+
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// 할당 횟수와 바이트 수. 이미지 디코딩 스레드에서도 세므로 atomic이다.
+std::atomic<size_t> allocation_count(0);
+std::atomic<size_t> allocation_bytes(0);
+
+inline void count_allocation(size_t size)
+{
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+}
+
+void *counted_malloc(size_t size)
+{
+  count_allocation(size);
+  return std::malloc(size);
+}
+
+void *counted_realloc(void *ptr, size_t size)
+{
+  count_allocation(size);
+  return std::realloc(ptr, size);
+}
+
+// 세어 잡은 메모리는 모두 여기서 푼다. delete 식 안으로 free가 인라인되면 GCC가 new로 받은
+// 포인터를 free한다고 -Wmismatched-new-delete를 내므로 인라인하지 않는다.
+__attribute__((noinline)) void free_allocation(void *ptr) noexcept
+{
+  std::free(ptr);
+}
+
+void *operator new(size_t size)
+{
+  count_allocation(size);
+  if (void *ptr = std::malloc(size != 0 ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+  count_allocation(size);
+  return std::malloc(size != 0 ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+  count_allocation(size);
+  return std::malloc(size != 0 ? size : 1);
+}
+
+// 위의 operator new와 짝이 되는 delete를 sized/nothrow까지 모두 바꿔 같은 free_allocation으로 보낸다.
+void operator delete(void *ptr) noexcept
+{
+  free_allocation(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+  free_allocation(ptr);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+  free_allocation(ptr);
+}
+
+void operator delete[](void *ptr, size_t) noexcept
+{
+  free_allocation(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+  free_allocation(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+  free_allocation(ptr);
+}
+
+// 디코딩된 픽셀은 stb_image가 malloc으로 잡으므로 그쪽도 센다.
+#define STBI_MALLOC(size) counted_malloc(size)
+#define STBI_REALLOC(ptr, size) counted_realloc(ptr, size)
+#define STBI_FREE(ptr) free_allocation(ptr)
+
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+#include "../../glTF/tiny_gltf.h"
+
+#include <dirent.h>
+#include <malloc.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+const char *variants[] = {"glTF", "glTF-Embedded", "glTF-Binary", "glTF-Draco",
+                          "glTF-pbrSpecularGlossiness"};
+const size_t num_variants = sizeof(variants) / sizeof(variants[0]);
+
+// 로드 한 번의 측정값
+struct Sample
+{
+  double load_ms = 0.0;
+  tinygltf::LoadStageTimes stages;
+  double upload_ms = 0.0;
+  size_t allocations = 0;
+  size_t allocated_bytes = 0;
+};
+
+std::vector<std::string> list_dir(const std::string &path)
+{
+  std::vector<std::string> names;
+
+  DIR *dir = opendir(path.c_str());
+  if (!dir)
+    return names;
+
+  while (struct dirent *entry = readdir(dir))
+  {
+    std::string name = entry->d_name;
+    if (name != "." && name != "..")
+      names.push_back(name);
+  }
+  closedir(dir);
+
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+bool has_suffix(const std::string &str, const std::string &suffix)
+{
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// 디렉터리 안의 첫 번째 .gltf 또는 .glb 파일. 없으면 빈 문자열.
+std::string find_model_file(const std::string &dir)
+{
+  std::vector<std::string> names = list_dir(dir);
+  for (const std::string &name : names)
+  {
+    if (has_suffix(name, ".gltf") || has_suffix(name, ".glb"))
+      return dir + "/" + name;
+  }
+  return "";
+}
+
+// .gltf가 가리키는 외부 buffer 파일 중 없는 첫 파일의 경로. 모두 있으면 빈 문자열.
+// (저장소에 .bin이 빠진 Sponza처럼 내려받지 않은 모델은 실패로 세지 않고 건너뛴다. 없는
+// image는 로더가 경고만 하고 계속 읽으므로 보지 않는다)
+std::string find_missing_file(const std::string &filename)
+{
+  if (!has_suffix(filename, ".gltf"))
+    return "";
+
+  std::ifstream file(filename.c_str());
+  nlohmann::json document = nlohmann::json::parse(file, nullptr, false);
+  if (document.is_discarded())
+    return ""; // 읽을 수 없는 파일은 로더가 알린다.
+
+  size_t slash = filename.find_last_of("/\\");
+  std::string base_dir = slash == std::string::npos ? "" : filename.substr(0, slash + 1);
+
+  nlohmann::json::const_iterator buffers = document.find("buffers");
+  if (buffers == document.end() || !buffers->is_array())
+    return "";
+
+  for (const nlohmann::json &buffer : *buffers)
+  {
+    if (!buffer.is_object() || !buffer.count("uri") || !buffer["uri"].is_string())
+      continue;
+    std::string uri = buffer["uri"].get<std::string>();
+    if (tinygltf::IsDataURI(uri))
+      continue;
+    if (!std::ifstream((base_dir + uri).c_str()))
+      return base_dir + uri;
+  }
+  return "";
+}
+
+// /proc/self/status의 한 항목(kB). 없으면 0.
+size_t read_status_kb(const std::string &field)
+{
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line))
+  {
+    if (line.compare(0, field.size() + 1, field + ":") == 0)
+    {
+      std::istringstream value(line.substr(field.size() + 1));
+      size_t kb = 0;
+      value >> kb;
+      return kb;
+    }
+  }
+  return 0;
+}
+
+// peak RSS(VmHWM)를 현재 RSS로 되돌린다. (Linux 4.0 이상) 앞 모델이 해제한 heap이 RSS에
+// 남아 있지 않도록 먼저 운영체제에 돌려준다.
+bool reset_peak_rss()
+{
+  malloc_trim(0);
+
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  clear_refs << "5";
+  clear_refs.close();
+  return !clear_refs.fail();
+}
+
+// 창 없는 EGL 컨텍스트를 만들어 current로 한다. (뷰어의 init_headless_context()와 같다)
+bool init_headless_context(EGLDisplay *display, EGLContext *context)
+{
+  PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+      reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+          eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  *display = get_platform_display
+                 ? get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL)
+                 : EGL_NO_DISPLAY;
+  if (*display == EGL_NO_DISPLAY)
+    *display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+  EGLint major, minor;
+  if (*display == EGL_NO_DISPLAY || !eglInitialize(*display, &major, &minor))
+    return false;
+
+  const EGLint config_attribs[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                                   EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+  EGLConfig config;
+  EGLint num_configs = 0;
+  if (!eglBindAPI(EGL_OPENGL_API) ||
+      !eglChooseConfig(*display, config_attribs, &config, 1, &num_configs) || num_configs < 1)
+  {
+    eglTerminate(*display);
+    return false;
+  }
+
+  *context = eglCreateContext(*display, config, EGL_NO_CONTEXT, NULL);
+  if (*context == EGL_NO_CONTEXT)
+  {
+    eglTerminate(*display);
+    return false;
+  }
+
+  if (!eglMakeCurrent(*display, EGL_NO_SURFACE, EGL_NO_SURFACE, *context))
+  {
+    const EGLint surface_attribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    EGLSurface surface = eglCreatePbufferSurface(*display, config, surface_attribs);
+    if (surface == EGL_NO_SURFACE || !eglMakeCurrent(*display, surface, surface, *context))
+    {
+      eglDestroyContext(*display, *context);
+      eglTerminate(*display);
+      return false;
+    }
+  }
+
+  return glewInit() == GLEW_OK;
+}
+
+// 뷰어의 upload_buffer_view()/upload_image()처럼 올리고, 드라이버가 복사를 마칠 때까지의
+// 시간을 돌려준다. 올린 객체는 바로 지운다.
+double upload(const tinygltf::Model &model)
+{
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+  std::set<int> buffer_views;
+  for (const tinygltf::Accessor &accessor : model.accessors)
+  {
+    if (accessor.bufferView >= 0 && size_t(accessor.bufferView) < model.bufferViews.size())
+      buffer_views.insert(accessor.bufferView);
+  }
+
+  std::vector<GLuint> buffer_objects;
+  for (int index : buffer_views)
+  {
+    const tinygltf::BufferView &bufferView = model.bufferViews[index];
+    if (bufferView.buffer < 0 || size_t(bufferView.buffer) >= model.buffers.size())
+      continue;
+    const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
+    if (bufferView.byteOffset + bufferView.byteLength > buffer.Size())
+      continue;
+
+    GLenum target = bufferView.target != 0 ? bufferView.target : GL_ARRAY_BUFFER;
+    GLuint buffer_object;
+    glGenBuffers(1, &buffer_object);
+    glBindBuffer(target, buffer_object);
+    glBufferData(target, bufferView.byteLength, buffer.Data() + bufferView.byteOffset,
+                 GL_STATIC_DRAW);
+    glBindBuffer(target, 0);
+    buffer_objects.push_back(buffer_object);
+  }
+
+  std::vector<GLuint> textures;
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (const tinygltf::Image &image : model.images)
+  {
+    if (!image.Pixels())
+      continue;
+
+    GLenum format = GL_RGBA;
+    if (image.component == 1)
+      format = GL_RED;
+    else if (image.component == 2)
+      format = GL_RG;
+    else if (image.component == 3)
+      format = GL_RGB;
+    GLenum type = image.bits == 16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0, format, type,
+                 image.Pixels());
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    textures.push_back(texture);
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glFinish();
+
+  double ms = std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - begin)
+                  .count();
+
+  if (!buffer_objects.empty())
+    glDeleteBuffers(GLsizei(buffer_objects.size()), buffer_objects.data());
+  if (!textures.empty())
+    glDeleteTextures(GLsizei(textures.size()), textures.data());
+  glFinish();
+
+  return ms;
+}
+
+// 뷰어의 load_model()과 같은 설정(병렬 이미지 디코딩, SAX 파싱, 메모리 매핑)으로 읽는다.
+bool load(const std::string &filename, bool map_files, bool gl, Sample *sample)
+{
+  tinygltf::TinyGLTF loader;
+  tinygltf::Model model;
+  std::string err;
+  std::string warn;
+
+  loader.SetParallelImageDecoding(true);
+  loader.SetStreamingJsonParse(true);
+  tinygltf::FsCallbacks fs = {
+      &tinygltf::FileExists, &tinygltf::ExpandFilePath,
+      &tinygltf::ReadWholeFile, &tinygltf::WriteWholeFile,
+      nullptr, map_files ? &tinygltf::MapWholeFile : nullptr};
+  loader.SetFsCallbacks(fs);
+
+  size_t allocations = allocation_count.load();
+  size_t allocated_bytes = allocation_bytes.load();
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  bool res = has_suffix(filename, ".glb")
+                 ? loader.LoadBinaryFromFile(&model, &err, &warn, filename)
+                 : loader.LoadASCIIFromFile(&model, &err, &warn, filename);
+  sample->load_ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - begin)
+                        .count();
+  sample->allocations = allocation_count.load() - allocations;
+  sample->allocated_bytes = allocation_bytes.load() - allocated_bytes;
+  sample->stages = loader.GetLoadStageTimes();
+
+  if (!res)
+  {
+    std::cerr << "Failed to load glTF: " << filename << ": " << err << std::endl;
+    return false;
+  }
+
+  if (gl)
+    sample->upload_ms = upload(model);
+
+  return true;
+}
+
+double median(std::vector<double> values)
+{
+  std::sort(values.begin(), values.end());
+  return values[values.size() / 2];
+}
+
+// samples에서 field 하나의 중앙값
+template <typename Field>
+double median_of(const std::vector<Sample> &samples, Field field)
+{
+  std::vector<double> values;
+  for (const Sample &sample : samples)
+    values.push_back(double(field(sample)));
+  return median(values);
+}
+
+int main(int argc, char **argv)
+{
+  std::string root = "../test_models/test_models";
+  int repeat = 10;
+  bool map_files = true;
+  bool gl = true;
+
+  int positional = 0;
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string arg = argv[i];
+    if (arg == "--no-mmap")
+      map_files = false;
+    else if (arg == "--no-gl")
+      gl = false;
+    else if (positional++ == 0)
+      root = arg;
+    else
+      repeat = std::max(1, atoi(arg.c_str()));
+  }
+
+  EGLDisplay display = EGL_NO_DISPLAY;
+  EGLContext context = EGL_NO_CONTEXT;
+  if (gl && !init_headless_context(&display, &context))
+  {
+    std::cerr << "Cannot create a headless GL context; skipping GL upload" << std::endl;
+    gl = false;
+  }
+
+  bool process_peak = !reset_peak_rss();
+  std::printf("%d loads per variant, %s, GL upload %s\n", repeat,
+              map_files ? "mapped files" : "read files", gl ? "on" : "off");
+  std::printf("RSS before loading: %.1f MB%s\n", read_status_kb("VmRSS") / 1024.0,
+              process_peak ? " (cannot reset peak RSS; peak is for the whole process)" : "");
+  std::printf("\n%-42s%9s%9s%9s%9s%9s%9s%9s%10s%9s%10s\n", "median per load (ms)", "load",
+              "file", "json", "base64", "buffer", "image", "upload", "peak MB", "allocs",
+              "alloc MB");
+
+  std::vector<std::string> models = list_dir(root);
+  for (const std::string &model_name : models)
+  {
+    for (size_t v = 0; v < num_variants; ++v)
+    {
+      std::string filename = find_model_file(root + "/" + model_name + "/" + variants[v]);
+      if (filename.empty())
+        continue;
+
+      std::string name = model_name + "/" + variants[v];
+
+#ifndef TINYGLTF_ENABLE_DRACO
+      if (std::string(variants[v]) == "glTF-Draco")
+      {
+        std::printf("%-42s%9s  (built without TINYGLTF_ENABLE_DRACO)\n", name.c_str(),
+                    "skipped");
+        continue;
+      }
+#endif
+
+      std::string missing = find_missing_file(filename);
+      if (!missing.empty())
+      {
+        std::printf("%-42s%9s  (%s not found)\n", name.c_str(), "skipped", missing.c_str());
+        continue;
+      }
+
+      if (!process_peak)
+        reset_peak_rss();
+
+      std::vector<Sample> samples;
+      for (int i = 0; i < repeat; ++i)
+      {
+        Sample sample;
+        if (!load(filename, map_files, gl, &sample))
+          break;
+        samples.push_back(sample);
+      }
+
+      if (samples.empty())
+      {
+        std::printf("%-42s%9s\n", name.c_str(), "failed");
+        continue;
+      }
+
+      std::printf("%-42s%9.3f%9.3f%9.3f%9.3f%9.3f%9.3f", name.c_str(),
+                  median_of(samples, [](const Sample &s) { return s.load_ms; }),
+                  median_of(samples, [](const Sample &s) { return s.stages.file_io; }),
+                  median_of(samples, [](const Sample &s) { return s.stages.json_parse; }),
+                  median_of(samples, [](const Sample &s) { return s.stages.base64_decode; }),
+                  median_of(samples,
+                            [](const Sample &s) { return s.stages.buffer_materialization; }),
+                  median_of(samples, [](const Sample &s) { return s.stages.image_decode; }));
+      if (gl)
+        std::printf("%9.3f", median_of(samples, [](const Sample &s) { return s.upload_ms; }));
+      else
+        std::printf("%9s", "-");
+      std::printf("%10.1f%9.0f%10.2f\n", read_status_kb("VmHWM") / 1024.0,
+                  median_of(samples, [](const Sample &s) { return s.allocations; }),
+                  median_of(samples, [](const Sample &s) { return s.allocated_bytes; }) /
+                      (1024.0 * 1024.0));
+    }
+  }
+
+  if (gl)
+  {
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+  }
+
+  return 0;
+}
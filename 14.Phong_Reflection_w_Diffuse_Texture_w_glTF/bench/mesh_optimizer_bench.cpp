@@ -0,0 +1,167 @@
+// test_models의 각 모델(glTF 형식)에 mesh_optimizer를 적용해 ACMR/ATVR을 전후로 비교한다.
+// "vcache"는 vertex cache 최적화만 한 결과이고, "all"은 overdraw 정렬과 vertex fetch
+// 재배치까지 한 결과다. (overdraw 정렬은 cluster 사이의 순서를 바꾸므로 ACMR이 조금 는다)
+//
+// 사용법: ./mesh_optimizer_bench [test_models 경로]
+
+#define TINYGLTF_IMPLEMENTATION
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+
+#include "../../glTF/tiny_gltf.h"
+#include "../mesh_optimizer.hpp"
+
+#include <dirent.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+std::vector<std::string> list_dir(const std::string &path)
+{
+  std::vector<std::string> names;
+
+  DIR *dir = opendir(path.c_str());
+  if (!dir)
+    return names;
+
+  while (struct dirent *entry = readdir(dir))
+  {
+    std::string name = entry->d_name;
+    if (name != "." && name != "..")
+      names.push_back(name);
+  }
+  closedir(dir);
+
+  std::sort(names.begin(), names.end());
+  return names;
+}
+
+bool has_suffix(const std::string &str, const std::string &suffix)
+{
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// 디렉터리 안의 첫 번째 .gltf 파일. 없으면 빈 문자열.
+std::string find_model_file(const std::string &dir)
+{
+  std::vector<std::string> names = list_dir(dir);
+  for (const std::string &name : names)
+  {
+    if (has_suffix(name, ".gltf"))
+      return dir + "/" + name;
+  }
+  return "";
+}
+
+// .gltf가 가리키는 외부 buffer 파일 중 없는 첫 파일의 경로. 모두 있으면 빈 문자열.
+// (저장소에 .bin이 빠진 Sponza처럼 내려받지 않은 모델은 실패로 세지 않고 건너뛴다. 없는
+// image는 로더가 경고만 하고 계속 읽으므로 보지 않는다)
+std::string find_missing_file(const std::string &filename)
+{
+  if (!has_suffix(filename, ".gltf"))
+    return "";
+
+  std::ifstream file(filename.c_str());
+  nlohmann::json document = nlohmann::json::parse(file, nullptr, false);
+  if (document.is_discarded())
+    return ""; // 읽을 수 없는 파일은 로더가 알린다.
+
+  size_t slash = filename.find_last_of("/\\");
+  std::string base_dir = slash == std::string::npos ? "" : filename.substr(0, slash + 1);
+
+  nlohmann::json::const_iterator buffers = document.find("buffers");
+  if (buffers == document.end() || !buffers->is_array())
+    return "";
+
+  for (const nlohmann::json &buffer : *buffers)
+  {
+    if (!buffer.is_object() || !buffer.count("uri") || !buffer["uri"].is_string())
+      continue;
+    std::string uri = buffer["uri"].get<std::string>();
+    if (tinygltf::IsDataURI(uri))
+      continue;
+    if (!std::ifstream((base_dir + uri).c_str()))
+      return base_dir + uri;
+  }
+  return "";
+}
+
+bool load(const std::string &filename, tinygltf::Model *model)
+{
+  tinygltf::TinyGLTF loader;
+  std::string err;
+  std::string warn;
+
+  // 이미지는 필요 없으므로 디코딩하지 않는다.
+  loader.SetImageLoader(
+      [](tinygltf::Image *, const int, std::string *, std::string *, int, int,
+         const unsigned char *, int, void *) { return true; },
+      nullptr);
+
+  if (!loader.LoadASCIIFromFile(model, &err, &warn, filename))
+  {
+    std::cerr << "Failed to load glTF: " << filename << ": " << err << std::endl;
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  std::string root = argc > 1 ? argv[1] : "../test_models/test_models";
+
+  std::printf("%-26s%8s%10s%10s%10s%10s%10s%10s%10s\n", "model", "prims", "triangles",
+              "ACMR", "vcache", "all", "ATVR", "all", "ms");
+
+  std::vector<std::string> models = list_dir(root);
+  for (const std::string &model_name : models)
+  {
+    std::string filename = find_model_file(root + "/" + model_name + "/glTF");
+    if (filename.empty())
+      continue;
+
+    std::string missing = find_missing_file(filename);
+    if (!missing.empty())
+    {
+      std::printf("%-26s%8s  (%s not found)\n", model_name.c_str(), "skipped", missing.c_str());
+      continue;
+    }
+
+    tinygltf::Model model;
+    if (!load(filename, &model))
+      continue;
+
+    mesh_optimizer::Options vertex_cache_only;
+    vertex_cache_only.overdraw = false;
+    vertex_cache_only.vertex_fetch = false;
+    mesh_optimizer::Report vcache = mesh_optimizer::optimize_model(model, vertex_cache_only);
+
+    model = tinygltf::Model();
+    if (!load(filename, &model))
+      continue;
+
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    mesh_optimizer::Report all = mesh_optimizer::optimize_model(model, mesh_optimizer::Options());
+    double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - begin)
+                    .count();
+
+    if (all.primitives == 0)
+    {
+      std::printf("%-26s%8zu%10s  (no indexed triangle primitives)\n", model_name.c_str(),
+                  all.skipped, "-");
+      continue;
+    }
+    std::printf("%-26s%8zu%10zu%10.3f%10.3f%10.3f%10.3f%10.3f%10.2f\n", model_name.c_str(),
+                all.primitives, all.before.triangles, all.before.acmr(), vcache.after.acmr(),
+                all.after.acmr(), all.before.atvr(), all.after.atvr(), ms);
+  }
+
+  return 0;
+}
@@ -0,0 +1,555 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+// world 공간 상자들 위의 BVH (bounding volume hierarchy)
+//
+// culling::BoxSet에 든 상자 중 일부(items)를 binned SAH로 나눠 이진 트리를 만든다.
+// 노드는 자식보다 항상 앞에 있고 두 자식은 연달아 놓이며, 한 노드 아래의 item은
+// items 배열에서 연속된 구간을 이룬다. 그래서
+//  - 절두체 안에 완전히 들어간 노드는 더 내려가지 않고 구간을 통째로 내보내고,
+//  - 상자가 움직이면 해당 잎에서 루트까지의 노드만 인덱스 역순으로 다시 맞춘다(refit).
+// refit은 트리 모양을 바꾸지 않으므로 많이 움직인 뒤에는 다시 build하는 편이 낫다.
+//
+// refit은 바뀐 상자마다 잎에서 루트까지 올라가므로 상자당 비용이 선형 컬링보다 훨씬 크다.
+// bench/bvh_bench(-O2 -march=native)로 1M 상자를 재면 build는 1.3~1.6 s, 선형 SIMD 컬링
+// (culling::cull_boxes)은 2.7~3.2 ms인데 refit은 0.1%가 바뀌면 2.3 ms, 1%면 15 ms이고 모든 노드를
+// 한 번 도는 refit_all()은 120~140 ms다. refit이 선형 컬링보다 느려지는 지점은 100k 상자에서
+// 0.2%, 1M에서 0.1% 안팎이므로 refit_beats_linear_cull()은 1/1024를 기준으로 삼는다.
+// 그보다 많이 바뀐 프레임에는 refit하지 말고 선형으로 컬링하는 편이 빠르다.
+
+#include "culling.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace bvh
+{
+const uint32_t no_node = 0xffffffffu;
+const unsigned num_bins = 12;
+const unsigned max_leaf_size = 4;
+const unsigned refit_linear_ratio = 1024; // 바뀐 상자가 items의 1/1024을 넘으면 선형 컬링이 빠르다.
+
+struct Node
+{
+  float min[3];
+  float max[3];
+  uint32_t left = 0;  // 왼쪽 자식 (오른쪽은 left + 1). 0이면 잎 (루트는 누구의 자식도 아니다)
+  uint32_t first = 0; // items에서 이 노드 아래 item이 시작하는 위치
+  uint32_t count = 0; // 이 노드 아래 item 수
+
+  bool is_leaf() const
+  {
+    return left == 0;
+  }
+};
+
+struct Bvh
+{
+  std::vector<Node> nodes;
+  std::vector<uint32_t> items;    // BoxSet 인덱스. 노드마다 연속된 구간을 가진다.
+  std::vector<uint32_t> parent;   // [node]
+  std::vector<uint32_t> leaf_of;  // [BoxSet 인덱스] 그 item이 든 잎 (트리에 없으면 no_node)
+  std::vector<unsigned char> stale; // refit 중에만 쓰는 표시
+};
+
+inline void box_of(const culling::BoxSet &boxes, uint32_t i, float min[3], float max[3])
+{
+  min[0] = boxes.center_x[i] - boxes.extent_x[i];
+  min[1] = boxes.center_y[i] - boxes.extent_y[i];
+  min[2] = boxes.center_z[i] - boxes.extent_z[i];
+  max[0] = boxes.center_x[i] + boxes.extent_x[i];
+  max[1] = boxes.center_y[i] + boxes.extent_y[i];
+  max[2] = boxes.center_z[i] + boxes.extent_z[i];
+}
+
+inline float center_of(const culling::BoxSet &boxes, uint32_t i, int axis)
+{
+  return axis == 0 ? boxes.center_x[i] : (axis == 1 ? boxes.center_y[i] : boxes.center_z[i]);
+}
+
+inline float half_area(const float min[3], const float max[3])
+{
+  float dx = max[0] - min[0], dy = max[1] - min[1], dz = max[2] - min[2];
+  return dx * dy + dy * dz + dz * dx;
+}
+
+// 노드 bounds를 item 구간의 합집합으로 다시 계산한다.
+inline void fit_leaf(Bvh &tree, const culling::BoxSet &boxes, Node &node)
+{
+  culling::Aabb bounds = culling::empty_aabb();
+  for (uint32_t k = node.first; k < node.first + node.count; ++k)
+  {
+    float min[3], max[3];
+    box_of(boxes, tree.items[k], min, max);
+    culling::grow(bounds, min);
+    culling::grow(bounds, max);
+  }
+  std::copy(bounds.min, bounds.min + 3, node.min);
+  std::copy(bounds.max, bounds.max + 3, node.max);
+}
+
+inline void fit_internal(Bvh &tree, Node &node)
+{
+  const Node &l = tree.nodes[node.left];
+  const Node &r = tree.nodes[node.left + 1];
+  for (int k = 0; k < 3; ++k)
+  {
+    node.min[k] = std::min(l.min[k], r.min[k]);
+    node.max[k] = std::max(l.max[k], r.max[k]);
+  }
+}
+
+// build 중에만 쓰는 item 사본. BoxSet을 item 순서대로 건너뛰며 읽으면 캐시를 계속 놓치므로
+// 필요한 값을 한곳에 모아 두고 이 배열을 직접 나눈다.
+struct BuildItem
+{
+  float min[3];
+  float max[3];
+  float center[3];
+  uint32_t item;
+};
+
+inline void fit_build_items(const BuildItem *begin, const BuildItem *end, Node &node)
+{
+  culling::Aabb bounds = culling::empty_aabb();
+  for (const BuildItem *it = begin; it != end; ++it)
+  {
+    culling::grow(bounds, it->min);
+    culling::grow(bounds, it->max);
+  }
+  std::copy(bounds.min, bounds.min + 3, node.min);
+  std::copy(bounds.max, bounds.max + 3, node.max);
+}
+
+// 중심점이 가장 넓게 퍼진 축을 num_bins개 구간으로 나눠 담고 SAH 비용이 가장 작은
+// 경계를 찾는다. (세 축을 모두 보는 것보다 build가 세 배 빠르고 트리 품질 차이는 작다)
+// 나누는 편이 잎으로 두는 것보다 비싸면 false.
+inline bool find_split(const BuildItem *begin, const BuildItem *end, const Node &node,
+                       int *best_axis, float *best_position)
+{
+  float cmin[3], cmax[3];
+  for (int k = 0; k < 3; ++k)
+  {
+    cmin[k] = std::numeric_limits<float>::max();
+    cmax[k] = -std::numeric_limits<float>::max();
+  }
+  for (const BuildItem *it = begin; it != end; ++it)
+  {
+    for (int axis = 0; axis < 3; ++axis)
+    {
+      cmin[axis] = std::min(cmin[axis], it->center[axis]);
+      cmax[axis] = std::max(cmax[axis], it->center[axis]);
+    }
+  }
+
+  int axis = 0;
+  for (int k = 1; k < 3; ++k)
+  {
+    if (cmax[k] - cmin[k] > cmax[axis] - cmin[axis])
+      axis = k;
+  }
+
+  float best_cost = std::numeric_limits<float>::max();
+  if (cmax[axis] > cmin[axis])
+  {
+
+    struct Bin
+    {
+      culling::Aabb bounds;
+      uint32_t count;
+    } bins[num_bins];
+    for (unsigned b = 0; b < num_bins; ++b)
+    {
+      bins[b].bounds = culling::empty_aabb();
+      bins[b].count = 0;
+    }
+
+    float scale = num_bins / (cmax[axis] - cmin[axis]);
+    for (const BuildItem *it = begin; it != end; ++it)
+    {
+      unsigned b = std::min(num_bins - 1, unsigned((it->center[axis] - cmin[axis]) * scale));
+      culling::grow(bins[b].bounds, it->min);
+      culling::grow(bins[b].bounds, it->max);
+      bins[b].count += 1;
+    }
+
+    // 왼쪽부터 누적한 넓이/개수와 오른쪽부터 누적한 것을 경계마다 더한다.
+    float left_area[num_bins - 1];
+    uint32_t left_count[num_bins - 1];
+    culling::Aabb acc = culling::empty_aabb();
+    uint32_t count = 0;
+    for (unsigned b = 0; b + 1 < num_bins; ++b)
+    {
+      if (bins[b].count > 0)
+      {
+        culling::grow(acc, bins[b].bounds.min);
+        culling::grow(acc, bins[b].bounds.max);
+      }
+      count += bins[b].count;
+      left_area[b] = count > 0 ? half_area(acc.min, acc.max) : 0.0f;
+      left_count[b] = count;
+    }
+
+    acc = culling::empty_aabb();
+    count = 0;
+    for (unsigned b = num_bins - 1; b > 0; --b)
+    {
+      if (bins[b].count > 0)
+      {
+        culling::grow(acc, bins[b].bounds.min);
+        culling::grow(acc, bins[b].bounds.max);
+      }
+      count += bins[b].count;
+      if (left_count[b - 1] == 0 || count == 0)
+        continue;
+
+      float cost = left_area[b - 1] * left_count[b - 1] + half_area(acc.min, acc.max) * count;
+      if (cost < best_cost)
+      {
+        best_cost = cost;
+        *best_axis = axis;
+        *best_position = cmin[axis] + b / scale;
+      }
+    }
+  }
+
+  // 잎으로 두는 비용은 (넓이 * item 수), 나누는 비용에는 노드 하나를 더 지나는 값을 더한다.
+  if (best_cost == std::numeric_limits<float>::max())
+    return false;
+  float area = half_area(node.min, node.max);
+  return node.count > max_leaf_size || best_cost + area < area * node.count;
+}
+
+// boxes 중 items에 든 상자들로 트리를 새로 만든다.
+inline void build(Bvh &tree, const culling::BoxSet &boxes, const std::vector<uint32_t> &items)
+{
+  tree.nodes.clear();
+  tree.items.clear();
+  tree.parent.clear();
+  tree.leaf_of.assign(boxes.size(), no_node);
+  tree.stale.clear();
+  if (items.empty())
+    return;
+
+  std::vector<BuildItem> build_items(items.size());
+  for (size_t i = 0; i < items.size(); ++i)
+  {
+    BuildItem &b = build_items[i];
+    b.item = items[i];
+    box_of(boxes, b.item, b.min, b.max);
+    b.center[0] = boxes.center_x[b.item];
+    b.center[1] = boxes.center_y[b.item];
+    b.center[2] = boxes.center_z[b.item];
+  }
+
+  tree.nodes.reserve(2 * items.size());
+  tree.parent.reserve(2 * items.size());
+
+  Node root;
+  root.first = 0;
+  root.count = static_cast<uint32_t>(items.size());
+  tree.nodes.push_back(root);
+  tree.parent.push_back(no_node);
+
+  std::vector<uint32_t> stack(1, 0);
+  while (!stack.empty())
+  {
+    uint32_t index = stack.back();
+    stack.pop_back();
+
+    BuildItem *begin = build_items.data() + tree.nodes[index].first;
+    BuildItem *end = begin + tree.nodes[index].count;
+    fit_build_items(begin, end, tree.nodes[index]);
+    Node node = tree.nodes[index];
+
+    int axis = -1;
+    float position = 0.0f;
+    uint32_t middle = node.first;
+    if (node.count > 1 && find_split(begin, end, node, &axis, &position))
+    {
+      middle = static_cast<uint32_t>(
+          std::partition(begin, end, [&](const BuildItem &b) {
+            return b.center[axis] < position;
+          }) -
+          build_items.data());
+
+      // 중심이 모두 한쪽에 몰리면(같은 위치의 상자가 많을 때) 가운데에서 나눈다.
+      if (middle == node.first || middle == node.first + node.count)
+      {
+        middle = node.first + node.count / 2;
+        std::nth_element(begin, build_items.data() + middle, end,
+                         [&](const BuildItem &a, const BuildItem &b) {
+                           return a.center[axis] < b.center[axis];
+                         });
+      }
+    }
+    else if (node.count > max_leaf_size)
+    {
+      // 중심이 모두 같은 점이면 SAH로 나눌 수 없으므로 개수로만 나눈다.
+      middle = node.first + node.count / 2;
+    }
+
+    if (middle == node.first)
+    {
+      for (const BuildItem *it = begin; it != end; ++it)
+        tree.leaf_of[it->item] = index;
+      continue;
+    }
+
+    uint32_t left = static_cast<uint32_t>(tree.nodes.size());
+    Node child;
+    child.first = node.first;
+    child.count = middle - node.first;
+    tree.nodes.push_back(child);
+    child.first = middle;
+    child.count = node.first + node.count - middle;
+    tree.nodes.push_back(child);
+    tree.parent.push_back(index);
+    tree.parent.push_back(index);
+    tree.nodes[index].left = left;
+
+    stack.push_back(left + 1);
+    stack.push_back(left);
+  }
+
+  tree.items.resize(build_items.size());
+  for (size_t i = 0; i < build_items.size(); ++i)
+    tree.items[i] = build_items[i].item;
+}
+
+// 모든 노드를 인덱스 역순으로 한 번 돌며 다시 맞춘다.
+inline void refit_all(Bvh &tree, const culling::BoxSet &boxes)
+{
+  for (size_t i = tree.nodes.size(); i > 0; --i)
+  {
+    Node &node = tree.nodes[i - 1];
+    if (node.is_leaf())
+      fit_leaf(tree, boxes, node);
+    else
+      fit_internal(tree, node);
+  }
+}
+
+// 상자 num_changed개를 refit한 뒤 질의하는 편이 모든 상자를 선형으로 컬링하는 것보다 싼지
+inline bool refit_beats_linear_cull(const Bvh &tree, size_t num_changed)
+{
+  return num_changed * refit_linear_ratio <= tree.items.size();
+}
+
+// changed에 든 상자(BoxSet 인덱스)가 바뀐 뒤, 그 잎에서 루트까지의 노드만 다시 맞춘다.
+// 상자가 1/4 넘게 바뀌면 경로를 따라가는 것보다 모든 노드를 역순으로 한 번 도는 편이 빠르다.
+inline void refit(Bvh &tree, const culling::BoxSet &boxes, const std::vector<uint32_t> &changed)
+{
+  if (tree.nodes.empty())
+    return;
+
+  if (changed.size() * 4 > tree.items.size())
+  {
+    refit_all(tree, boxes);
+    return;
+  }
+  tree.stale.resize(tree.nodes.size(), 0);
+
+  std::vector<uint32_t> stale_nodes;
+  for (uint32_t item : changed)
+  {
+    if (item >= tree.leaf_of.size())
+      continue;
+    for (uint32_t index = tree.leaf_of[item]; index != no_node && !tree.stale[index];
+         index = tree.parent[index])
+    {
+      tree.stale[index] = 1;
+      stale_nodes.push_back(index);
+    }
+  }
+
+  std::sort(stale_nodes.begin(), stale_nodes.end());
+  for (size_t i = stale_nodes.size(); i > 0; --i)
+  {
+    uint32_t index = stale_nodes[i - 1];
+    Node &node = tree.nodes[index];
+    if (node.is_leaf())
+      fit_leaf(tree, boxes, node);
+    else
+      fit_internal(tree, node);
+    tree.stale[index] = 0;
+  }
+}
+
+// 평면 p의 바깥이면 -1, 완전히 안쪽이면 1, 걸치면 0
+inline int classify(const float plane[4], const float min[3], const float max[3])
+{
+  float distance = 0.0f, radius = 0.0f;
+  for (int k = 0; k < 3; ++k)
+  {
+    float c = 0.5f * (min[k] + max[k]);
+    float e = 0.5f * (max[k] - min[k]);
+    distance += plane[k] * c;
+    radius += std::fabs(plane[k]) * e;
+  }
+  distance += plane[3];
+  if (distance + radius < 0.0f)
+    return -1;
+  return distance - radius >= 0.0f ? 1 : 0;
+}
+
+// 절두체와 겹치는 item을 out에 덧붙인다. 노드가 어떤 평면의 완전히 안쪽이면 그 평면은
+// 자식에서 다시 보지 않고, 모든 평면의 안쪽이면 아래 item을 검사 없이 통째로 내보낸다.
+inline void query_frustum(const Bvh &tree, const culling::BoxSet &boxes,
+                          const culling::Frustum &frustum, std::vector<uint32_t> &out)
+{
+  if (tree.nodes.empty())
+    return;
+
+  std::vector<std::pair<uint32_t, unsigned>> stack; // (노드, 아직 걸치는 평면 비트)
+  stack.push_back(std::make_pair(0u, 0x3fu));
+  while (!stack.empty())
+  {
+    uint32_t index = stack.back().first;
+    unsigned planes = stack.back().second;
+    stack.pop_back();
+
+    const Node &node = tree.nodes[index];
+    bool outside = false;
+    for (int p = 0; p < 6 && !outside; ++p)
+    {
+      if (!(planes & (1u << p)))
+        continue;
+      int side = classify(frustum.planes[p], node.min, node.max);
+      if (side < 0)
+        outside = true;
+      else if (side > 0)
+        planes &= ~(1u << p);
+    }
+    if (outside)
+      continue;
+
+    if (planes == 0)
+    {
+      out.insert(out.end(), tree.items.begin() + node.first,
+                 tree.items.begin() + node.first + node.count);
+      continue;
+    }
+
+    if (!node.is_leaf())
+    {
+      stack.push_back(std::make_pair(node.left + 1, planes));
+      stack.push_back(std::make_pair(node.left, planes));
+      continue;
+    }
+
+    for (uint32_t k = node.first; k < node.first + node.count; ++k)
+    {
+      uint32_t item = tree.items[k];
+      float min[3], max[3];
+      box_of(boxes, item, min, max);
+      bool visible = true;
+      for (int p = 0; p < 6 && visible; ++p)
+      {
+        if (planes & (1u << p))
+          visible = classify(frustum.planes[p], min, max) >= 0;
+      }
+      if (visible)
+        out.push_back(item);
+    }
+  }
+}
+
+// 광선 o + t * d (0 <= t <= t_max)와 상자의 slab 교차. 만나면 들어가는 t를 돌려준다.
+inline bool intersect_ray(const float origin[3], const float inv_direction[3], float t_max,
+                          const float min[3], const float max[3], float *t_enter)
+{
+  float t0 = 0.0f, t1 = t_max;
+  for (int k = 0; k < 3; ++k)
+  {
+    float a = (min[k] - origin[k]) * inv_direction[k];
+    float b = (max[k] - origin[k]) * inv_direction[k];
+    t0 = std::max(t0, std::min(a, b));
+    t1 = std::min(t1, std::max(a, b));
+  }
+  *t_enter = t0;
+  return t0 <= t1;
+}
+
+// 광선이 지나는 item을 out에 덧붙인다. (상자 단위 판정, 순서는 정하지 않는다)
+inline void query_ray(const Bvh &tree, const culling::BoxSet &boxes, const float origin[3],
+                      const float direction[3], float t_max, std::vector<uint32_t> &out)
+{
+  if (tree.nodes.empty())
+    return;
+
+  float inv_direction[3];
+  for (int k = 0; k < 3; ++k)
+    inv_direction[k] = 1.0f / direction[k];
+
+  std::vector<uint32_t> stack(1, 0);
+  while (!stack.empty())
+  {
+    const Node &node = tree.nodes[stack.back()];
+    stack.pop_back();
+
+    float t;
+    if (!intersect_ray(origin, inv_direction, t_max, node.min, node.max, &t))
+      continue;
+
+    if (!node.is_leaf())
+    {
+      stack.push_back(node.left + 1);
+      stack.push_back(node.left);
+      continue;
+    }
+
+    for (uint32_t k = node.first; k < node.first + node.count; ++k)
+    {
+      float min[3], max[3];
+      box_of(boxes, tree.items[k], min, max);
+      if (intersect_ray(origin, inv_direction, t_max, min, max, &t))
+        out.push_back(tree.items[k]);
+    }
+  }
+}
+
+inline bool overlaps(const culling::Aabb &box, const float min[3], const float max[3])
+{
+  return box.min[0] <= max[0] && min[0] <= box.max[0] &&
+         box.min[1] <= max[1] && min[1] <= box.max[1] &&
+         box.min[2] <= max[2] && min[2] <= box.max[2];
+}
+
+// box와 겹치는 item을 out에 덧붙인다.
+inline void query_box(const Bvh &tree, const culling::BoxSet &boxes, const culling::Aabb &box,
+                      std::vector<uint32_t> &out)
+{
+  if (tree.nodes.empty())
+    return;
+
+  std::vector<uint32_t> stack(1, 0);
+  while (!stack.empty())
+  {
+    const Node &node = tree.nodes[stack.back()];
+    stack.pop_back();
+
+    if (!overlaps(box, node.min, node.max))
+      continue;
+
+    if (!node.is_leaf())
+    {
+      stack.push_back(node.left + 1);
+      stack.push_back(node.left);
+      continue;
+    }
+
+    for (uint32_t k = node.first; k < node.first + node.count; ++k)
+    {
+      float min[3], max[3];
+      box_of(boxes, tree.items[k], min, max);
+      if (overlaps(box, min, max))
+        out.push_back(tree.items[k]);
+    }
+  }
+}
+} // namespace bvh
+
+#endif // BVH_HPP
@@ -0,0 +1,306 @@
+#ifndef CULLING_HPP
+#define CULLING_HPP
+
+// 절두체 컬링
+//
+// primitive마다 로컬 AABB를 한 번 구해 두고, 프레임마다 world 행렬로 변환한 상자를
+// 중심/반지름(extent) SoA 배열에 모은 뒤 view-projection 행렬에서 뽑은 6개 평면과 비교한다.
+// 상자가 한 평면이라도 완전히 바깥에 있으면 보이지 않는 것으로 본다. (보수적인 판정이라
+// 실제로는 안 보이는 상자가 남을 수는 있어도, 보이는 상자를 버리지는 않는다)
+//
+// x86(GCC/Clang)에서는 SSE로 4개, AVX로 8개씩 검사하는 경로를 함수 target 속성으로
+// 컴파일해 두고 실행 시 한 번 고른다. CULLING_NO_SIMD를 정의하면 스칼라 경로만 쓴다.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__)) && !defined(CULLING_NO_SIMD)
+#define CULLING_X86 1
+#include <immintrin.h>
+#endif
+
+namespace culling
+{
+struct Aabb
+{
+  float min[3];
+  float max[3];
+};
+
+// 아직 점을 하나도 넣지 않은 상자 (min > max)
+inline Aabb empty_aabb()
+{
+  Aabb box;
+  for (int k = 0; k < 3; ++k)
+  {
+    box.min[k] = std::numeric_limits<float>::max();
+    box.max[k] = -std::numeric_limits<float>::max();
+  }
+  return box;
+}
+
+inline void grow(Aabb &box, const float p[3])
+{
+  for (int k = 0; k < 3; ++k)
+  {
+    box.min[k] = std::min(box.min[k], p[k]);
+    box.max[k] = std::max(box.max[k], p[k]);
+  }
+}
+
+inline bool is_valid(const Aabb &box)
+{
+  return box.min[0] <= box.max[0] && box.min[1] <= box.max[1] && box.min[2] <= box.max[2];
+}
+
+// ax + by + cz + d >= 0 이면 안쪽. 순서는 left, right, bottom, top, near, far.
+struct Frustum
+{
+  float planes[6][4];
+};
+
+// 열 우선(column major) view-projection 행렬에서 clip 공간의 6개 평면을 뽑는다.
+// (Gribb/Hartmann) 판정은 부호만 보므로 평면을 정규화하지 않는다.
+inline Frustum extract_frustum(const float *m)
+{
+  Frustum frustum;
+  for (int i = 0; i < 6; ++i)
+  {
+    int row = i / 2;
+    float sign = (i % 2 == 0) ? 1.0f : -1.0f;
+    for (int c = 0; c < 4; ++c)
+      frustum.planes[i][c] = m[c * 4 + 3] + sign * m[c * 4 + row];
+  }
+  return frustum;
+}
+
+// world 공간 상자들의 SoA 배열 (중심과 반지름)
+struct BoxSet
+{
+  std::vector<float> center_x, center_y, center_z;
+  std::vector<float> extent_x, extent_y, extent_z;
+
+  size_t size() const
+  {
+    return center_x.size();
+  }
+
+  void clear()
+  {
+    center_x.clear();
+    center_y.clear();
+    center_z.clear();
+    extent_x.clear();
+    extent_y.clear();
+    extent_z.clear();
+  }
+
+  void resize(size_t n)
+  {
+    center_x.resize(n);
+    center_y.resize(n);
+    center_z.resize(n);
+    extent_x.resize(n);
+    extent_y.resize(n);
+    extent_z.resize(n);
+  }
+
+  void set(size_t i, const float center[3], const float extent[3])
+  {
+    center_x[i] = center[0];
+    center_y[i] = center[1];
+    center_z[i] = center[2];
+    extent_x[i] = extent[0];
+    extent_y[i] = extent[1];
+    extent_z[i] = extent[2];
+  }
+
+  void push_back(const float center[3], const float extent[3])
+  {
+    resize(size() + 1);
+    set(size() - 1, center, extent);
+  }
+
+  // 로컬 상자를 열 우선 행렬 m(affine)으로 변환해 i번째에 넣는다. (Arvo)
+  // 새 중심은 m * 중심, 새 반지름의 각 축은 |m|의 행과 반지름의 내적이다.
+  void set(size_t i, const float *m, const Aabb &box)
+  {
+    float c[3], e[3], center[3], extent[3];
+    for (int k = 0; k < 3; ++k)
+    {
+      c[k] = 0.5f * (box.min[k] + box.max[k]);
+      e[k] = 0.5f * (box.max[k] - box.min[k]);
+    }
+    for (int r = 0; r < 3; ++r)
+    {
+      center[r] = m[12 + r];
+      extent[r] = 0.0f;
+      for (int k = 0; k < 3; ++k)
+      {
+        center[r] += m[k * 4 + r] * c[k];
+        extent[r] += std::fabs(m[k * 4 + r]) * e[k];
+      }
+    }
+    set(i, center, extent);
+  }
+
+  // 컬링하지 않을 상자 (bounds를 모르는 primitive). 반지름이 무한대라 항상 보인다.
+  void set_unbounded(size_t i)
+  {
+    const float center[3] = {0.0f, 0.0f, 0.0f};
+    const float inf = std::numeric_limits<float>::infinity();
+    const float extent[3] = {inf, inf, inf};
+    set(i, center, extent);
+  }
+
+  bool is_unbounded(size_t i) const
+  {
+    return std::isinf(extent_x[i]);
+  }
+};
+
+// 평면마다 중심까지의 거리 + 반지름을 평면 법선 방향으로 투영한 길이가 음수면 바깥이다.
+// [begin, end) 구간의 결과를 visible[i]에 0/1로 쓰고 보이는 상자 수를 돌려준다.
+inline size_t cull_boxes_scalar(const Frustum &frustum, const BoxSet &boxes,
+                                size_t begin, size_t end, unsigned char *visible)
+{
+  size_t num_visible = 0;
+  for (size_t i = begin; i < end; ++i)
+  {
+    bool inside = true;
+    for (int p = 0; p < 6 && inside; ++p)
+    {
+      const float *plane = frustum.planes[p];
+      float distance = plane[0] * boxes.center_x[i] + plane[1] * boxes.center_y[i] +
+                       plane[2] * boxes.center_z[i] + plane[3];
+      float radius = std::fabs(plane[0]) * boxes.extent_x[i] +
+                     std::fabs(plane[1]) * boxes.extent_y[i] +
+                     std::fabs(plane[2]) * boxes.extent_z[i];
+      inside = !(distance + radius < 0.0f);
+    }
+    visible[i] = inside ? 1 : 0;
+    num_visible += inside ? 1 : 0;
+  }
+  return num_visible;
+}
+
+#ifdef CULLING_X86
+__attribute__((target("sse2"))) inline size_t cull_boxes_sse(
+    const Frustum &frustum, const BoxSet &boxes, unsigned char *visible)
+{
+  const size_t n = boxes.size();
+  size_t num_visible = 0;
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4)
+  {
+    __m128 cx = _mm_loadu_ps(&boxes.center_x[i]);
+    __m128 cy = _mm_loadu_ps(&boxes.center_y[i]);
+    __m128 cz = _mm_loadu_ps(&boxes.center_z[i]);
+    __m128 ex = _mm_loadu_ps(&boxes.extent_x[i]);
+    __m128 ey = _mm_loadu_ps(&boxes.extent_y[i]);
+    __m128 ez = _mm_loadu_ps(&boxes.extent_z[i]);
+
+    __m128 outside = _mm_setzero_ps();
+    for (int p = 0; p < 6; ++p)
+    {
+      const float *plane = frustum.planes[p];
+      __m128 distance = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[0]), cx),
+                     _mm_mul_ps(_mm_set1_ps(plane[1]), cy)),
+          _mm_add_ps(_mm_mul_ps(_mm_set1_ps(plane[2]), cz), _mm_set1_ps(plane[3])));
+      __m128 radius = _mm_add_ps(
+          _mm_add_ps(_mm_mul_ps(_mm_set1_ps(std::fabs(plane[0])), ex),
+                     _mm_mul_ps(_mm_set1_ps(std::fabs(plane[1])), ey)),
+          _mm_mul_ps(_mm_set1_ps(std::fabs(plane[2])), ez));
+      outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+    }
+
+    int mask = _mm_movemask_ps(outside);
+    for (int k = 0; k < 4; ++k)
+    {
+      visible[i + k] = (mask >> k) & 1 ? 0 : 1;
+      num_visible += (mask >> k) & 1 ? 0 : 1;
+    }
+  }
+  return num_visible + cull_boxes_scalar(frustum, boxes, i, n, visible);
+}
+
+__attribute__((target("avx"))) inline size_t cull_boxes_avx(
+    const Frustum &frustum, const BoxSet &boxes, unsigned char *visible)
+{
+  const size_t n = boxes.size();
+  size_t num_visible = 0;
+  size_t i = 0;
+  for (; i + 8 <= n; i += 8)
+  {
+    __m256 cx = _mm256_loadu_ps(&boxes.center_x[i]);
+    __m256 cy = _mm256_loadu_ps(&boxes.center_y[i]);
+    __m256 cz = _mm256_loadu_ps(&boxes.center_z[i]);
+    __m256 ex = _mm256_loadu_ps(&boxes.extent_x[i]);
+    __m256 ey = _mm256_loadu_ps(&boxes.extent_y[i]);
+    __m256 ez = _mm256_loadu_ps(&boxes.extent_z[i]);
+
+    __m256 outside = _mm256_setzero_ps();
+    for (int p = 0; p < 6; ++p)
+    {
+      const float *plane = frustum.planes[p];
+      __m256 distance = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane[0]), cx),
+                        _mm256_mul_ps(_mm256_set1_ps(plane[1]), cy)),
+          _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(plane[2]), cz), _mm256_set1_ps(plane[3])));
+      __m256 radius = _mm256_add_ps(
+          _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(std::fabs(plane[0])), ex),
+                        _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane[1])), ey)),
+          _mm256_mul_ps(_mm256_set1_ps(std::fabs(plane[2])), ez));
+      outside = _mm256_or_ps(outside, _mm256_cmp_ps(_mm256_add_ps(distance, radius),
+                                                    _mm256_setzero_ps(), _CMP_LT_OQ));
+    }
+
+    int mask = _mm256_movemask_ps(outside);
+    for (int k = 0; k < 8; ++k)
+    {
+      visible[i + k] = (mask >> k) & 1 ? 0 : 1;
+      num_visible += (mask >> k) & 1 ? 0 : 1;
+    }
+  }
+  return num_visible + cull_boxes_scalar(frustum, boxes, i, n, visible);
+}
+#endif // CULLING_X86
+
+inline size_t cull_boxes_scalar_all(const Frustum &frustum, const BoxSet &boxes,
+                                    unsigned char *visible)
+{
+  return cull_boxes_scalar(frustum, boxes, 0, boxes.size(), visible);
+}
+
+typedef size_t (*CullFunction)(const Frustum &, const BoxSet &, unsigned char *);
+
+inline CullFunction select_cull_function()
+{
+#ifdef CULLING_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx"))
+    return &cull_boxes_avx;
+  if (__builtin_cpu_supports("sse2"))
+    return &cull_boxes_sse;
+#endif
+  return &cull_boxes_scalar_all;
+}
+
+// boxes 전체를 검사해 visible(상자 수만큼 크기를 맞춘다)에 결과를 쓰고 보이는 상자 수를 돌려준다.
+inline size_t cull_boxes(const Frustum &frustum, const BoxSet &boxes,
+                         std::vector<unsigned char> &visible)
+{
+  static const CullFunction cull = select_cull_function();
+  visible.resize(boxes.size());
+  if (boxes.size() == 0)
+    return 0;
+  return cull(frustum, boxes, visible.data());
+}
+} // namespace culling
+
+#endif // CULLING_HPP
@@ -5,10 +5,28 @@
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+// --batch의 헤드리스 컨텍스트. X11 헤더는 쓰지 않는다.
+#define EGL_NO_X11
+#define MESA_EGL_NO_X11_HEADERS
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
 #include <iostream>
 #include <string>
 #include <fstream>
+#include <sstream>
 #include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 #define TINYGLTF_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -17,6 +35,14 @@
 #include "../glTF/tiny_gltf.h"
 #define BUFFER_OFFSET(i) ((char *)0 + (i))
 
+#include "scene_cache.hpp"
+#include "culling.hpp"
+#include "bvh.hpp"
+#include "mesh_optimizer.hpp"
+#include "quantization.hpp"
+#include "vertex_layout.hpp"
+#include "program_cache.hpp"
+
 #include "../common/transform.hpp"
 
 namespace kmuvcl
@@ -82,36 +108,52 @@ void init_state();
 ////////////////////////////////////////////////////////////////////////////////
 /// 쉐이더 관련 변수 및 함수
 ////////////////////////////////////////////////////////////////////////////////
-GLuint program; // 쉐이더 프로그램 객체의 레퍼런스 값
-GLint loc_a_position;
-GLint loc_a_color;
-GLint loc_a_normal;
-GLint loc_a_texcoord;
-
-GLint loc_u_PVM;
-GLint loc_u_M;
-
-GLint loc_u_view_position_wc;
-GLint loc_u_light_position_wc;
-
-GLint loc_u_light_ambient; // uniform 변수 u_light_ambient 위치
-GLint loc_u_light_diffuse;
-GLint loc_u_light_specular;
-
-GLint loc_u_material_ambient; // uniform 변수 u_material_ambient 위치
-GLint loc_u_material_specular;
-GLint loc_u_material_shininess;
-
-GLint loc_u_diffuse_texture;
-
-GLuint create_shader_from_file(const std::string &filename, GLuint shader_type);
-void init_shader_program();
+// 정점 attribute 위치는 링크 전에 고정해 두고, 모든 VAO가 같은 위치를 사용한다.
+const GLint loc_a_position = 0;
+const GLint loc_a_normal = 1;
+const GLint loc_a_texcoord = 2;
+const GLint loc_a_color = 3;
+const GLint loc_a_model = 4; // instance별 world 행렬 (mat4라 4~7번을 차지한다)
+
+// 카메라/조명(FrameBlock)과 material 상수(MaterialBlock)는 uniform block으로 받는다.
+// 블록마다 binding 번호를 고정해 두고, 그릴 때는 그 번호에 버퍼 구간만 바인딩한다.
+const GLuint frame_block_binding = 0;
+const GLuint material_block_binding = 1;
+
+// 셰이더 permutation: shader/*.glsl 한 벌에 기능 비트에 맞는 #define을 붙여 program을 만든다.
+// primitive마다 가진 attribute와 material에 맞는 비트만 켜서, 법선이나 정점 색, 텍스처가 없는
+// primitive는 그 attribute를 읽지도, 그 계산을 하지도 않는 program으로 그린다.
+enum ShaderFeature
+{
+  SHADER_NORMAL = 1 << 0,             // HAS_NORMAL
+  SHADER_OCTAHEDRAL_NORMALS = 1 << 1, // OCTAHEDRAL_NORMALS (NORMAL이 팔면체 인코딩된 primitive)
+  SHADER_COLOR = 1 << 2,              // HAS_COLOR
+  SHADER_TEXCOORD = 1 << 3,           // HAS_TEXCOORD (TEXCOORD_0가 있고 material에 baseColorTexture가 있을 때)
+  SHADER_ALPHA_MASK = 1 << 4,         // ALPHA_MASK (alphaMode MASK: alphaCutoff보다 작으면 버린다)
+  SHADER_ALPHA_BLEND = 1 << 5,        // ALPHA_BLEND (alphaMode BLEND: base color의 alpha를 내보낸다)
+};
+std::map<uint32_t, GLuint> shader_programs; // 기능 비트 -> program (장면이 쓰는 조합만 만든다)
+
+// 링크된 program의 바이너리 캐시 (program_cache.hpp). --no-program-cache로 끈다.
+// 기본은 shader/ 아래에 두고, --cache-dir=<디렉터리>를 주면 scene 캐시와 같은 디렉터리에 둔다.
+bool use_program_cache = true;
+
+std::string program_cache_path();
+std::string read_shader_source(const std::string &filename);
+std::string shader_source_with_features(const std::string &source, uint32_t features);
+GLuint create_shader(const std::string &source, GLuint shader_type);
+bool check_program_link(GLuint program, GLuint vertex_shader, GLuint fragment_shader);
+void setup_program(GLuint program);
+void init_shader_programs();
+void assign_shader_programs(const std::vector<std::vector<uint32_t>> &object_features);
+void delete_shader_programs();
 ////////////////////////////////////////////////////////////////////////////////
 
 ////////////////////////////////////////////////////////////////////////////////
 /// 변환 관련 변수 및 함수
 ////////////////////////////////////////////////////////////////////////////////
 kmuvcl::math::mat4x4f mat_model, mat_view, mat_proj;
+kmuvcl::math::mat4x4f mat_VP; // 프레임마다 한 번 계산하는 mat_proj * mat_view (u_VP)
 kmuvcl::math::mat4x4f mat_PVM;
 
 void set_transform();
@@ -128,13 +170,87 @@ int camera_index = 0;
 ////////////////////////////////////////////////////////////////////////////////
 tinygltf::Model model;
 
-GLuint color_buffer;
-GLuint position_buffer;
-GLuint normal_buffer;
-GLuint texcoord_buffer;
-GLuint index_buffer;
+// bufferView 인덱스별 VBO. 같은 bufferView를 참조하는 accessor/primitive는 하나의 VBO를 공유한다.
+std::vector<GLuint> buffer_objects;
+
+// 로드 시점에 primitive마다 한 번 만들어 두는 그리기 정보
+struct PrimitiveObject
+{
+  GLuint vao = 0;
+  GLenum mode = GL_TRIANGLES;
+  GLsizei count = 0;      // 인덱스 개수 (인덱스가 없으면 정점 개수)
+  GLenum index_type = 0;  // 0이면 glDrawArrays로 그린다.
+  size_t index_offset = 0;
+  int material = -1;
+
+  uint32_t attribute_features = 0; // 가진 attribute로 정해지는 ShaderFeature 비트 (SHADER_TEXCOORD는 TEXCOORD_0)
+  GLuint program = 0;              // init_shader_programs()에서 material까지 보고 정한다.
+
+  culling::Aabb bounds = culling::empty_aabb(); // 로컬 AABB. 구할 수 없으면 비어 있고 컬링하지 않는다.
+
+  // 공유 아레나 안의 위치 (multi-draw 경로). in_arena가 false면 VAO로 하나씩 그린다.
+  bool in_arena = false;
+  GLuint arena_first_index = 0;
+  GLint arena_base_vertex = 0;
+};
+std::vector<std::vector<PrimitiveObject>> primitive_objects; // [mesh][primitive]
+
+// multi-draw indirect 경로: 모든 primitive의 정점을 공통 형식으로 한 버퍼에, 인덱스를 uint32로
+// 한 버퍼에 모아 두고, 보이는 primitive를 DrawElementsIndirectCommand로 적어 버킷마다
+// glMultiDrawElementsIndirect 한 번으로 그린다. instance 행렬은 baseInstance로 찾아간다.
+struct ArenaVertex
+{
+  float position[3];
+  float normal[3];
+  float texcoord[2];
+  float color[3];
+};
+
+// --quantize일 때의 arena 정점. 위치는 메쉬별 복원 변환 전의 int16, 법선은 팔면체 int16 2개.
+struct QuantizedArenaVertex
+{
+  int16_t position[4];
+  int16_t normal[2];
+  uint16_t texcoord[2];
+  uint8_t color[4];
+};
 
-GLuint diffuse_texid;
+struct DrawElementsIndirectCommand
+{
+  GLuint count;
+  GLuint instance_count;
+  GLuint first_index;
+  GLint base_vertex;
+  GLuint base_instance;
+};
+
+bool multi_draw_supported = false; // GL 4.3 또는 ARB_multi_draw_indirect + ARB_base_instance
+bool use_multi_draw = true;        // M 키로 켜고 끈다. (끄면 arena의 primitive도 하나씩 그린다)
+GLuint arena_vao = 0;
+GLuint arena_vertex_buffer = 0;
+GLuint arena_index_buffer = 0;
+std::vector<DrawElementsIndirectCommand> indirect_commands;
+
+// init_arena_buffers()가 정한 primitive별 arena 위치. arena에 들어간 primitive의 bufferView는
+// VBO로 올리지 않고 VAO도 만들지 않는다. init_vertex_array_objects()가 PrimitiveObject로 옮긴다.
+struct ArenaPlacement
+{
+  bool in_arena = false;
+  GLuint first_index = 0;
+  GLint base_vertex = 0;
+};
+std::vector<std::vector<ArenaPlacement>> arena_placements; // [mesh][primitive]
+
+// 텍스처 관리: image마다 GL 텍스처 하나, 설정이 같은 sampler끼리 GL sampler 객체 하나.
+// 여러 texture/material이 같은 image를 참조해도 한 번만 올린다.
+struct TextureBinding
+{
+  GLuint texture = 0; // 0이면 올릴 image가 없는 텍스처
+  GLuint sampler = 0;
+};
+std::vector<GLuint> image_textures;            // [image]
+std::vector<GLuint> sampler_objects;           // 만든 GL sampler 객체 (해제용)
+std::vector<TextureBinding> texture_bindings;  // [texture] init_texture_objects()를 부른 스레드가 쓴다.
 
 kmuvcl::math::vec3f view_position_wc;
 
@@ -147,28 +263,483 @@ kmuvcl::math::vec4f material_ambient = kmuvcl::math::vec4f(0.3f, 0.0f, 0.0f, 1.0
 kmuvcl::math::vec4f material_specular = kmuvcl::math::vec4f(0.2f, 0.2f, 0.2f, 0.2f);
 float material_shininess = 1.3f;
 
+// uniform block의 std140 배치. shader/*.glsl의 블록 선언과 순서와 크기가 같아야 한다.
+struct FrameUniforms
+{
+  float VP[16];
+  float view_position_wc[4]; // vec3도 std140에서는 16바이트를 차지한다.
+  float light_position_wc[4];
+  float light_ambient[4];
+  float light_diffuse[4];
+  float light_specular[4];
+};
+
+struct MaterialUniforms
+{
+  float ambient[4];
+  float specular[4];
+  float base_color[4]; // baseColorFactor (텍스처가 있으면 셰이더에서 곱한다)
+  float emissive[4];   // emissiveFactor (w는 쓰지 않는다)
+  float shininess;
+  float alpha_cutoff;
+  float padding[2];
+};
+
+// material_records마다 MaterialUniforms 하나를 GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT 간격으로 담은 정적 UBO.
+GLuint material_buffer = 0;
+GLint uniform_buffer_alignment = 256;
+
+// load 때 tinygltf::Material을 한 번 풀어 둔 레코드. ParameterMap의 문자열 키는 여기서만 찾고,
+// 그릴 때는 primitive의 material 인덱스로 material_records만 읽는다.
+// Phong 셰이더가 쓰는 값만 푼다. metallic/roughness, normal, occlusion은 읽지 않는다.
+enum MaterialFeature
+{
+  MATERIAL_BASE_COLOR_TEXTURE = 1 << 0,
+  MATERIAL_EMISSIVE_TEXTURE = 1 << 1, // 샘플링하지 않으므로 emissiveFactor를 쓰지 않는다.
+  MATERIAL_DOUBLE_SIDED = 1 << 2,     // 뒷면을 컬링하지 않는다.
+};
+
+enum AlphaMode
+{
+  ALPHA_OPAQUE,
+  ALPHA_MASK,
+  ALPHA_BLEND,
+};
+
+struct MaterialRecord
+{
+  // 텍스처는 GL 이름까지 풀어 둔다. 없거나 올리지 못한 텍스처는 0이다.
+  TextureBinding base_color_texture;
+
+  float base_color_factor[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  float emissive_factor[3] = {0.0f, 0.0f, 0.0f};
+  float alpha_cutoff = 0.5f;
+  AlphaMode alpha_mode = ALPHA_OPAQUE; // BLEND는 블렌딩을 켜고 불투명한 패킷 뒤에 그린다.
+  uint32_t features = 0; // MaterialFeature 비트
+
+  GLintptr uniforms = 0; // material_buffer 안의 MaterialUniforms 위치
+};
+std::vector<MaterialRecord> material_records; // [material + 1] (0번: material이 없는 primitive, glTF 기본값)
+
+bool is_binary_gltf(const std::string &filename);
 bool load_model(tinygltf::Model &model, const std::string filename);
+
+// 원본을 읽은 뒤 인덱스 버퍼를 vertex cache, overdraw, vertex fetch 순으로 최적화한다.
+// (mesh_optimizer.hpp) 결과는 scene 캐시에 저장되므로 시간은 캐시를 만들 때 한 번만 든다.
+bool optimize_meshes = true;
+
+// --quantize: 정점 attribute를 int16 위치, 팔면체 법선, uint16 UV로 줄여서 올린다. (quantization.hpp)
+// 팔면체로 바뀐 법선은 primitive마다 accessor 형식을 보고 OCTAHEDRAL_NORMALS 조합으로 그린다.
+bool quantize_attributes = false;
+
+// scene 캐시 (scene_cache.hpp). 기본은 원본 옆의 "<파일 이름>.cache"이고, --cache-dir=<디렉터리>면
+// 그 디렉터리에 경로의 '/'를 '_'로 바꾼 이름으로 둔다. (다른 디렉터리의 같은 이름이 겹치지 않게)
+// --no-scene-cache면 읽지도 쓰지도 않는다. 창, --batch, --bench 모두 같은 설정을 따른다.
+bool use_scene_cache = true;
+std::string scene_cache_dir;
+bool scene_cache_hit = false; // 마지막 load_scene()이 캐시에서 읽었는지 (--bench가 결과에 적는다)
+
+// 정점 attribute 배치 (vertex_layout.hpp). 기본은 primitive마다 한 stream에 interleaved.
+// --vertex-layout=separate로 attribute마다 따로 두고, --packed-vertices로 4바이트 정렬을 뺀다.
+vertex_layout::Options vertex_layout_options;
+
+uint32_t scene_cache_options();
+void optimize_model_meshes();
+void quantize_model_attributes();
+void repack_vertex_attributes();
+std::vector<SceneCacheMesh> mesh_dequantization_records();
+void restore_mesh_dequantization(const std::vector<SceneCacheMesh> &records);
+std::string scene_cache_path(const std::string &filename);
+bool load_scene(const std::string &filename);
 void init_buffer_objects(); // VBO init 함수: GPU의 VBO를 초기화하는 함수.
-void init_texture_objects();
+GLuint upload_buffer_view(int buffer_view_index, GLenum default_target);
+void delete_buffer_objects();
+GLint attrib_location(const std::string &semantic);
+culling::Aabb primitive_bounds(const tinygltf::Primitive &primitive);
+void init_vertex_array_objects();
+void delete_vertex_array_objects();
+bool read_accessor_indices(int accessor_index, std::vector<GLuint> *indices);
+void init_arena_buffers();
+void init_geometry_arena();
+void delete_geometry_arena();
+void init_texture_objects(bool streaming);
+void delete_texture_objects();
+bool wait_fence(GLsync fence);
+TextureBinding compile_texture_binding(const std::vector<TextureBinding> &bindings,
+                                       const tinygltf::ParameterMap &values, const char *name,
+                                       MaterialFeature feature, uint32_t *features);
+MaterialRecord compile_material(const std::vector<TextureBinding> &bindings,
+                                const tinygltf::Material &material);
+void compile_materials(const std::vector<TextureBinding> &bindings);
+MaterialUniforms material_uniform_record(const MaterialRecord &material);
+void apply_material_state(const MaterialRecord &material);
+void init_material_uniforms();
+void delete_material_uniforms();
+bool is_mipmap_filter(int filter);
+GLuint create_sampler_object(int min_filter, int mag_filter, int wrap_s, int wrap_t);
+GLuint upload_image(const tinygltf::Image &image, bool generate_mipmaps);
+
+////////////////////////////////////////////////////////////////////////////////
+/// 비동기 로딩
+////////////////////////////////////////////////////////////////////////////////
+// 로더 스레드가 렌더 컨텍스트와 객체를 공유하는 보이지 않는 창의 컨텍스트에서 파일을 읽고 VBO와
+// 텍스처를 올리는 동안 창은 계속 그린다. 단계를 마칠 때마다 glFenceSync를 걸어 내보내면, 렌더
+// 스레드는 프레임마다 fence가 끝났는지 확인만 하고 끝난 단계를 가져간다.
+//  1. scene: load_scene()과 init_buffer_objects(). 렌더 스레드가 이어서 VAO, arena, material,
+//     program을 만들고 그리기 시작한다. (VAO는 컨텍스트끼리 공유되지 않는다)
+//  2. textures: texture_publish_bytes만큼 올릴 때마다 texture_bindings의 사본을 내보낸다. 렌더
+//     스레드는 그 사본으로 material을 다시 컴파일하므로 텍스처는 올라오는 대로 보인다.
+// --no-async-load이거나 sync object를 쓸 수 없으면 예전처럼 첫 프레임 전에 모두 올린다.
+bool async_loading = true;
+const size_t texture_publish_bytes = 8 * 1024 * 1024;
+
+struct TexturePublication
+{
+  GLsync fence;
+  std::vector<TextureBinding> bindings; // 그때까지 올린 texture_bindings
+  size_t num_images;                    // 그때까지 올린 image 수
+};
+
+struct ResourceLoader
+{
+  std::thread thread;
+  GLFWwindow *context = nullptr; // 렌더 컨텍스트와 공유하는 보이지 않는 창
+  std::atomic<bool> cancel{false};
+  std::chrono::steady_clock::time_point begin;
+
+  // 로더 스레드가 채우고 렌더 스레드가 가져간다. (mutex로 보호)
+  std::mutex mutex;
+  bool scene_published = false;
+  bool scene_loaded = false;
+  GLsync scene_fence = 0;
+  std::vector<TexturePublication> texture_publications;
+
+  size_t pending_bytes = 0; // 로더 스레드만 쓴다. 아직 내보내지 않은 텍스처 바이트
+};
+ResourceLoader resource_loader;
+bool scene_resident = false; // 렌더 스레드 쪽 객체까지 만들어져 그릴 수 있는 상태
+
+bool start_resource_loader(GLFWwindow *window, const std::string &filename);
+void run_resource_loader(std::string filename);
+void publish_textures();
+void poll_resource_loader(GLFWwindow *window);
+void stop_resource_loader();
+void init_scene_objects(const std::vector<TextureBinding> &bindings);
+void update_material_textures(const std::vector<TextureBinding> &bindings);
+void unload_scene();
+
+////////////////////////////////////////////////////////////////////////////////
+/// 헤드리스 배치 렌더링 (--batch)
+////////////////////////////////////////////////////////////////////////////////
+// 썸네일 생성용. 창 없이 EGL surfaceless 컨텍스트(GPU가 없으면 Mesa llvmpipe)를 만들고, 목록의
+// 모델과 카메라마다 FBO에 한 장씩 그려 PNG로 쓴다.
+// 목록 파일은 한 줄에 "모델 경로 [카메라 번호 ...]"이고 '#'으로 시작하는 줄은 건너뛴다. 카메라를
+// 적지 않으면 0번(모델에 카메라가 없으면 기본 시점)으로 그린다. 결과는 --batch-out 디렉터리에
+// "<목록의 줄 순서>_<모델 이름>_<카메라>.png"로 쓴다. (다른 디렉터리의 같은 이름이 겹치지 않게)
+// 읽어 오기는 PBO 두 개를 번갈아 써서 다음 장을 그리는 동안 복사가 끝나고, PNG 인코딩은 작업
+// 스레드들이 맡으므로 전체 속도는 그리기(와 로드)에 묶인다.
+// 에셋 디렉터리에 scene 캐시를 쓰지 않으려면 --cache-dir=<디렉터리>나 --no-scene-cache를 준다.
+// instance를 하나도 그리지 않은 장(카메라가 장면을 보지 못한 경우)은 경고하고 끝에 따로 센다.
+std::string batch_list_path;        // --batch=<목록 파일>. 비어 있으면 창을 띄운다.
+std::string batch_output_dir = "."; // --batch-out=<디렉터리>
+int batch_image_size = 256;         // --batch-size=<픽셀>
+
+struct BatchJob
+{
+  std::string model_path;
+  std::vector<int> cameras;
+};
+
+// 인코딩할 한 장. pixels는 RGBA이고 GL처럼 아래 줄부터 들어 있다.
+struct Thumbnail
+{
+  std::string path;
+  int width = 0;
+  int height = 0;
+  std::vector<unsigned char> pixels;
+};
+
+// PNG 인코딩 작업 스레드. 큐가 차면 렌더 스레드가 기다려서 메모리가 한없이 늘지 않는다.
+struct ThumbnailWriter
+{
+  std::vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable queue_changed;
+  std::deque<Thumbnail> queue;
+  size_t max_queued = 0;
+  bool closing = false;
+  size_t written = 0;
+  size_t failed = 0;
+};
+ThumbnailWriter thumbnail_writer;
+
+// FBO에서 PBO로 읽어 오는 중인 장. 두 칸을 번갈아 쓴다.
+struct ThumbnailReadback
+{
+  GLuint buffers[2] = {};
+  GLsync fences[2] = {};
+  std::string paths[2];
+  int slot = 0;
+  int size = 0;
+};
+
+// 헤드리스 모드(--batch, --bench)가 그리는 FBO. RGBA8 색과 24비트 깊이
+struct OffscreenTarget
+{
+  GLuint framebuffer = 0;
+  GLuint renderbuffers[2] = {}; // 색, 깊이
+  int size = 0;
+};
+
+bool read_batch_list(const std::string &path, std::vector<BatchJob> *jobs);
+std::string thumbnail_path(size_t job_index, const std::string &model_path, int camera);
+bool init_headless_context(EGLDisplay *display, EGLContext *context);
+void delete_headless_context(EGLDisplay display, EGLContext context);
+bool init_offscreen_target(OffscreenTarget *target, int size);
+void delete_offscreen_target(OffscreenTarget *target);
+bool load_scene_objects(const std::string &filename);
+void start_thumbnail_writer(size_t num_threads);
+void queue_thumbnail(Thumbnail &thumbnail);
+void run_thumbnail_writer();
+void stop_thumbnail_writer();
+void read_thumbnail(ThumbnailReadback *readback, const std::string &path);
+void collect_thumbnail(ThumbnailReadback *readback, int slot);
+int run_batch();
+
+////////////////////////////////////////////////////////////////////////////////
+/// 프레임 시간 벤치마크 (--bench)
+////////////////////////////////////////////////////////////////////////////////
+// --bench=<모델>(여러 번 줄 수 있다)마다 헤드리스 컨텍스트의 FBO에 정해진 카메라 경로로
+// bench_frames 프레임을 그리고, 프레임마다 CPU 시간과 GL_TIME_ELAPSED로 잰 GPU 시간을 모아
+// min/median/p95/p99와 프레임당 draw/삼각형 수를 JSON으로 낸다. 모델에 카메라가 있으면 프레임마다
+// 카메라를 차례로 바꾸고, 없거나 어느 카메라도 장면을 보지 못하면(경고를 낸다) scene bounds를
+// 한 바퀴 도는 궤도를 쓴다. 같은 모델과 옵션이면 매번 같은 프레임을 그린다.
+// 앞의 bench_warmup_frames 프레임은 세지 않는다.
+// load_ms는 scene 캐시를 읽었는지에 따라 크게 다르므로 모델마다 "scene_cache"(hit/miss/disabled)를
+// 같이 적는다. 로드를 같은 조건으로 비교하려면 --no-scene-cache로 돌린다.
+std::vector<std::string> bench_models;
+int bench_frames = 500;               // --bench-frames=<N>
+const int bench_warmup_frames = 10;
+int bench_image_size = 500;           // --bench-size=<픽셀>. 기본은 창과 같은 크기
+std::string bench_output_path;        // --bench-out=<파일>. 비어 있으면 stdout 끝에 쓴다.
+
+struct FrameTimeSummary
+{
+  double min = 0.0;
+  double median = 0.0;
+  double p95 = 0.0;
+  double p99 = 0.0;
+  double mean = 0.0;
+};
+
+FrameTimeSummary summarize_frame_times(std::vector<double> times);
+std::string json_string(const std::string &value);
+std::string json_summary(const FrameTimeSummary &summary);
+void set_orbit_transform(int frame, int num_frames);
+bool any_camera_sees_scene();
+std::string bench_model(const std::string &filename, bool gpu_timer);
+int run_bench();
+
+////////////////////////////////////////////////////////////////////////////////
+/// 평탄화된 scene graph
+////////////////////////////////////////////////////////////////////////////////
+// 로드 시점에 모든 scene의 노드를 부모가 자식보다 항상 앞에 오도록(전위 순회) 펼쳐 둔다.
+// 같은 인덱스끼리 한 노드를 이루는 SoA 배열이며, 노드가 여러 scene에 속하면 여러 번 나온다.
+struct FlatScene
+{
+  std::vector<int> node;   // model.nodes 인덱스
+  std::vector<int> parent; // 부모의 flat 인덱스 (-1: 루트)
+  std::vector<int> mesh;   // model.meshes 인덱스 (-1: 메쉬 없음)
+
+  std::vector<kmuvcl::math::vec3f> translation;
+  std::vector<kmuvcl::math::vec4f> rotation; // quaternion (x, y, z, w)
+  std::vector<kmuvcl::math::vec3f> scale;
+
+  std::vector<kmuvcl::math::mat4f> local;
+  std::vector<kmuvcl::math::mat4f> world;
+  std::vector<unsigned char> dirty; // local이 바뀌어 world를 다시 계산해야 하는 노드
+  std::vector<int> moved;           // 마지막 update 이후 world가 바뀐 노드 (컬링 bounds 갱신용)
+
+  bool any_dirty = false;
+};
+FlatScene flat_scene;
+
+// EXT_mesh_gpu_instancing: 노드마다 instance별 local 행렬. 노드의 world 뒤에 곱한다.
+std::vector<std::vector<kmuvcl::math::mat4f>> node_gpu_instances; // [model.nodes]
+
+// 양자화한 위치를 원래 단위로 되돌리는 메쉬별 행렬. instance의 world 행렬 뒤에 곱한다.
+// (비어 있으면 모두 항등)
+std::vector<kmuvcl::math::mat4f> mesh_dequantization; // [model.meshes]
+
+void flatten_scene();
+std::vector<SceneCacheNode> flat_scene_records();
+void restore_flat_scene(const std::vector<SceneCacheNode> &records);
+bool read_accessor_floats(int accessor_index, int num_components, std::vector<float> *values);
+void read_gpu_instances();
+std::vector<SceneCacheInstance> gpu_instance_records();
+void restore_gpu_instances(const std::vector<SceneCacheInstance> &records);
+kmuvcl::math::mat4f compose_trs(const kmuvcl::math::vec3f &t,
+                                const kmuvcl::math::vec4f &r,
+                                const kmuvcl::math::vec3f &s);
+kmuvcl::math::mat4f affine_inverse(const kmuvcl::math::mat4f &m);
+void set_node_local(int flat_index, const kmuvcl::math::mat4f &local);
+void set_node_trs(int flat_index, const kmuvcl::math::vec3f &t,
+                  const kmuvcl::math::vec4f &r, const kmuvcl::math::vec3f &s);
+void update_world_transforms();
+float world_transform_error();
+void rotate_next_node(float degrees);
+
+////////////////////////////////////////////////////////////////////////////////
+/// 렌더 큐
+////////////////////////////////////////////////////////////////////////////////
+// 프레임마다 그릴 primitive를 패킷으로 모아 64비트 키로 정렬한 뒤 제출한다.
+// 키 상위 비트부터 blend > program > texture > sampler > material > VAO 순으로 묶이므로
+// 상태는 값이 실제로 바뀔 때만 바꾸고, 블렌딩하는 패킷은 불투명한 패킷을 모두 그린 뒤에 그린다.
+struct DrawPacket
+{
+  GLuint program = 0;
+  GLuint vao = 0;
+  TextureBinding texture;
+  int material = -1; // material_records[material + 1]의 MaterialBlock 구간과 래스터 상태를 쓴다.
+  bool blend = false; // alphaMode BLEND
+
+  GLenum mode = GL_TRIANGLES;
+  GLsizei count = 0;
+  GLenum index_type = 0;
+  size_t index_offset = 0;
+
+  // 같은 primitive를 쓰는 보이는 instance는 한 패킷으로 묶어 instanced draw 한 번에 그린다.
+  size_t first_instance = 0; // instance_matrices에서 시작 위치
+  GLsizei instance_count = 0;
+
+  bool in_arena = false;
+  GLuint arena_first_index = 0;
+  GLint arena_base_vertex = 0;
+};
+
+// 같은 program/texture/sampler/material/mode로 이어지는 arena 패킷 묶음 (glMultiDrawElementsIndirect 한 번)
+struct MultiDrawBatch
+{
+  GLuint program;
+  TextureBinding texture;
+  int material;
+  GLenum mode;
+  size_t first_command;
+  GLsizei num_commands;
+  GLsizei num_instances;
+};
+std::vector<MultiDrawBatch> multi_draw_batches;
+std::vector<uint32_t> single_draw_packets; // multi-draw로 그리지 않는 패킷 (정렬 순서)
+
+// 프레임 하나의 제출 통계
+struct RenderStats
+{
+  size_t draw_calls = 0;
+  size_t instances = 0; // 그린 primitive instance (instancing이 없으면 draw_calls와 같다)
+  size_t program_changes = 0;
+  size_t vao_changes = 0;
+  size_t texture_changes = 0;
+  size_t sampler_changes = 0;
+  size_t material_changes = 0; // material(MaterialBlock 구간과 블렌드/컬링 상태)이 바뀐 횟수
+
+  size_t culled = 0;    // 절두체 밖이라 제출하지 않은 primitive
+  size_t triangles = 0; // 제출한 삼각형
+
+  size_t state_changes() const
+  {
+    return program_changes + vao_changes + texture_changes + sampler_changes + material_changes;
+  }
+};
 
+std::vector<DrawPacket> draw_packets;
+std::vector<std::pair<uint64_t, uint32_t>> draw_keys; // (정렬 키, draw_packets 인덱스)
+bool sort_render_queue = true; // S 키로 켜고 끈다. (끄면 scene graph 순서로 제출)
+bool frustum_culling = true;   // C 키로 켜고 끈다.
+
+// 그릴 (노드, primitive) 한 쌍. flat_scene 순서대로 로드 시점에 한 번 펼쳐 둔다.
+// EXT_mesh_gpu_instancing 노드는 instance마다 하나씩 나온다.
+struct DrawInstance
+{
+  int node;         // flat_scene 인덱스
+  int mesh;
+  int primitive;
+  int gpu_instance; // node_gpu_instances[model 노드] 인덱스 (-1: 노드 행렬 그대로)
+  int slot;         // primitive_slots 인덱스. 같은 primitive면 같다.
+};
+std::vector<DrawInstance> draw_instances;
+std::vector<std::vector<int>> primitive_slots; // [mesh][primitive] -> 0부터 이어지는 번호
+std::vector<size_t> node_first_instance; // [flat 노드] 그 노드의 첫 draw_instances 인덱스
+
+culling::BoxSet world_boxes;           // [draw instance] world AABB. 노드가 움직일 때만 갱신한다.
+std::vector<unsigned char> box_visible; // [draw instance] 이번 프레임 컬링 결과
+
+// bounds가 있는 instance가 이만큼 이상이면 선형 SIMD 검사 대신 BVH로 컬링한다.
+// (bench/bvh_bench에서 1k 부근까지는 둘이 비슷하고 그 위로는 BVH가 빠르다)
+const size_t bvh_min_instances = 1024;
+bool use_scene_bvh = false;
+bool scene_bvh_stale = false; // 많이 움직여 refit을 미룬 동안은 선형으로 컬링한다.
+bvh::Bvh scene_bvh;
+std::vector<uint32_t> unbounded_instances; // BVH에 넣지 않고 항상 그리는 instance
+std::vector<uint32_t> bvh_query_result;
+
+// 프레임마다 새로 쓰는 GPU 데이터(FrameUniforms, instance 행렬, indirect command)는 ring 버퍼
+// 하나에 쓴다. 버퍼를 frame_ring_regions개 구간으로 나눠 프레임마다 다음 구간에 쓰고, 그 구간을
+// 읽는 draw 뒤에 fence를 넣는다. 구간을 다시 쓰기 전에는 그 구간의 fence만 확인하므로 GPU가
+// 두 프레임 넘게 밀리지 않으면 CPU는 드라이버를 기다리지 않는다. GL 4.4/ARB_buffer_storage가
+// 있으면 처음에 한 번 persistent로 map해 두고, 없으면 프레임마다 그 구간만 unsynchronized로 map한다.
+const int frame_ring_regions = 3;
+struct FrameRing
+{
+  GLuint buffer = 0;
+  bool persistent = false;
+  unsigned char *mapped = nullptr; // persistent면 버퍼 전체, 아니면 이번 구간 (쓰는 동안만)
+  size_t region_size = 0;
+  int region = 0;  // 이번 프레임이 쓰는 구간
+  size_t used = 0; // 이번 구간에서 쓴 바이트
+  GLsync fences[frame_ring_regions] = {};
+  size_t waits = 0; // 구간의 fence가 아직 끝나지 않아 CPU가 기다린 횟수 (실행 전체)
+};
+FrameRing frame_ring;
+const size_t frame_ring_initial_size = 64 * 1024; // 구간 하나. 모자라면 두 배씩 키운다.
+
+void init_frame_ring(size_t region_size);
+void delete_frame_ring();
+void begin_frame_ring(size_t bytes);
+GLintptr frame_ring_write(const void *data, size_t size, size_t alignment);
+void finish_frame_ring_writes();
+void end_frame_ring();
+
+// 보이는 instance의 world 행렬을 패킷 순서대로 모아 프레임마다 frame_ring에 쓴다.
+std::vector<kmuvcl::math::mat4f> instance_matrices;
+std::vector<int> slot_packet; // [slot] 이번 프레임에 그 primitive의 패킷 (-1: 아직 없음)
+RenderStats render_stats;       // 마지막 프레임
+RenderStats render_stats_total; // 실행 전체 누적
+
+uint64_t draw_packet_key(const DrawPacket &packet);
+size_t triangle_count(GLenum mode, GLsizei count);
+kmuvcl::math::mat4f instance_world(const DrawInstance &instance);
+void init_draw_instances();
+void update_instance_bounds();
+void cull_primitives();
+void collect_draw_packets();
+void bind_draw_state(GLuint program, const TextureBinding &texture, int material,
+                     GLuint vao, GLuint *bound_program, TextureBinding *bound_texture,
+                     int *bound_material, GLuint *bound_vao);
+void point_instance_attributes(GLintptr offset);
+void submit_render_queue();
 void draw_scene();
-void draw_node(const tinygltf::Node &node, kmuvcl::math::mat4f mat_view);
-void draw_mesh(const tinygltf::Mesh &mesh, const kmuvcl::math::mat4f &mat_model);
 char filename[30];
 ////////////////////////////////////////////////////////////////////////////////
 
 void init_state()
 {
   glEnable(GL_DEPTH_TEST);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // alphaMode BLEND인 material만 켠다.
 }
 
-// GLSL 파일을 읽어서 컴파일한 후 쉐이더 객체를 생성하는 함수
-GLuint create_shader_from_file(const std::string &filename, GLuint shader_type)
+// GLSL 파일을 읽어서 BOM을 뗀 소스를 돌려주는 함수
+std::string read_shader_source(const std::string &filename)
 {
-  GLuint shader = 0;
-
-  shader = glCreateShader(shader_type);
-
   std::ifstream shader_file(filename.c_str());
   std::string shader_string;
 
@@ -185,14 +756,68 @@ GLuint create_shader_from_file(const std::string &filename, GLuint shader_type)
     shader_string.erase(0, 3); // Now get rid of the BOM.
   }
 
-  const GLchar *shader_src = shader_string.c_str();
+  return shader_string;
+}
+
+std::string program_cache_path()
+{
+  if (scene_cache_dir.empty())
+    return "./shader/programs.cache";
+  return scene_cache_dir + "/programs.cache";
+}
+
+// #version 줄 바로 다음에 기능 비트의 #define을 넣는다. (#extension보다 앞이어도 된다)
+std::string shader_source_with_features(const std::string &source, uint32_t features)
+{
+  std::string defines;
+  if (features & SHADER_NORMAL)
+    defines += "#define HAS_NORMAL 1\n";
+  if (features & SHADER_OCTAHEDRAL_NORMALS)
+    defines += "#define OCTAHEDRAL_NORMALS 1\n";
+  if (features & SHADER_COLOR)
+    defines += "#define HAS_COLOR 1\n";
+  if (features & SHADER_TEXCOORD)
+    defines += "#define HAS_TEXCOORD 1\n";
+  if (features & SHADER_ALPHA_MASK)
+    defines += "#define ALPHA_MASK 1\n";
+  if (features & SHADER_ALPHA_BLEND)
+    defines += "#define ALPHA_BLEND 1\n";
+
+  size_t line_end = source.find('\n');
+  if (line_end == std::string::npos)
+    return source + "\n" + defines;
+  return source.substr(0, line_end + 1) + defines + source.substr(line_end + 1);
+}
+
+// 쉐이더 객체를 만들고 컴파일을 시작한다. 결과는 링크한 뒤 check_program_link()에서 확인해서,
+// 여러 program을 만들 때 드라이버가 컴파일을 겹쳐 할 수 있게 한다.
+GLuint create_shader(const std::string &source, GLuint shader_type)
+{
+  GLuint shader = glCreateShader(shader_type);
+
+  const GLchar *shader_src = source.c_str();
   glShaderSource(shader, 1, (const GLchar **)&shader_src, NULL);
   glCompileShader(shader);
 
-  GLint is_compiled;
-  glGetShaderiv(shader, GL_COMPILE_STATUS, &is_compiled);
-  if (is_compiled != GL_TRUE)
+  return shader;
+}
+
+// 링크에 실패했으면 쉐이더 컴파일 로그와 링크 로그를 출력하고 false.
+bool check_program_link(GLuint program, GLuint vertex_shader, GLuint fragment_shader)
+{
+  GLint is_linked;
+  glGetProgramiv(program, GL_LINK_STATUS, &is_linked);
+  if (is_linked == GL_TRUE)
+    return true;
+
+  GLuint shaders[2] = {vertex_shader, fragment_shader};
+  for (GLuint shader : shaders)
   {
+    GLint is_compiled;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &is_compiled);
+    if (is_compiled == GL_TRUE)
+      continue;
+
     std::cout << "Shader COMPILE error: " << std::endl;
 
     GLint buf_len;
@@ -202,73 +827,232 @@ GLuint create_shader_from_file(const std::string &filename, GLuint shader_type)
     glGetShaderInfoLog(shader, buf_len, 0, (GLchar *)log_string.c_str());
 
     std::cout << "error_log: " << log_string << std::endl;
+  }
+
+  std::cout << "Shader LINK error: " << std::endl;
+
+  GLint buf_len;
+  glGetProgramiv(program, GL_INFO_LOG_LENGTH, &buf_len);
 
-    glDeleteShader(shader);
-    shader = 0;
+  std::string log_string(1 + buf_len, '\0');
+  glGetProgramInfoLog(program, buf_len, 0, (GLchar *)log_string.c_str());
+
+  std::cout << "error_log: " << log_string << std::endl;
+  return false;
+}
+
+// 링크 직후(또는 바이너리를 넣은 직후) 한 번만 정하는 program 상태
+void setup_program(GLuint program)
+{
+  const char *block_names[2] = {"FrameBlock", "MaterialBlock"};
+  const GLuint block_bindings[2] = {frame_block_binding, material_block_binding};
+  for (int b = 0; b < 2; ++b)
+  {
+    GLuint block_index = glGetUniformBlockIndex(program, block_names[b]);
+    if (block_index != GL_INVALID_INDEX)
+      glUniformBlockBinding(program, block_index, block_bindings[b]);
   }
 
-  return shader;
+  glUseProgram(program);
+  glUniform1i(glGetUniformLocation(program, "u_diffuse_texture"), 0);
+  glUseProgram(0);
 }
 
-// vertex shader와 fragment shader를 링크시켜 program을 생성하는 함수
-void init_shader_program()
+// 장면의 primitive가 쓰는 기능 조합마다 program을 하나씩 만들어 PrimitiveObject::program에 넣는다.
+// 캐시에 맞는 바이너리가 있으면 그대로 넣고, 없거나 드라이버가 거부한 조합은 모두 컴파일을 먼저
+// 시작한 뒤 한꺼번에 링크해서 결과를 캐시에 다시 쓴다. 이미 만든 조합은 그대로 쓰므로 material이
+// 바뀔 때(텍스처가 늦게 올라온 경우) 다시 불러도 새 조합만 만든다.
+// init_vertex_array_objects()와 compile_materials() 이후에 호출해야 한다.
+void init_shader_programs()
 {
-  GLuint vertex_shader = create_shader_from_file("./shader/vertex.glsl", GL_VERTEX_SHADER);
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+  // 조합별 기능 비트. UV는 샘플링할 baseColorTexture가 있을 때만 남기고, alpha 처리는 alphaMode로 정한다.
+  std::vector<std::vector<uint32_t>> object_features(primitive_objects.size());
+  size_t num_missing = 0;
+  for (size_t i = 0; i < primitive_objects.size(); ++i)
+  {
+    for (const PrimitiveObject &object : primitive_objects[i])
+    {
+      const MaterialRecord &material = material_records[object.material + 1];
+      uint32_t features = object.attribute_features;
+      if (!(material.features & MATERIAL_BASE_COLOR_TEXTURE))
+        features &= ~uint32_t(SHADER_TEXCOORD);
+      if (material.alpha_mode == ALPHA_MASK)
+        features |= SHADER_ALPHA_MASK;
+      else if (material.alpha_mode == ALPHA_BLEND)
+        features |= SHADER_ALPHA_BLEND;
+      object_features[i].push_back(features);
+      if (shader_programs.insert(std::make_pair(features, GLuint(0))).second)
+        num_missing += 1;
+    }
+  }
+
+  if (num_missing == 0)
+  {
+    assign_shader_programs(object_features);
+    return;
+  }
 
-  std::cout << "vertex_shader id: " << vertex_shader << std::endl;
-  assert(vertex_shader != 0);
+  std::string vertex_source = read_shader_source("./shader/vertex.glsl");
+  std::string fragment_source = read_shader_source("./shader/fragment.glsl");
 
-  GLuint fragment_shader = create_shader_from_file("./shader/fragment.glsl", GL_FRAGMENT_SHADER);
+  // 바이너리 형식을 하나도 지원하지 않는 드라이버(Mesa 일부 등)에서는 캐시를 쓰지 않는다.
+  GLint num_binary_formats = 0;
+  bool cache_supported = GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary;
+  if (cache_supported)
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_binary_formats);
+  bool cache = use_program_cache && cache_supported && num_binary_formats > 0;
 
-  std::cout << "fragment_shader id: " << fragment_shader << std::endl;
-  assert(fragment_shader != 0);
+  std::string driver;
+  program_cache::Entries entries;
+  if (cache)
+  {
+    driver = std::string(reinterpret_cast<const char *>(glGetString(GL_VENDOR))) + "\n" +
+             reinterpret_cast<const char *>(glGetString(GL_RENDERER)) + "\n" +
+             reinterpret_cast<const char *>(glGetString(GL_VERSION));
 
-  program = glCreateProgram();
-  glAttachShader(program, vertex_shader);
-  glAttachShader(program, fragment_shader);
-  glLinkProgram(program);
+    std::string err;
+    if (!program_cache::read_entries(program_cache_path(), &entries, &err))
+      std::cout << "Ignoring program cache " << program_cache_path() << ": " << err << std::endl;
+  }
 
-  GLint is_linked;
-  glGetProgramiv(program, GL_LINK_STATUS, &is_linked);
-  if (is_linked != GL_TRUE)
+  struct PendingProgram
   {
-    std::cout << "Shader LINK error: " << std::endl;
+    uint32_t features;
+    uint64_t key;
+    GLuint vertex_shader;
+    GLuint fragment_shader;
+  };
+  std::vector<PendingProgram> pending;
+  size_t num_cached = 0;
+
+  for (std::pair<const uint32_t, GLuint> &program : shader_programs)
+  {
+    if (program.second != 0)
+      continue;
 
-    GLint buf_len;
-    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &buf_len);
+    std::string vertex = shader_source_with_features(vertex_source, program.first);
+    std::string fragment = shader_source_with_features(fragment_source, program.first);
+    uint64_t key = cache ? program_cache::program_key(driver, vertex, fragment) : 0;
 
-    std::string log_string(1 + buf_len, '\0');
-    glGetProgramInfoLog(program, buf_len, 0, (GLchar *)log_string.c_str());
+    program.second = glCreateProgram();
 
-    std::cout << "error_log: " << log_string << std::endl;
+    program_cache::Entries::const_iterator entry = entries.find(key);
+    if (cache && entry != entries.end())
+    {
+      glProgramBinary(program.second, entry->second.format, entry->second.binary.data(),
+                      static_cast<GLsizei>(entry->second.binary.size()));
+      GLint is_linked = GL_FALSE;
+      glGetProgramiv(program.second, GL_LINK_STATUS, &is_linked);
+      if (is_linked == GL_TRUE)
+      {
+        setup_program(program.second);
+        num_cached += 1;
+        continue;
+      }
+      // 드라이버가 바이너리를 거부했다. (드라이버 업데이트 등) 새 program으로 다시 만든다.
+      glDeleteProgram(program.second);
+      program.second = glCreateProgram();
+    }
 
-    glDeleteProgram(program);
-    program = 0;
+    PendingProgram compile;
+    compile.features = program.first;
+    compile.key = key;
+    compile.vertex_shader = create_shader(vertex, GL_VERTEX_SHADER);
+    compile.fragment_shader = create_shader(fragment, GL_FRAGMENT_SHADER);
+    pending.push_back(compile);
   }
 
-  std::cout << "program id: " << program << std::endl;
-  assert(program != 0);
+  for (const PendingProgram &compile : pending)
+  {
+    GLuint program = shader_programs[compile.features];
+    glAttachShader(program, compile.vertex_shader);
+    glAttachShader(program, compile.fragment_shader);
+
+    // 정점 attribute의 location을 링크 전에 고정한다.
+    glBindAttribLocation(program, loc_a_position, "a_position");
+    glBindAttribLocation(program, loc_a_normal, "a_normal");
+    glBindAttribLocation(program, loc_a_texcoord, "a_texcoord");
+    glBindAttribLocation(program, loc_a_color, "a_color");
+    glBindAttribLocation(program, loc_a_model, "a_model");
+
+    if (cache)
+      glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(program);
+  }
+
+  for (const PendingProgram &compile : pending)
+  {
+    GLuint program = shader_programs[compile.features];
+    bool linked = check_program_link(program, compile.vertex_shader, compile.fragment_shader);
+
+    glDetachShader(program, compile.vertex_shader);
+    glDetachShader(program, compile.fragment_shader);
+    glDeleteShader(compile.vertex_shader);
+    glDeleteShader(compile.fragment_shader);
+    if (!linked)
+      continue;
+
+    setup_program(program);
+
+    if (cache)
+    {
+      GLint length = 0;
+      glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+      if (length <= 0)
+        continue;
+
+      program_cache::Entry &entry = entries[compile.key];
+      GLenum format = 0;
+      entry.binary.resize(length);
+      glGetProgramBinary(program, length, &length, &format, entry.binary.data());
+      entry.binary.resize(length);
+      entry.format = format;
+    }
+  }
+
+  if (cache && !pending.empty())
+  {
+    std::string err;
+    if (!program_cache::write_entries(program_cache_path(), entries, &err))
+      std::cout << "Cannot save program cache: " << err << std::endl;
+  }
 
-  loc_u_PVM = glGetUniformLocation(program, "u_PVM");
-  loc_u_M = glGetUniformLocation(program, "u_M");
+  assign_shader_programs(object_features);
 
-  loc_u_view_position_wc = glGetUniformLocation(program, "u_view_position_wc");
-  loc_u_light_position_wc = glGetUniformLocation(program, "u_light_position_wc");
+  std::cout << "Shader programs: " << num_missing << " new of " << shader_programs.size()
+            << " permutations (" << num_cached << " from program cache) in "
+            << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin)
+                   .count()
+            << " ms" << std::endl;
+}
 
-  loc_u_light_ambient = glGetUniformLocation(program, "u_light_ambient");
-  loc_u_light_diffuse = glGetUniformLocation(program, "u_light_diffuse");
-  loc_u_light_specular = glGetUniformLocation(program, "u_light_specular");
+// object_features[mesh][primitive]: init_shader_programs()가 모은 기능 비트
+void assign_shader_programs(const std::vector<std::vector<uint32_t>> &object_features)
+{
+  for (size_t i = 0; i < primitive_objects.size(); ++i)
+    for (size_t j = 0; j < primitive_objects[i].size(); ++j)
+      primitive_objects[i][j].program = shader_programs[object_features[i][j]];
+}
 
-  loc_u_material_ambient = glGetUniformLocation(program, "u_material_ambient");
-  loc_u_material_specular = glGetUniformLocation(program, "u_material_specular");
-  loc_u_material_shininess = glGetUniformLocation(program, "u_material_shininess");
+void delete_shader_programs()
+{
+  for (const std::pair<const uint32_t, GLuint> &program : shader_programs)
+    glDeleteProgram(program.second);
+  shader_programs.clear();
+}
 
-  loc_u_diffuse_texture = glGetUniformLocation(program, "u_diffuse_texture");
+// 파일 앞 4바이트가 "glTF"이면 GLB(binary glTF)로 본다. 파일을 읽지 못하면 확장자로 판단한다.
+bool is_binary_gltf(const std::string &filename)
+{
+  std::ifstream file(filename.c_str(), std::ifstream::binary);
+  char magic[4];
+  if (file.read(magic, sizeof(magic)))
+    return std::string(magic, sizeof(magic)).compare("glTF") == 0;
 
-  loc_a_position = glGetAttribLocation(program, "a_position");
-  loc_a_color = glGetAttribLocation(program, "a_color");
-  loc_a_normal = glGetAttribLocation(program, "a_normal");
-  loc_a_texcoord = glGetAttribLocation(program, "a_texcoord");
+  return filename.size() >= 4 &&
+         filename.compare(filename.size() - 4, 4, ".glb") == 0;
 }
 
 bool load_model(tinygltf::Model &model, const std::string filename)
@@ -277,7 +1061,28 @@ bool load_model(tinygltf::Model &model, const std::string filename)
   std::string err;
   std::string warn;
 
-  bool res = loader.LoadASCIIFromFile(&model, &err, &warn, filename);
+  // 이미지 디코딩은 JSON 파싱이 끝난 뒤 모든 코어에서 나누어 처리한다.
+  loader.SetParallelImageDecoding(true);
+
+  // JSON은 DOM 전체를 만들지 않고 SAX 이벤트로 읽으면서 바로 Model을 채운다.
+  loader.SetStreamingJsonParse(true);
+
+  // .bin 파일은 읽어서 복사하지 않고 메모리 매핑한다.
+  // glBufferData()가 매핑된 페이지에서 바로 GPU로 올린다.
+  tinygltf::FsCallbacks fs = {
+      &tinygltf::FileExists, &tinygltf::ExpandFilePath,
+      &tinygltf::ReadWholeFile, &tinygltf::WriteWholeFile,
+      nullptr, &tinygltf::MapWholeFile};
+  loader.SetFsCallbacks(fs);
+
+  std::chrono::steady_clock::time_point load_begin = std::chrono::steady_clock::now();
+  // GLB의 BIN chunk는 복사하지 않고 매핑된 파일을 그대로 가리킨다.
+  bool res = is_binary_gltf(filename)
+                 ? loader.LoadBinaryFromFile(&model, &err, &warn, filename)
+                 : loader.LoadASCIIFromFile(&model, &err, &warn, filename);
+  double load_ms = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - load_begin)
+                       .count();
   if (!warn.empty())
   {
     std::cout << "WARNING: " << warn << std::endl;
@@ -294,391 +1099,3065 @@ bool load_model(tinygltf::Model &model, const std::string filename)
   }
   else
   {
-    std::cout << "Loaded glTF: " << filename << std::endl;
+    std::cout << "Loaded glTF: " << filename << " (" << load_ms << " ms)" << std::endl;
+
+    const std::vector<double> &decode_times = loader.GetImageDecodeTimes();
+    double decode_total_ms = 0.0;
+    for (size_t i = 0; i < decode_times.size(); ++i)
+    {
+      std::cout << "  image[" << i << "] " << model.images[i].uri
+                << ": " << decode_times[i] << " ms" << std::endl;
+      decode_total_ms += decode_times[i];
+    }
+    if (!decode_times.empty())
+    {
+      std::cout << "  decoded " << decode_times.size() << " images, "
+                << decode_total_ms << " ms of decode time" << std::endl;
+    }
+  }
+
+  std::cout << std::endl;
+
+  return res;
+}
+
+uint32_t scene_cache_options()
+{
+  return (optimize_meshes ? SCENE_CACHE_OPTIMIZED_MESHES : 0) |
+         (quantize_attributes ? SCENE_CACHE_QUANTIZED_ATTRIBUTES : 0) |
+         (vertex_layout_options.layout == vertex_layout::INTERLEAVED
+              ? SCENE_CACHE_INTERLEAVED_ATTRIBUTES : 0) |
+         (vertex_layout_options.alignment < 4 ? SCENE_CACHE_PACKED_ATTRIBUTES : 0);
+}
+
+void optimize_model_meshes()
+{
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  mesh_optimizer::Report report = mesh_optimizer::optimize_model(model, mesh_optimizer::Options());
+  double ms = std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - begin)
+                  .count();
+
+  std::cout << "Optimized " << report.primitives << " primitives (" << report.remapped
+            << " with vertex reordering, " << report.skipped << " skipped) in " << ms << " ms"
+            << std::endl;
+  if (report.primitives > 0)
+  {
+    std::cout << "  ACMR " << report.before.acmr() << " -> " << report.after.acmr()
+              << ", ATVR " << report.before.atvr() << " -> " << report.after.atvr()
+              << " (FIFO " << mesh_optimizer::analysis_cache_size << ")" << std::endl;
+  }
+}
+
+void quantize_model_attributes()
+{
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  std::vector<quantization::Dequantization> dequantization;
+  quantization::Report report = quantization::quantize_model(model, &dequantization);
+  double ms = std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - begin)
+                  .count();
+
+  mesh_dequantization.resize(dequantization.size());
+  for (size_t m = 0; m < dequantization.size(); ++m)
+  {
+    const quantization::Dequantization &d = dequantization[m];
+    mesh_dequantization[m] = kmuvcl::math::translate<float>(d.offset[0], d.offset[1], d.offset[2]) *
+                             kmuvcl::math::scale<float>(d.scale, d.scale, d.scale);
+  }
+
+  std::cout << "Quantized vertex attributes in " << ms << " ms: " << report.bytes_before
+            << " -> " << report.bytes_after << " bytes";
+  if (report.bytes_before > 0)
+    std::cout << " (" << 100.0 * report.bytes_after / report.bytes_before << "%)";
+  std::cout << std::endl;
+  for (size_t m = 0; m < report.meshes.size(); ++m)
+  {
+    const quantization::MeshReport &mesh = report.meshes[m];
+    std::cout << "  mesh[" << m << "] " << mesh.name << ": ";
+    if (mesh.positions)
+    {
+      std::cout << "position error <= " << mesh.position_error << " ("
+                << (mesh.position_extent > 0.0 ? 100.0 * mesh.position_error / mesh.position_extent : 0.0)
+                << "% of extent)";
+    }
+    else
+    {
+      std::cout << "positions kept";
+    }
+    std::cout << ", normal error <= " << mesh.normal_error << " deg, texcoord error <= "
+              << mesh.texcoord_error << std::endl;
+  }
+}
+
+void repack_vertex_attributes()
+{
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  vertex_layout::Report report = vertex_layout::repack_model(model, vertex_layout_options);
+  double ms = std::chrono::duration<double, std::milli>(
+                  std::chrono::steady_clock::now() - begin)
+                  .count();
+
+  std::cout << (vertex_layout_options.layout == vertex_layout::INTERLEAVED ? "Interleaved"
+                                                                           : "Separated")
+            << " vertex attributes of " << report.primitives << " primitives ("
+            << report.skipped << " skipped) into " << report.streams << " streams in " << ms
+            << " ms: " << report.bytes << " bytes, " << report.padding << " bytes of padding"
+            << std::endl;
+  if (report.primitives + report.skipped > 0)
+  {
+    size_t num_primitives = report.primitives + report.skipped;
+    std::cout << "  streams per primitive " << double(report.regions_before) / num_primitives
+              << " -> " << double(report.regions_after) / num_primitives << std::endl;
+  }
+}
+
+std::vector<SceneCacheMesh> mesh_dequantization_records()
+{
+  std::vector<SceneCacheMesh> records(mesh_dequantization.size());
+  for (size_t m = 0; m < mesh_dequantization.size(); ++m)
+  {
+    records[m].offset[0] = mesh_dequantization[m](0, 3);
+    records[m].offset[1] = mesh_dequantization[m](1, 3);
+    records[m].offset[2] = mesh_dequantization[m](2, 3);
+    records[m].scale = mesh_dequantization[m](0, 0);
+  }
+  return records;
+}
+
+void restore_mesh_dequantization(const std::vector<SceneCacheMesh> &records)
+{
+  mesh_dequantization.resize(records.size());
+  for (size_t m = 0; m < records.size(); ++m)
+  {
+    const SceneCacheMesh &record = records[m];
+    mesh_dequantization[m] =
+        kmuvcl::math::translate<float>(record.offset[0], record.offset[1], record.offset[2]) *
+        kmuvcl::math::scale<float>(record.scale, record.scale, record.scale);
+  }
+}
+
+std::string scene_cache_path(const std::string &filename)
+{
+  if (scene_cache_dir.empty())
+    return filename + ".cache";
+
+  std::string name = filename;
+  std::replace(name.begin(), name.end(), '/', '_');
+  std::replace(name.begin(), name.end(), '\\', '_');
+  return scene_cache_dir + "/" + name + ".cache";
+}
+
+// 전처리된 캐시(scene_cache_path())가 원본과 같으면 그것으로 model과 flat_scene을 채우고,
+// 아니면 glTF를 읽어서 평탄화한 뒤 다음 실행을 위해 캐시를 저장한다.
+bool load_scene(const std::string &filename)
+{
+  std::string cache_path = scene_cache_path(filename);
+  std::string err = "disabled by --no-scene-cache";
+
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  std::vector<SceneCacheNode> records;
+  std::vector<SceneCacheInstance> instance_records;
+  std::vector<SceneCacheMesh> mesh_records;
+  scene_cache_hit = use_scene_cache &&
+                    load_scene_cache(cache_path, filename, scene_cache_options(), &model, &records,
+                                     &instance_records, &mesh_records, &err);
+  if (scene_cache_hit)
+  {
+    restore_flat_scene(records);
+    restore_gpu_instances(instance_records);
+    restore_mesh_dequantization(mesh_records);
+    std::cout << "Loaded scene cache: " << cache_path << " ("
+              << std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - begin)
+                     .count()
+              << " ms)" << std::endl
+              << std::endl;
+    return true;
+  }
+  std::cout << "Scene cache not used (" << err << ")" << std::endl;
+
+  if (!load_model(model, filename))
+    return false;
+  flatten_scene();
+  read_gpu_instances();
+  if (optimize_meshes)
+    optimize_model_meshes();
+  if (quantize_attributes)
+    quantize_model_attributes();
+  repack_vertex_attributes();
+
+  begin = std::chrono::steady_clock::now();
+  if (use_scene_cache)
+  {
+    if (save_scene_cache(cache_path, filename, model, flat_scene_records(),
+                         gpu_instance_records(), mesh_dequantization_records(),
+                         scene_cache_options(), &err))
+    {
+      std::cout << "Saved scene cache: " << cache_path << " ("
+                << std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - begin)
+                       .count()
+                << " ms)" << std::endl;
+    }
+    else
+    {
+      std::cout << "Failed to save scene cache: " << err << std::endl;
+    }
+  }
+  std::cout << std::endl;
+
+  return true;
+}
+
+// bufferView 하나를 VBO로 한 번만 올리고, 이미 올라간 경우 기존 VBO를 돌려준다.
+GLuint upload_buffer_view(int buffer_view_index, GLenum default_target)
+{
+  if (buffer_view_index < 0)
+    return 0;
+
+  GLuint &buffer_object = buffer_objects[buffer_view_index];
+  if (buffer_object != 0)
+    return buffer_object;
+
+  const tinygltf::BufferView &bufferView = model.bufferViews[buffer_view_index];
+  const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
+
+  // bufferView.target은 선택 항목이므로, 없으면 참조하는 쪽의 용도를 따른다.
+  GLenum target = bufferView.target != 0 ? bufferView.target : default_target;
+
+  glGenBuffers(1, &buffer_object);
+  glBindBuffer(target, buffer_object);
+  glBufferData(target, bufferView.byteLength,
+               buffer.Data() + bufferView.byteOffset, GL_STATIC_DRAW);
+  glBindBuffer(target, 0);
+
+  return buffer_object;
+}
+
+// arena 버퍼를 먼저 만들고, arena에 들어가지 않은 primitive가 쓰는 bufferView만 VBO로 올린다.
+void init_buffer_objects()
+{
+  const std::vector<tinygltf::Mesh> &meshes = model.meshes;
+  const std::vector<tinygltf::Accessor> &accessors = model.accessors;
+  const std::vector<tinygltf::BufferView> &bufferViews = model.bufferViews;
+
+  delete_buffer_objects();
+  buffer_objects.assign(bufferViews.size(), 0);
+
+  init_arena_buffers();
+
+  for (size_t i = 0; i < meshes.size(); ++i)
+  {
+    for (size_t j = 0; j < meshes[i].primitives.size(); ++j)
+    {
+      const tinygltf::Primitive &primitive = meshes[i].primitives[j];
+      if (arena_placements[i][j].in_arena)
+        continue;
+
+      if (primitive.indices > -1)
+      {
+        const tinygltf::Accessor &accessor = accessors[primitive.indices];
+        upload_buffer_view(accessor.bufferView, GL_ELEMENT_ARRAY_BUFFER);
+      }
+
+      for (const std::pair<const std::string, int> &attrib : primitive.attributes)
+      {
+        const tinygltf::Accessor &accessor = accessors[attrib.second];
+        upload_buffer_view(accessor.bufferView, GL_ARRAY_BUFFER);
+      }
+    }
+  }
+
+  size_t num_uploaded = 0;
+  size_t num_bytes = 0;
+  for (size_t i = 0; i < buffer_objects.size(); ++i)
+  {
+    if (buffer_objects[i] != 0)
+    {
+      num_uploaded += 1;
+      num_bytes += bufferViews[i].byteLength;
+    }
+  }
+
+  GLint arena_bytes = 0;
+  GLuint arena_buffers[2] = {arena_vertex_buffer, arena_index_buffer};
+  for (GLuint buffer : arena_buffers)
+  {
+    GLint size = 0;
+    if (buffer == 0)
+      continue;
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glGetBufferParameteriv(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+    arena_bytes += size;
+  }
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+  std::cout << "Uploaded " << num_uploaded << " bufferViews (" << num_bytes << " bytes)" << std::endl;
+  std::cout << "Resident geometry: " << num_bytes + arena_bytes << " bytes (bufferViews "
+            << num_bytes << ", arena " << arena_bytes << ")" << std::endl;
+}
+
+// init_buffer_objects()에서 만든 VBO를 모두 해제한다. GL 컨텍스트가 살아있는 동안 호출해야 한다.
+void delete_buffer_objects()
+{
+  for (GLuint &buffer_object : buffer_objects)
+  {
+    if (buffer_object != 0)
+    {
+      glDeleteBuffers(1, &buffer_object);
+      buffer_object = 0;
+    }
+  }
+  buffer_objects.clear();
+}
+
+// glTF attribute semantic에 대응하는 고정 attribute 위치. 쉐이더가 쓰지 않는 semantic은 -1.
+GLint attrib_location(const std::string &semantic)
+{
+  if (semantic.compare("POSITION") == 0)
+    return loc_a_position;
+  if (semantic.compare("NORMAL") == 0)
+    return loc_a_normal;
+  if (semantic.compare("TEXCOORD_0") == 0)
+    return loc_a_texcoord;
+  if (semantic.compare("COLOR_0") == 0)
+    return loc_a_color;
+  return -1;
+}
+
+// primitive마다 VAO를 만들어 attribute/index 바인딩을 미리 기록해 둔다. arena에 들어간
+// primitive는 arena_vao로 그리므로 그리기 정보만 채운다.
+// init_buffer_objects() 이후에 호출해야 한다.
+void init_vertex_array_objects()
+{
+  const std::vector<tinygltf::Mesh> &meshes = model.meshes;
+  const std::vector<tinygltf::Accessor> &accessors = model.accessors;
+  const std::vector<tinygltf::BufferView> &bufferViews = model.bufferViews;
+
+  delete_vertex_array_objects();
+  primitive_objects.resize(meshes.size());
+
+  for (size_t i = 0; i < meshes.size(); ++i)
+  {
+    const tinygltf::Mesh &mesh = meshes[i];
+    primitive_objects[i].resize(mesh.primitives.size());
+
+    for (size_t j = 0; j < mesh.primitives.size(); ++j)
+    {
+      const tinygltf::Primitive &primitive = mesh.primitives[j];
+      PrimitiveObject &object = primitive_objects[i][j];
+
+      object.mode = primitive.mode;
+      // 범위 밖의 material은 material이 없는 것으로 본다. (material_records[material + 1]로 읽는다)
+      object.material = primitive.material >= 0 && size_t(primitive.material) < model.materials.size()
+                             ? primitive.material
+                             : -1;
+      object.bounds = primitive_bounds(primitive);
+
+      const ArenaPlacement &placement = arena_placements[i][j];
+      object.in_arena = placement.in_arena;
+      object.arena_first_index = placement.first_index;
+      object.arena_base_vertex = placement.base_vertex;
+
+      if (!object.in_arena)
+      {
+        glGenVertexArrays(1, &object.vao);
+        glBindVertexArray(object.vao);
+      }
+
+      for (const std::pair<const std::string, int> &attrib : primitive.attributes)
+      {
+        const tinygltf::Accessor &accessor = accessors[attrib.second];
+        if (attrib.first.compare("POSITION") == 0)
+          object.count = accessor.count;
+
+        GLint loc = attrib_location(attrib.first);
+        if (loc < 0 || accessor.bufferView < 0)
+          continue;
+        if (loc == loc_a_normal)
+          object.attribute_features |= SHADER_NORMAL;
+        if (loc == loc_a_normal && quantization::is_octahedral_normal(accessor))
+          object.attribute_features |= SHADER_OCTAHEDRAL_NORMALS;
+        else if (loc == loc_a_color)
+          object.attribute_features |= SHADER_COLOR;
+        else if (loc == loc_a_texcoord)
+          object.attribute_features |= SHADER_TEXCOORD;
+        if (object.in_arena)
+          continue;
+
+        const tinygltf::BufferView &bufferView = bufferViews[accessor.bufferView];
+        const int byteStride = accessor.ByteStride(bufferView);
+
+        glBindBuffer(GL_ARRAY_BUFFER, buffer_objects[accessor.bufferView]);
+        glEnableVertexAttribArray(loc);
+        glVertexAttribPointer(loc,
+                              accessor.type, accessor.componentType,
+                              accessor.normalized ? GL_TRUE : GL_FALSE, byteStride,
+                              BUFFER_OFFSET(accessor.byteOffset));
+      }
+
+      if (primitive.indices > -1)
+      {
+        const tinygltf::Accessor &index_accessor = accessors[primitive.indices];
+        object.count = index_accessor.count;
+        object.index_type = index_accessor.componentType;
+        object.index_offset = index_accessor.byteOffset;
+      }
+
+      if (object.in_arena)
+        continue;
+
+      // instance 행렬은 열 4개를 vec4 attribute 4개로 넘긴다. frame_ring 안의 위치는 그릴 때 정한다.
+      glBindBuffer(GL_ARRAY_BUFFER, frame_ring.buffer);
+      for (GLint c = 0; c < 4; ++c)
+      {
+        glEnableVertexAttribArray(loc_a_model + c);
+        glVertexAttribPointer(loc_a_model + c, 4, GL_FLOAT, GL_FALSE,
+                              sizeof(kmuvcl::math::mat4f), BUFFER_OFFSET(c * 4 * sizeof(float)));
+        glVertexAttribDivisor(loc_a_model + c, 1);
+      }
+
+      if (primitive.indices > -1)
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer_objects[accessors[primitive.indices].bufferView]);
+
+      glBindVertexArray(0);
+    }
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+// POSITION accessor의 min/max. 없으면 float VEC3 정점 데이터를 직접 훑어 구한다.
+// normalized 정수 위치(KHR_mesh_quantization)의 min/max는 정수 값이므로 [-1, 1]로 바꾼다.
+culling::Aabb primitive_bounds(const tinygltf::Primitive &primitive)
+{
+  culling::Aabb bounds = culling::empty_aabb();
+
+  std::map<std::string, int>::const_iterator it = primitive.attributes.find("POSITION");
+  if (it == primitive.attributes.end() || it->second < 0 ||
+      size_t(it->second) >= model.accessors.size())
+    return bounds;
+
+  const tinygltf::Accessor &accessor = model.accessors[it->second];
+  if (accessor.minValues.size() >= 3 && accessor.maxValues.size() >= 3)
+  {
+    double divisor = 1.0;
+    if (accessor.normalized)
+    {
+      switch (accessor.componentType)
+      {
+      case TINYGLTF_COMPONENT_TYPE_BYTE: divisor = 127.0; break;
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: divisor = 255.0; break;
+      case TINYGLTF_COMPONENT_TYPE_SHORT: divisor = 32767.0; break;
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: divisor = 65535.0; break;
+      }
+    }
+    for (int k = 0; k < 3; ++k)
+    {
+      bounds.min[k] = static_cast<float>(accessor.minValues[k] / divisor);
+      bounds.max[k] = static_cast<float>(accessor.maxValues[k] / divisor);
+    }
+    return bounds;
+  }
+
+  if (accessor.bufferView < 0 || accessor.type != TINYGLTF_TYPE_VEC3 ||
+      accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT || accessor.sparse.isSparse)
+    return bounds;
+
+  const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
+  const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
+  const int byteStride = accessor.ByteStride(bufferView);
+  if (byteStride <= 0 || accessor.count == 0)
+    return bounds;
+
+  size_t begin = bufferView.byteOffset + accessor.byteOffset;
+  size_t end = begin + (accessor.count - 1) * size_t(byteStride) + 3 * sizeof(float);
+  if (end > buffer.Size())
+    return bounds;
+
+  for (size_t i = 0; i < accessor.count; ++i)
+  {
+    float p[3];
+    memcpy(p, buffer.Data() + begin + i * size_t(byteStride), sizeof(p));
+    culling::grow(bounds, p);
+  }
+  return bounds;
+}
+
+void delete_vertex_array_objects()
+{
+  for (std::vector<PrimitiveObject> &objects : primitive_objects)
+  {
+    for (PrimitiveObject &object : objects)
+    {
+      if (object.vao != 0)
+        glDeleteVertexArrays(1, &object.vao);
+    }
+  }
+  primitive_objects.clear();
+}
+
+// 인덱스 accessor를 uint32 배열로 읽는다.
+bool read_accessor_indices(int accessor_index, std::vector<GLuint> *indices)
+{
+  const tinygltf::Accessor &accessor = model.accessors[accessor_index];
+  if (accessor.bufferView < 0 || accessor.sparse.isSparse || accessor.type != TINYGLTF_TYPE_SCALAR)
+    return false;
+
+  const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
+  const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
+  const int component_size = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+  const int byteStride = accessor.ByteStride(bufferView);
+  if (component_size <= 0 || byteStride <= 0)
+    return false;
+
+  size_t begin = bufferView.byteOffset + accessor.byteOffset;
+  if (accessor.count > 0 &&
+      begin + (accessor.count - 1) * size_t(byteStride) + component_size > buffer.Size())
+    return false;
+
+  indices->resize(accessor.count);
+  for (size_t i = 0; i < accessor.count; ++i)
+  {
+    const unsigned char *p = buffer.Data() + begin + i * size_t(byteStride);
+    if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
+    {
+      (*indices)[i] = *p;
+    }
+    else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+    {
+      uint16_t v;
+      memcpy(&v, p, sizeof(v));
+      (*indices)[i] = v;
+    }
+    else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
+    {
+      uint32_t v;
+      memcpy(&v, p, sizeof(v));
+      (*indices)[i] = v;
+    }
+    else
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+// 모든 primitive를 공통 정점 형식(ArenaVertex, --quantize면 QuantizedArenaVertex)과 uint32
+// 인덱스로 바꿔 두 버퍼에 이어 붙이고, primitive마다 arena_placements에 위치를 적는다. 없는
+// attribute는 0으로 채운다. (VAO 경로에서 attribute를 끈 것과 같은 값) 양자화 형식에 맞지 않는
+// primitive(위치를 양자화하지 않은 메쉬, 팔면체로 바꾸지 못한 법선, [0, 1]을 벗어난 UV)는
+// arena에 넣지 않고 VAO로 그린다.
+// 버퍼만 만들므로 로더 스레드에서 불러도 된다. VAO는 init_geometry_arena()가 만든다.
+void init_arena_buffers()
+{
+  GLuint buffers[2] = {arena_vertex_buffer, arena_index_buffer};
+  for (GLuint buffer : buffers)
+  {
+    if (buffer != 0)
+      glDeleteBuffers(1, &buffer);
+  }
+  arena_vertex_buffer = arena_index_buffer = 0;
+
+  arena_placements.assign(model.meshes.size(), std::vector<ArenaPlacement>());
+  for (size_t i = 0; i < model.meshes.size(); ++i)
+    arena_placements[i].resize(model.meshes[i].primitives.size());
+
+  multi_draw_supported = GLEW_VERSION_4_3 ||
+                         (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+  if (!multi_draw_supported)
+  {
+    std::cout << "Multi-draw indirect is not supported; drawing primitives one by one" << std::endl;
+    return;
+  }
+
+  std::vector<ArenaVertex> vertices;
+  std::vector<QuantizedArenaVertex> quantized_vertices;
+  std::vector<GLuint> indices;
+  size_t num_in_arena = 0;
+
+  for (size_t i = 0; i < model.meshes.size(); ++i)
+  {
+    const tinygltf::Mesh &mesh = model.meshes[i];
+    for (size_t j = 0; j < mesh.primitives.size(); ++j)
+    {
+      const tinygltf::Primitive &primitive = mesh.primitives[j];
+      ArenaPlacement &placement = arena_placements[i][j];
+
+      std::map<std::string, int>::const_iterator position = primitive.attributes.find("POSITION");
+      std::vector<float> positions;
+      if (position == primitive.attributes.end() ||
+          (quantize_attributes && !model.accessors[position->second].normalized) ||
+          !read_accessor_floats(position->second, 3, &positions) || positions.empty())
+        continue;
+      size_t num_vertices = positions.size() / 3;
+
+      // 나머지 attribute. 개수가 POSITION과 다르면 없는 것으로 본다.
+      const char *semantics[3] = {"NORMAL", "TEXCOORD_0", "COLOR_0"};
+      std::vector<float> values[3];
+      int components[3] = {quantize_attributes ? 2 : 3, 2, 3};
+      bool packable = true;
+      for (int a = 0; a < 3; ++a)
+      {
+        std::map<std::string, int>::const_iterator it = primitive.attributes.find(semantics[a]);
+        if (it == primitive.attributes.end())
+          continue;
+        if (a == 2 && model.accessors[it->second].type == TINYGLTF_TYPE_VEC4)
+          components[a] = 4;
+        // arena의 법선 형식(--quantize면 팔면체)과 primitive가 고를 셰이더 조합이 맞아야 한다.
+        if (a == 0 && quantization::is_octahedral_normal(model.accessors[it->second]) != quantize_attributes)
+          packable = false;
+        if (a == 1 && quantize_attributes &&
+            model.accessors[it->second].componentType == TINYGLTF_COMPONENT_TYPE_FLOAT)
+          packable = false;
+        if (!read_accessor_floats(it->second, components[a], &values[a]) ||
+            values[a].size() != num_vertices * components[a])
+          values[a].clear();
+      }
+      if (!packable)
+        continue;
+
+      std::vector<GLuint> primitive_indices;
+      if (primitive.indices > -1)
+      {
+        if (!read_accessor_indices(primitive.indices, &primitive_indices))
+          continue;
+      }
+      else
+      {
+        primitive_indices.resize(num_vertices);
+        for (size_t k = 0; k < num_vertices; ++k)
+          primitive_indices[k] = static_cast<GLuint>(k);
+      }
+
+      placement.in_arena = true;
+      placement.first_index = static_cast<GLuint>(indices.size());
+      placement.base_vertex = static_cast<GLint>(quantize_attributes ? quantized_vertices.size()
+                                                                     : vertices.size());
+      indices.insert(indices.end(), primitive_indices.begin(), primitive_indices.end());
+      num_in_arena += 1;
+
+      // 양자화된 값은 float로 읽었다가 다시 정수로 바꿔도 그대로다.
+      for (size_t v = 0; quantize_attributes && v < num_vertices; ++v)
+      {
+        QuantizedArenaVertex vertex;
+        memset(&vertex, 0, sizeof(vertex));
+        for (int k = 0; k < 3; ++k)
+          vertex.position[k] = quantization::quantize_snorm16(positions[v * 3 + k]);
+        for (int k = 0; k < 2 && !values[0].empty(); ++k)
+          vertex.normal[k] = quantization::quantize_snorm16(values[0][v * 2 + k]);
+        for (int k = 0; k < 2 && !values[1].empty(); ++k)
+          vertex.texcoord[k] = static_cast<uint16_t>(std::lround(values[1][v * 2 + k] * 65535.0f));
+        for (int k = 0; k < 3 && !values[2].empty(); ++k)
+        {
+          float c = std::max(0.0f, std::min(1.0f, values[2][v * components[2] + k]));
+          vertex.color[k] = static_cast<uint8_t>(std::lround(c * 255.0f));
+        }
+        quantized_vertices.push_back(vertex);
+      }
+
+      for (size_t v = 0; !quantize_attributes && v < num_vertices; ++v)
+      {
+        ArenaVertex vertex;
+        memset(&vertex, 0, sizeof(vertex));
+        std::copy(&positions[v * 3], &positions[v * 3] + 3, vertex.position);
+        if (!values[0].empty())
+          std::copy(&values[0][v * 3], &values[0][v * 3] + 3, vertex.normal);
+        if (!values[1].empty())
+          std::copy(&values[1][v * 2], &values[1][v * 2] + 2, vertex.texcoord);
+        if (!values[2].empty())
+          std::copy(&values[2][v * components[2]], &values[2][v * components[2]] + 3, vertex.color);
+        vertices.push_back(vertex);
+      }
+    }
+  }
+
+  if (num_in_arena == 0)
+    return;
+
+  size_t num_vertices = quantize_attributes ? quantized_vertices.size() : vertices.size();
+  size_t vertex_size = quantize_attributes ? sizeof(QuantizedArenaVertex) : sizeof(ArenaVertex);
+
+  glGenBuffers(1, &arena_vertex_buffer);
+  glBindBuffer(GL_ARRAY_BUFFER, arena_vertex_buffer);
+  if (quantize_attributes)
+    glBufferData(GL_ARRAY_BUFFER, num_vertices * vertex_size, quantized_vertices.data(), GL_STATIC_DRAW);
+  else
+    glBufferData(GL_ARRAY_BUFFER, num_vertices * vertex_size, vertices.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // VAO가 바인딩되지 않은 상태에서 올리므로 GL_ELEMENT_ARRAY_BUFFER 대신 GL_COPY_WRITE_BUFFER를 쓴다.
+  glGenBuffers(1, &arena_index_buffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, arena_index_buffer);
+  glBufferData(GL_COPY_WRITE_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  std::cout << "Packed " << num_in_arena << " primitives into the multi-draw arena ("
+            << num_vertices << " vertices of " << vertex_size << " bytes, "
+            << indices.size() << " indices)" << std::endl;
+}
+
+// init_arena_buffers()가 올린 버퍼를 읽는 VAO 하나를 만든다. VAO는 컨텍스트끼리 공유되지 않으므로
+// 렌더 스레드에서 init_vertex_array_objects() 이후에 호출해야 한다.
+void init_geometry_arena()
+{
+  if (arena_vao != 0)
+    glDeleteVertexArrays(1, &arena_vao);
+  arena_vao = 0;
+  if (arena_vertex_buffer == 0)
+    return;
+
+  glGenVertexArrays(1, &arena_vao);
+  glBindVertexArray(arena_vao);
+  glBindBuffer(GL_ARRAY_BUFFER, arena_vertex_buffer);
+
+  const GLint locations[4] = {loc_a_position, loc_a_normal, loc_a_texcoord, loc_a_color};
+  if (quantize_attributes)
+  {
+    const GLint sizes[4] = {3, 2, 2, 3};
+    const GLenum types[4] = {GL_SHORT, GL_SHORT, GL_UNSIGNED_SHORT, GL_UNSIGNED_BYTE};
+    const size_t offsets[4] = {offsetof(QuantizedArenaVertex, position),
+                               offsetof(QuantizedArenaVertex, normal),
+                               offsetof(QuantizedArenaVertex, texcoord),
+                               offsetof(QuantizedArenaVertex, color)};
+    for (int a = 0; a < 4; ++a)
+    {
+      glEnableVertexAttribArray(locations[a]);
+      glVertexAttribPointer(locations[a], sizes[a], types[a], GL_TRUE, sizeof(QuantizedArenaVertex),
+                            BUFFER_OFFSET(offsets[a]));
+    }
+  }
+  else
+  {
+    const GLint sizes[4] = {3, 3, 2, 3};
+    const size_t offsets[4] = {offsetof(ArenaVertex, position), offsetof(ArenaVertex, normal),
+                               offsetof(ArenaVertex, texcoord), offsetof(ArenaVertex, color)};
+    for (int a = 0; a < 4; ++a)
+    {
+      glEnableVertexAttribArray(locations[a]);
+      glVertexAttribPointer(locations[a], sizes[a], GL_FLOAT, GL_FALSE, sizeof(ArenaVertex),
+                            BUFFER_OFFSET(offsets[a]));
+    }
+  }
+
+  // instance 행렬은 baseInstance부터 읽힌다. 구간의 시작은 프레임마다 다시 가리킨다.
+  glBindBuffer(GL_ARRAY_BUFFER, frame_ring.buffer);
+  for (GLint c = 0; c < 4; ++c)
+  {
+    glEnableVertexAttribArray(loc_a_model + c);
+    glVertexAttribPointer(loc_a_model + c, 4, GL_FLOAT, GL_FALSE,
+                          sizeof(kmuvcl::math::mat4f), BUFFER_OFFSET(c * 4 * sizeof(float)));
+    glVertexAttribDivisor(loc_a_model + c, 1);
+  }
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arena_index_buffer);
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void delete_geometry_arena()
+{
+  if (arena_vao != 0)
+    glDeleteVertexArrays(1, &arena_vao);
+  GLuint buffers[2] = {arena_vertex_buffer, arena_index_buffer};
+  for (GLuint buffer : buffers)
+  {
+    if (buffer != 0)
+      glDeleteBuffers(1, &buffer);
+  }
+  arena_vao = arena_vertex_buffer = arena_index_buffer = 0;
+  arena_placements.clear();
+}
+
+bool is_mipmap_filter(int filter)
+{
+  return filter == GL_NEAREST_MIPMAP_NEAREST || filter == GL_LINEAR_MIPMAP_NEAREST ||
+         filter == GL_NEAREST_MIPMAP_LINEAR || filter == GL_LINEAR_MIPMAP_LINEAR;
+}
+
+GLuint create_sampler_object(int min_filter, int mag_filter, int wrap_s, int wrap_t)
+{
+  GLuint sampler;
+  glGenSamplers(1, &sampler);
+  glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, min_filter);
+  glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, mag_filter);
+  glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, wrap_s);
+  glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, wrap_t);
+  return sampler;
+}
+
+// 디코딩된 image 하나를 GL 텍스처로 올린다.
+GLuint upload_image(const tinygltf::Image &image, bool generate_mipmaps)
+{
+  GLenum format = GL_RGBA;
+  if (image.component == 1)
+  {
+    format = GL_RED;
+  }
+  else if (image.component == 2)
+  {
+    format = GL_RG;
+  }
+  else if (image.component == 3)
+  {
+    format = GL_RGB;
+  }
+
+  GLenum type = GL_UNSIGNED_BYTE;
+  if (image.bits == 16)
+  {
+    type = GL_UNSIGNED_SHORT;
+  }
+
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+
+  // 한 줄이 4바이트 배수가 아닌 RGB 이미지도 있으므로 1바이트 정렬로 읽는다.
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
+               image.width, image.height, 0, format, type, image.Pixels());
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  if (generate_mipmaps)
+    glGenerateMipmap(GL_TEXTURE_2D);
+  else
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+  return texture;
+}
+
+// streaming이면(로더 스레드) texture_publish_bytes만큼 올릴 때마다 publish_textures()로 내보낸다.
+// 로더 컨텍스트에서는 glTexImage2D가 렌더 스레드를 막지 않으므로 디코딩된 픽셀을 그대로 넘긴다.
+void init_texture_objects(bool streaming)
+{
+  const std::vector<tinygltf::Texture> &textures = model.textures;
+  const std::vector<tinygltf::Image> &images = model.images;
+  const std::vector<tinygltf::Sampler> &samplers = model.samplers;
+
+  delete_texture_objects();
+
+  // sampler 설정 -> GL sampler 객체. 설정이 같은 sampler는 객체를 같이 쓴다.
+  std::map<std::vector<int>, GLuint> sampler_lookup;
+  std::vector<int> texture_sampler_settings(4);
+
+  // image별로 mipmap이 필요한지 먼저 모은다. (그 image를 쓰는 sampler 중 하나라도 원하면 만든다)
+  std::vector<unsigned char> image_needs_mipmaps(images.size(), 0);
+  std::vector<std::vector<int>> texture_settings(textures.size());
+  for (size_t i = 0; i < textures.size(); ++i)
+  {
+    const tinygltf::Texture &texture = textures[i];
+
+    // sampler가 없으면 glTF 기본값(반복, 필터는 구현이 정함)을 쓴다.
+    std::vector<int> settings = {GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR, GL_REPEAT, GL_REPEAT};
+    if (texture.sampler >= 0 && size_t(texture.sampler) < samplers.size())
+    {
+      const tinygltf::Sampler &sampler = samplers[texture.sampler];
+      if (sampler.minFilter > 0)
+        settings[0] = sampler.minFilter;
+      if (sampler.magFilter > 0)
+        settings[1] = sampler.magFilter;
+      settings[2] = sampler.wrapS;
+      settings[3] = sampler.wrapT;
+    }
+    texture_settings[i] = settings;
+
+    if (texture.source >= 0 && size_t(texture.source) < images.size() &&
+        is_mipmap_filter(settings[0]))
+      image_needs_mipmaps[texture.source] = 1;
+  }
+
+  image_textures.assign(images.size(), 0);
+  texture_bindings.resize(textures.size());
+  size_t num_uploaded = 0;
+  for (size_t i = 0; i < textures.size(); ++i)
+  {
+    const tinygltf::Texture &texture = textures[i];
+    TextureBinding &binding = texture_bindings[i];
+
+    std::map<std::vector<int>, GLuint>::iterator found = sampler_lookup.find(texture_settings[i]);
+    if (found == sampler_lookup.end())
+    {
+      const std::vector<int> &settings = texture_settings[i];
+      GLuint sampler = create_sampler_object(settings[0], settings[1], settings[2], settings[3]);
+      sampler_objects.push_back(sampler);
+      found = sampler_lookup.insert(std::make_pair(settings, sampler)).first;
+    }
+    binding.sampler = found->second;
+
+    // 읽지 못한 image(파일이 없는 경우 등)는 텍스처 없이 그린다.
+    if (texture.source < 0 || size_t(texture.source) >= images.size())
+      continue;
+    const tinygltf::Image &image = images[texture.source];
+    if (image.PixelsSize() == 0 || image.width <= 0 || image.height <= 0)
+      continue;
+
+    GLuint &image_texture = image_textures[texture.source];
+    if (image_texture == 0)
+    {
+      image_texture = upload_image(image, image_needs_mipmaps[texture.source] != 0);
+      num_uploaded += 1;
+      resource_loader.pending_bytes += image.PixelsSize();
+    }
+    binding.texture = image_texture;
+
+    if (streaming && resource_loader.pending_bytes >= texture_publish_bytes)
+    {
+      publish_textures();
+      if (resource_loader.cancel)
+        break;
+    }
+  }
+  if (streaming && resource_loader.pending_bytes > 0)
+    publish_textures();
+
+  std::cout << "Uploaded " << num_uploaded << " textures for " << textures.size()
+            << " glTF textures (" << sampler_objects.size() << " sampler objects)" << std::endl;
+}
+
+// init_texture_objects()에서 만든 텍스처와 sampler 객체를 모두 해제한다.
+void delete_texture_objects()
+{
+  for (GLuint &texture : image_textures)
+  {
+    if (texture != 0)
+      glDeleteTextures(1, &texture);
+  }
+  image_textures.clear();
+
+  if (!sampler_objects.empty())
+    glDeleteSamplers(static_cast<GLsizei>(sampler_objects.size()), sampler_objects.data());
+  sampler_objects.clear();
+
+  texture_bindings.clear();
+}
+
+// fence가 끝날 때까지 기다린다. 이미 끝나 있었으면 false.
+bool wait_fence(GLsync fence)
+{
+  GLenum result = glClientWaitSync(fence, 0, 0);
+  if (result != GL_TIMEOUT_EXPIRED)
+    return false;
+
+  do
+  {
+    result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+  } while (result == GL_TIMEOUT_EXPIRED);
+  return true;
+}
+
+// values[name]이 올라간 texture를 가리키면 bindings의 바인딩을 돌려주고 features에 feature 비트를 켠다.
+TextureBinding compile_texture_binding(const std::vector<TextureBinding> &bindings,
+                                       const tinygltf::ParameterMap &values, const char *name,
+                                       MaterialFeature feature, uint32_t *features)
+{
+  tinygltf::ParameterMap::const_iterator it = values.find(name);
+  if (it == values.end())
+    return TextureBinding();
+
+  int texture_index = it->second.TextureIndex();
+  if (texture_index < 0 || size_t(texture_index) >= bindings.size() ||
+      bindings[texture_index].texture == 0)
+    return TextureBinding();
+
+  *features |= feature;
+  return bindings[texture_index];
+}
+
+// pbrMetallicRoughness 값은 values에, 나머지(emissive, alpha, doubleSided)는
+// additionalValues에 들어 있다. 없는 값은 glTF 기본값을 쓴다.
+MaterialRecord compile_material(const std::vector<TextureBinding> &bindings,
+                                const tinygltf::Material &material)
+{
+  MaterialRecord record;
+  const tinygltf::ParameterMap &values = material.values;
+  const tinygltf::ParameterMap &additional = material.additionalValues;
+
+  record.base_color_texture = compile_texture_binding(
+      bindings, values, "baseColorTexture", MATERIAL_BASE_COLOR_TEXTURE, &record.features);
+  compile_texture_binding(bindings, additional, "emissiveTexture", MATERIAL_EMISSIVE_TEXTURE,
+                          &record.features);
+
+  tinygltf::ParameterMap::const_iterator it = values.find("baseColorFactor");
+  if (it != values.end() && it->second.number_array.size() >= 3)
+  {
+    tinygltf::ColorValue color = it->second.ColorFactor();
+    for (int c = 0; c < 4; ++c)
+      record.base_color_factor[c] = static_cast<float>(color[c]);
+  }
+
+  it = additional.find("emissiveFactor");
+  if (it != additional.end() && it->second.number_array.size() >= 3)
+  {
+    for (int c = 0; c < 3; ++c)
+      record.emissive_factor[c] = static_cast<float>(it->second.number_array[c]);
+  }
+  it = additional.find("alphaMode");
+  if (it != additional.end())
+  {
+    if (it->second.string_value == "MASK")
+      record.alpha_mode = ALPHA_MASK;
+    else if (it->second.string_value == "BLEND")
+      record.alpha_mode = ALPHA_BLEND;
+  }
+  it = additional.find("alphaCutoff");
+  if (it != additional.end() && it->second.has_number_value)
+    record.alpha_cutoff = static_cast<float>(it->second.Factor());
+  it = additional.find("doubleSided");
+  if (it != additional.end() && it->second.bool_value)
+    record.features |= MATERIAL_DOUBLE_SIDED;
+
+  return record;
+}
+
+// bindings: init_texture_objects()가 만든 texture_bindings, 또는 로더 스레드가 내보낸 그 사본.
+// 아직 올라가지 않은 텍스처는 없는 것으로 컴파일한다.
+void compile_materials(const std::vector<TextureBinding> &bindings)
+{
+  material_records.assign(1, MaterialRecord());
+  material_records.reserve(model.materials.size() + 1);
+
+  size_t textured = 0;
+  size_t translucent = 0;
+  for (const tinygltf::Material &material : model.materials)
+  {
+    material_records.push_back(compile_material(bindings, material));
+    if (material_records.back().features & MATERIAL_BASE_COLOR_TEXTURE)
+      textured += 1;
+    if (material_records.back().alpha_mode != ALPHA_OPAQUE)
+      translucent += 1;
+  }
+
+  std::cout << "Compiled " << model.materials.size() << " materials (" << textured
+            << " with a base color texture, " << translucent << " masked or blended)" << std::endl;
+}
+
+// material 하나의 MaterialBlock 내용. ambient/specular/shininess는 뷰어의 Phong 상수이고,
+// diffuse는 baseColorFactor(와 baseColorTexture), emissive와 alphaCutoff는 material에서 온다.
+// emissiveTexture는 샘플링하지 않으므로 그런 material은 emissiveFactor만으로 칠하지 않고 0으로 둔다.
+MaterialUniforms material_uniform_record(const MaterialRecord &material)
+{
+  MaterialUniforms uniforms;
+  memset(&uniforms, 0, sizeof(uniforms));
+  memcpy(uniforms.ambient, static_cast<const float *>(material_ambient), sizeof(uniforms.ambient));
+  memcpy(uniforms.specular, static_cast<const float *>(material_specular), sizeof(uniforms.specular));
+  memcpy(uniforms.base_color, material.base_color_factor, sizeof(uniforms.base_color));
+  if (!(material.features & MATERIAL_EMISSIVE_TEXTURE))
+    memcpy(uniforms.emissive, material.emissive_factor, sizeof(material.emissive_factor));
+  uniforms.shininess = material_shininess;
+  uniforms.alpha_cutoff = material.alpha_cutoff;
+  return uniforms;
+}
+
+// material의 래스터 상태. BLEND는 블렌딩을 켜고 깊이는 쓰지 않으며, doubleSided가 아니면 뒷면을 컬링한다.
+void apply_material_state(const MaterialRecord &material)
+{
+  if (material.alpha_mode == ALPHA_BLEND)
+  {
+    glEnable(GL_BLEND);
+    glDepthMask(GL_FALSE);
+  }
+  else
+  {
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+  }
+
+  if (material.features & MATERIAL_DOUBLE_SIDED)
+    glDisable(GL_CULL_FACE);
+  else
+    glEnable(GL_CULL_FACE);
+}
+
+// material_records의 MaterialUniforms를 한 UBO에 순서대로 올린다. 내용이 같아도 합치지 않으므로
+// material마다 자기 레코드가 있다. (0번은 material이 없는 primitive의 기본값)
+void init_material_uniforms()
+{
+  delete_material_uniforms();
+
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_buffer_alignment);
+  const size_t record_size = (sizeof(MaterialUniforms) + uniform_buffer_alignment - 1) /
+                             uniform_buffer_alignment * uniform_buffer_alignment;
+
+  std::vector<unsigned char> data(material_records.size() * record_size, 0);
+  for (size_t i = 0; i < material_records.size(); ++i)
+  {
+    MaterialUniforms uniforms = material_uniform_record(material_records[i]);
+    material_records[i].uniforms = static_cast<GLintptr>(i * record_size);
+    memcpy(&data[i * record_size], &uniforms, sizeof(uniforms));
+  }
+
+  // 서로 다른 material이 한 구간을 같이 쓰지 않고, 각 구간에 그 material의 값이 들어 있는지 확인한다.
+  for (size_t i = 0; i < material_records.size(); ++i)
+  {
+    MaterialUniforms uniforms = material_uniform_record(material_records[i]);
+    assert(i == 0 || material_records[i].uniforms > material_records[i - 1].uniforms);
+    assert(memcmp(&data[material_records[i].uniforms], &uniforms, sizeof(uniforms)) == 0);
+  }
+
+  glGenBuffers(1, &material_buffer);
+  glBindBuffer(GL_UNIFORM_BUFFER, material_buffer);
+  glBufferData(GL_UNIFORM_BUFFER, data.size(), data.data(), GL_STATIC_DRAW);
+  glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+  std::cout << "Uploaded " << material_records.size() << " material uniform records for "
+            << model.materials.size() << " materials (and the default material)" << std::endl;
+}
+
+void delete_material_uniforms()
+{
+  if (material_buffer != 0)
+    glDeleteBuffers(1, &material_buffer);
+  material_buffer = 0;
+}
+
+// 로더 스레드를 시작한다. sync object가 없거나 공유 컨텍스트를 만들지 못하면 false.
+// 창(GLFW)은 메인 스레드에서 만들어야 하므로 보이지 않는 창은 여기서 만든다.
+bool start_resource_loader(GLFWwindow *window, const std::string &filename)
+{
+  if (!(GLEW_VERSION_3_2 || GLEW_ARB_sync))
+    return false;
+
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  resource_loader.context = glfwCreateWindow(1, 1, "loader", NULL, window);
+  glfwDefaultWindowHints();
+  if (!resource_loader.context)
+    return false;
+
+  resource_loader.begin = std::chrono::steady_clock::now();
+  resource_loader.thread = std::thread(run_resource_loader, filename);
+  return true;
+}
+
+// 로더 스레드 본체. 렌더 스레드가 scene을 가져가기 전까지 model과 VBO는 이 스레드만 쓴다.
+void run_resource_loader(std::string filename)
+{
+  glfwMakeContextCurrent(resource_loader.context);
+
+  bool loaded = load_scene(filename);
+  if (loaded)
+    init_buffer_objects();
+  GLsync fence = loaded ? glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) : 0;
+  // 다른 컨텍스트에서 확인하는 fence는 이 컨텍스트의 명령이 flush되어야 끝난다.
+  glFlush();
+  {
+    std::lock_guard<std::mutex> lock(resource_loader.mutex);
+    resource_loader.scene_published = true;
+    resource_loader.scene_loaded = loaded;
+    resource_loader.scene_fence = fence;
+  }
+
+  if (loaded && !resource_loader.cancel)
+  {
+    init_texture_objects(true);
+  }
+
+  glfwMakeContextCurrent(NULL);
+}
+
+// 로더 스레드에서: 지금까지 올린 텍스처를 fence와 함께 내보낸다.
+void publish_textures()
+{
+  TexturePublication publication;
+  publication.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  glFlush();
+  publication.bindings = texture_bindings;
+  publication.num_images = image_textures.size() -
+                           std::count(image_textures.begin(), image_textures.end(), GLuint(0));
+  resource_loader.pending_bytes = 0;
+
+  std::lock_guard<std::mutex> lock(resource_loader.mutex);
+  resource_loader.texture_publications.push_back(publication);
+}
+
+// 렌더 스레드에서 프레임마다: fence가 끝난 단계를 가져온다. 기다리지는 않는다.
+// 로더 스레드가 scene을 읽지 못했으면 스레드를 정리하고 동기 경로처럼 창을 닫는다.
+void poll_resource_loader(GLFWwindow *window)
+{
+  bool scene_ready = false;
+  bool scene_failed = false;
+  TexturePublication textures;
+  textures.fence = 0;
+  {
+    std::lock_guard<std::mutex> lock(resource_loader.mutex);
+    if (!scene_resident && resource_loader.scene_published && !resource_loader.scene_loaded)
+    {
+      resource_loader.scene_published = false;
+      scene_failed = true;
+    }
+    else if (!scene_resident)
+    {
+      if (!resource_loader.scene_loaded || glClientWaitSync(resource_loader.scene_fence, 0, 0) ==
+                                               GL_TIMEOUT_EXPIRED)
+        return;
+      glDeleteSync(resource_loader.scene_fence);
+      resource_loader.scene_fence = 0;
+      scene_ready = true;
+    }
+
+    // fence는 한 컨텍스트 안에서 순서대로 끝나므로 끝난 것 중 마지막만 반영하면 된다.
+    std::vector<TexturePublication> &publications = resource_loader.texture_publications;
+    size_t ready = publications.size();
+    while (ready > 0 && glClientWaitSync(publications[ready - 1].fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+      ready -= 1;
+    if (ready > 0)
+    {
+      textures = publications[ready - 1];
+      for (size_t i = 0; i < ready; ++i)
+        glDeleteSync(publications[i].fence);
+      publications.erase(publications.begin(), publications.begin() + ready);
+    }
+  }
+
+  double elapsed_ms = std::chrono::duration<double, std::milli>(
+                          std::chrono::steady_clock::now() - resource_loader.begin)
+                          .count();
+  if (scene_failed)
+  {
+    std::cout << "Failed to load scene after " << elapsed_ms << " ms" << std::endl;
+    stop_resource_loader();
+    glfwSetWindowShouldClose(window, GLFW_TRUE);
+    return;
+  }
+  if (scene_ready)
+  {
+    init_scene_objects(textures.bindings);
+    std::cout << "Scene resident after " << elapsed_ms << " ms" << std::endl;
+  }
+  else if (textures.fence != 0)
+  {
+    update_material_textures(textures.bindings);
+  }
+  if (textures.fence != 0)
+    std::cout << "Textures resident: " << textures.num_images << " images after "
+              << elapsed_ms << " ms" << std::endl;
+}
+
+// 로더 스레드를 멈추고(텍스처 사이에서 멈춘다) 가져가지 않은 fence와 보이지 않는 창을 정리한다.
+void stop_resource_loader()
+{
+  if (!resource_loader.thread.joinable())
+    return;
+
+  resource_loader.cancel = true;
+  resource_loader.thread.join();
+
+  if (resource_loader.scene_fence != 0)
+    glDeleteSync(resource_loader.scene_fence);
+  resource_loader.scene_fence = 0;
+  for (TexturePublication &publication : resource_loader.texture_publications)
+    glDeleteSync(publication.fence);
+  resource_loader.texture_publications.clear();
+
+  glfwDestroyWindow(resource_loader.context);
+  resource_loader.context = nullptr;
+}
+
+// 올라간 VBO(와 bindings의 텍스처)로 렌더 스레드 쪽 객체를 만든다.
+void init_scene_objects(const std::vector<TextureBinding> &bindings)
+{
+  init_vertex_array_objects();
+  init_geometry_arena();
+  compile_materials(bindings);
+  init_shader_programs();
+  init_material_uniforms();
+  init_draw_instances();
+  scene_resident = true;
+}
+
+// 텍스처가 더 올라왔을 때: material과 그에 맞는 program을 다시 정한다.
+void update_material_textures(const std::vector<TextureBinding> &bindings)
+{
+  compile_materials(bindings);
+  init_shader_programs();
+  init_material_uniforms();
+}
+
+// 다음 모델을 올리기 전에 모델에 딸린 GL 객체와 model을 비운다. program은 다음 모델도 쓰므로 남긴다.
+void unload_scene()
+{
+  delete_material_uniforms();
+  delete_texture_objects();
+  delete_geometry_arena();
+  delete_vertex_array_objects();
+  delete_buffer_objects();
+  model = tinygltf::Model();
+  scene_resident = false;
+}
+
+void set_transform()
+{
+  const std::vector<tinygltf::Node> &nodes = model.nodes;
+  const std::vector<tinygltf::Camera> &cameras = model.cameras;
+  const tinygltf::Camera &camera = cameras[camera_index];
+
+  if (model.cameras.size() > 0)
+  {
+    if (camera.type.compare("perspective") == 0)
+    {
+      float fovy = kmuvcl::math::rad2deg(camera.perspective.yfov);
+      float aspectRatio = camera.perspective.aspectRatio;
+      float znear = camera.perspective.znear;
+      float zfar = camera.perspective.zfar;
+      /*
+    std::cout << "(camera.mode() == Camera::kPerspective)" << std::endl;
+    std::cout << "(fovy, aspect, n, f): " << fovy << ", " << aspectRatio << ", " << znear << ", " << zfar << std::endl;
+    */
+      mat_proj = kmuvcl::math::perspective(fovy, aspectRatio, znear, zfar);
+    }
+    else // (camera.type.compare("orthographic") == 0)
+    {
+      float xmag = camera.orthographic.xmag;
+      float ymag = camera.orthographic.ymag;
+      float znear = camera.orthographic.znear;
+      float zfar = camera.orthographic.zfar;
+      /*
+    std::cout << "(camera.mode() == Camera::kOrtho)" << std::endl;
+    std::cout << "(xmag, ymag, n, f): " << xmag << ", " << ymag << ", " << znear << ", " << zfar << std::endl;
+    */
+      mat_proj = kmuvcl::math::ortho(-xmag, xmag, -ymag, ymag, znear, zfar);
+    }
+
+    // view 행렬은 카메라 노드의 world 행렬(부모 노드와 matrix까지 포함)의 역행렬이다.
+    update_world_transforms();
+    for (size_t i = 0; i < flat_scene.node.size(); ++i)
+    {
+      if (nodes[flat_scene.node[i]].camera == camera_index)
+      {
+        mat_view = affine_inverse(flat_scene.world[i]);
+        break;
+      }
+    }
+  }
+  else
+  {
+    //mat_view.set_to_identity();
+    mat_view = kmuvcl::math::translate(-1.3f, -1.3f, -4.0f);
+
+    //mat_proj.set_to_identity();
+    float fovy = 70.0f;
+    float aspectRatio = 1.0f;
+    float znear = 0.01f;
+    float zfar = 100.0f;
+
+    mat_proj = kmuvcl::math::perspective(fovy, aspectRatio, znear, zfar);
+  }
+}
+
+void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods)
+{
+  if (key == GLFW_KEY_Q && action == GLFW_PRESS)
+  {
+    camera_index = camera_index == 0 ? 1 : 0;
+  }
+  if (key == GLFW_KEY_S && action == GLFW_PRESS)
+  {
+    sort_render_queue = !sort_render_queue;
+    std::cout << "Render queue sorting " << (sort_render_queue ? "on" : "off")
+              << " (last frame: " << render_stats.draw_calls << " draw calls, "
+              << render_stats.state_changes() << " state changes)" << std::endl;
+  }
+  if (key == GLFW_KEY_M && action == GLFW_PRESS)
+  {
+    use_multi_draw = !use_multi_draw;
+    std::cout << "Multi-draw indirect " << (use_multi_draw && multi_draw_supported ? "on" : "off")
+              << (multi_draw_supported ? "" : " (not supported)")
+              << " (last frame: " << render_stats.draw_calls << " draw calls)" << std::endl;
+  }
+  if (key == GLFW_KEY_R && action == GLFW_PRESS)
+  {
+    rotate_next_node(15.0f);
+  }
+  if (key == GLFW_KEY_C && action == GLFW_PRESS)
+  {
+    frustum_culling = !frustum_culling;
+    std::cout << "Frustum culling " << (frustum_culling ? "on" : "off")
+              << " (last frame: " << render_stats.culled << " primitives culled, "
+              << render_stats.triangles << " triangles submitted)" << std::endl;
+  }
+}
+
+// T * R * S. glTF 노드의 local 변환 순서를 따른다.
+kmuvcl::math::mat4f compose_trs(const kmuvcl::math::vec3f &t,
+                                const kmuvcl::math::vec4f &r,
+                                const kmuvcl::math::vec3f &s)
+{
+  kmuvcl::math::mat4f m = kmuvcl::math::quat2mat(r(0), r(1), r(2), r(3));
+  for (unsigned int c = 0; c < 3; ++c)
+  {
+    m(0, c) *= s(c);
+    m(1, c) *= s(c);
+    m(2, c) *= s(c);
+  }
+  m(0, 3) = t(0);
+  m(1, 3) = t(1);
+  m(2, 3) = t(2);
+  return m;
+}
+
+// 마지막 행이 (0, 0, 0, 1)인 행렬의 역행렬. 3x3 부분은 여인수로 뒤집고 이동은 -A^-1 t이다.
+kmuvcl::math::mat4f affine_inverse(const kmuvcl::math::mat4f &m)
+{
+  kmuvcl::math::mat4f inv;
+  inv.set_to_identity();
+  inv(0, 0) = m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1);
+  inv(0, 1) = m(0, 2) * m(2, 1) - m(0, 1) * m(2, 2);
+  inv(0, 2) = m(0, 1) * m(1, 2) - m(0, 2) * m(1, 1);
+  inv(1, 0) = m(1, 2) * m(2, 0) - m(1, 0) * m(2, 2);
+  inv(1, 1) = m(0, 0) * m(2, 2) - m(0, 2) * m(2, 0);
+  inv(1, 2) = m(0, 2) * m(1, 0) - m(0, 0) * m(1, 2);
+  inv(2, 0) = m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0);
+  inv(2, 1) = m(0, 1) * m(2, 0) - m(0, 0) * m(2, 1);
+  inv(2, 2) = m(0, 0) * m(1, 1) - m(0, 1) * m(1, 0);
+
+  float det = m(0, 0) * inv(0, 0) + m(0, 1) * inv(1, 0) + m(0, 2) * inv(2, 0);
+  if (det != 0.0f)
+  {
+    for (unsigned int r = 0; r < 3; ++r)
+      for (unsigned int c = 0; c < 3; ++c)
+        inv(r, c) /= det;
+  }
+  for (unsigned int r = 0; r < 3; ++r)
+    inv(r, 3) = -(inv(r, 0) * m(0, 3) + inv(r, 1) * m(1, 3) + inv(r, 2) * m(2, 3));
+  return inv;
+}
+
+void flatten_scene()
+{
+  const std::vector<tinygltf::Node> &nodes = model.nodes;
+
+  flat_scene = FlatScene();
+
+  // (노드 인덱스, 부모 flat 인덱스)
+  std::vector<std::pair<int, int>> stack;
+  for (const tinygltf::Scene &scene : model.scenes)
+  {
+    for (size_t i = scene.nodes.size(); i > 0; --i)
+      stack.push_back(std::make_pair(scene.nodes[i - 1], -1));
+
+    while (!stack.empty())
+    {
+      int node_index = stack.back().first;
+      int parent = stack.back().second;
+      stack.pop_back();
+
+      const tinygltf::Node &node = nodes[node_index];
+      int flat_index = static_cast<int>(flat_scene.node.size());
+
+      kmuvcl::math::vec3f t(0.0f, 0.0f, 0.0f);
+      kmuvcl::math::vec4f r(0.0f, 0.0f, 0.0f, 1.0f);
+      kmuvcl::math::vec3f s(1.0f, 1.0f, 1.0f);
+      if (node.translation.size() == 3)
+        t = kmuvcl::math::vec3f(node.translation[0], node.translation[1], node.translation[2]);
+      if (node.rotation.size() == 4)
+        r = kmuvcl::math::vec4f(node.rotation[0], node.rotation[1], node.rotation[2], node.rotation[3]);
+      if (node.scale.size() == 3)
+        s = kmuvcl::math::vec3f(node.scale[0], node.scale[1], node.scale[2]);
+
+      kmuvcl::math::mat4f local;
+      if (node.matrix.size() == 16)
+      {
+        // glTF의 matrix는 열 우선(column major) 순서이다.
+        for (unsigned int c = 0; c < 4; ++c)
+          for (unsigned int r = 0; r < 4; ++r)
+            local(r, c) = static_cast<float>(node.matrix[c * 4 + r]);
+      }
+      else
+      {
+        local = compose_trs(t, r, s);
+      }
+
+      flat_scene.node.push_back(node_index);
+      flat_scene.parent.push_back(parent);
+      flat_scene.mesh.push_back(node.mesh);
+      flat_scene.translation.push_back(t);
+      flat_scene.rotation.push_back(r);
+      flat_scene.scale.push_back(s);
+      flat_scene.local.push_back(local);
+      flat_scene.world.push_back(local);
+      flat_scene.dirty.push_back(1);
+
+      for (size_t i = node.children.size(); i > 0; --i)
+        stack.push_back(std::make_pair(node.children[i - 1], flat_index));
+    }
+  }
+
+  flat_scene.any_dirty = !flat_scene.node.empty();
+  update_world_transforms();
+}
+
+// 캐시에 저장할 flat_scene의 내용 (world는 local로부터 다시 계산한다)
+std::vector<SceneCacheNode> flat_scene_records()
+{
+  std::vector<SceneCacheNode> records(flat_scene.node.size());
+  for (size_t i = 0; i < records.size(); ++i)
+  {
+    SceneCacheNode &record = records[i];
+    record.node = flat_scene.node[i];
+    record.parent = flat_scene.parent[i];
+    record.mesh = flat_scene.mesh[i];
+    for (unsigned int k = 0; k < 3; ++k)
+    {
+      record.translation[k] = flat_scene.translation[i](k);
+      record.scale[k] = flat_scene.scale[i](k);
+    }
+    for (unsigned int k = 0; k < 4; ++k)
+      record.rotation[k] = flat_scene.rotation[i](k);
+    for (unsigned int c = 0; c < 4; ++c)
+      for (unsigned int r = 0; r < 4; ++r)
+        record.local[c * 4 + r] = flat_scene.local[i](r, c);
+  }
+  return records;
+}
+
+void restore_flat_scene(const std::vector<SceneCacheNode> &records)
+{
+  flat_scene = FlatScene();
+  for (const SceneCacheNode &record : records)
+  {
+    kmuvcl::math::mat4f local;
+    for (unsigned int c = 0; c < 4; ++c)
+      for (unsigned int r = 0; r < 4; ++r)
+        local(r, c) = record.local[c * 4 + r];
+
+    flat_scene.node.push_back(record.node);
+    flat_scene.parent.push_back(record.parent);
+    flat_scene.mesh.push_back(record.mesh);
+    flat_scene.translation.push_back(kmuvcl::math::vec3f(
+        record.translation[0], record.translation[1], record.translation[2]));
+    flat_scene.rotation.push_back(kmuvcl::math::vec4f(
+        record.rotation[0], record.rotation[1], record.rotation[2], record.rotation[3]));
+    flat_scene.scale.push_back(kmuvcl::math::vec3f(
+        record.scale[0], record.scale[1], record.scale[2]));
+    flat_scene.local.push_back(local);
+    flat_scene.world.push_back(local);
+    flat_scene.dirty.push_back(1);
+  }
+
+  flat_scene.any_dirty = !flat_scene.node.empty();
+  update_world_transforms();
+}
+
+// accessor를 float 배열로 읽는다. (요소마다 num_components개) 정수는 normalized면 [-1, 1] 또는
+// [0, 1]로, 아니면 값 그대로 바꾼다. (KHR_mesh_quantization은 둘 다 쓴다)
+bool read_accessor_floats(int accessor_index, int num_components, std::vector<float> *values)
+{
+  if (accessor_index < 0 || size_t(accessor_index) >= model.accessors.size())
+    return false;
+
+  const tinygltf::Accessor &accessor = model.accessors[accessor_index];
+  if (accessor.bufferView < 0 || accessor.sparse.isSparse ||
+      tinygltf::GetTypeSizeInBytes(accessor.type) != num_components)
+    return false;
+
+  const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
+  const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
+  const int component_size = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+  const int byteStride = accessor.ByteStride(bufferView);
+  if (component_size <= 0 || byteStride <= 0)
+    return false;
+
+  size_t begin = bufferView.byteOffset + accessor.byteOffset;
+  if (accessor.count > 0 &&
+      begin + (accessor.count - 1) * size_t(byteStride) + num_components * component_size > buffer.Size())
+    return false;
+
+  values->resize(accessor.count * num_components);
+  for (size_t i = 0; i < accessor.count; ++i)
+  {
+    const unsigned char *element = buffer.Data() + begin + i * size_t(byteStride);
+    for (int k = 0; k < num_components; ++k)
+    {
+      const unsigned char *p = element + k * component_size;
+      float value = 0.0f;
+      switch (accessor.componentType)
+      {
+      case TINYGLTF_COMPONENT_TYPE_FLOAT:
+        memcpy(&value, p, sizeof(float));
+        break;
+      case TINYGLTF_COMPONENT_TYPE_BYTE:
+      {
+        int8_t v = *reinterpret_cast<const int8_t *>(p);
+        value = accessor.normalized ? std::max(v / 127.0f, -1.0f) : float(v);
+        break;
+      }
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        value = accessor.normalized ? *p / 255.0f : float(*p);
+        break;
+      case TINYGLTF_COMPONENT_TYPE_SHORT:
+      {
+        int16_t v;
+        memcpy(&v, p, sizeof(v));
+        value = accessor.normalized ? std::max(v / 32767.0f, -1.0f) : float(v);
+        break;
+      }
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+      {
+        uint16_t v;
+        memcpy(&v, p, sizeof(v));
+        value = accessor.normalized ? v / 65535.0f : float(v);
+        break;
+      }
+      default:
+        return false;
+      }
+      (*values)[i * num_components + k] = value;
+    }
+  }
+  return true;
+}
+
+// 노드의 EXT_mesh_gpu_instancing 확장에서 instance별 TRS를 읽어 local 행렬로 만든다.
+// 빠진 attribute는 기본값(이동 없음, 회전 없음, 크기 1)을 쓴다.
+void read_gpu_instances()
+{
+  node_gpu_instances.assign(model.nodes.size(), std::vector<kmuvcl::math::mat4f>());
+
+  for (size_t n = 0; n < model.nodes.size(); ++n)
+  {
+    const tinygltf::Node &node = model.nodes[n];
+    tinygltf::ExtensionMap::const_iterator ext = node.extensions.find("EXT_mesh_gpu_instancing");
+    if (node.mesh < 0 || ext == node.extensions.end() || !ext->second.Has("attributes"))
+      continue;
+
+    const tinygltf::Value &attributes = ext->second.Get("attributes");
+    const char *names[3] = {"TRANSLATION", "ROTATION", "SCALE"};
+    const int components[3] = {3, 4, 3};
+    std::vector<float> values[3];
+    size_t count = 0;
+    bool valid = true;
+    for (int a = 0; a < 3 && valid; ++a)
+    {
+      if (!attributes.Has(names[a]))
+        continue;
+      const tinygltf::Value &index = attributes.Get(names[a]);
+      valid = index.IsInt() && read_accessor_floats(index.Get<int>(), components[a], &values[a]);
+      size_t n_values = values[a].size() / components[a];
+      if (valid && count != 0 && n_values != count)
+        valid = false;
+      count = std::max(count, n_values);
+    }
+    if (!valid)
+    {
+      std::cout << "Ignoring invalid EXT_mesh_gpu_instancing on node " << n << std::endl;
+      continue;
+    }
+
+    std::vector<kmuvcl::math::mat4f> &instances = node_gpu_instances[n];
+    instances.resize(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      kmuvcl::math::vec3f t(0.0f, 0.0f, 0.0f);
+      kmuvcl::math::vec4f r(0.0f, 0.0f, 0.0f, 1.0f);
+      kmuvcl::math::vec3f sc(1.0f, 1.0f, 1.0f);
+      if (!values[0].empty())
+        t = kmuvcl::math::vec3f(values[0][i * 3], values[0][i * 3 + 1], values[0][i * 3 + 2]);
+      if (!values[1].empty())
+        r = kmuvcl::math::vec4f(values[1][i * 4], values[1][i * 4 + 1],
+                                values[1][i * 4 + 2], values[1][i * 4 + 3]);
+      if (!values[2].empty())
+        sc = kmuvcl::math::vec3f(values[2][i * 3], values[2][i * 3 + 1], values[2][i * 3 + 2]);
+      instances[i] = compose_trs(t, r, sc);
+    }
+  }
+}
+
+std::vector<SceneCacheInstance> gpu_instance_records()
+{
+  std::vector<SceneCacheInstance> records;
+  for (size_t n = 0; n < node_gpu_instances.size(); ++n)
+  {
+    for (const kmuvcl::math::mat4f &local : node_gpu_instances[n])
+    {
+      SceneCacheInstance record;
+      record.node = static_cast<int32_t>(n);
+      for (unsigned int c = 0; c < 4; ++c)
+        for (unsigned int r = 0; r < 4; ++r)
+          record.local[c * 4 + r] = local(r, c);
+      records.push_back(record);
+    }
+  }
+  return records;
+}
+
+void restore_gpu_instances(const std::vector<SceneCacheInstance> &records)
+{
+  node_gpu_instances.assign(model.nodes.size(), std::vector<kmuvcl::math::mat4f>());
+  for (const SceneCacheInstance &record : records)
+  {
+    kmuvcl::math::mat4f local;
+    for (unsigned int c = 0; c < 4; ++c)
+      for (unsigned int r = 0; r < 4; ++r)
+        local(r, c) = record.local[c * 4 + r];
+    node_gpu_instances[record.node].push_back(local);
+  }
+}
+
+// 노드의 local 행렬을 바꾸고 world 갱신 대상으로 표시한다. 하위 노드는 다음
+// update_world_transforms()가 부모의 dirty를 따라 같이 다시 계산한다.
+// (translation/rotation/scale은 glTF의 값 그대로 둔다. matrix로 주어진 노드도 있으므로)
+void set_node_local(int flat_index, const kmuvcl::math::mat4f &local)
+{
+  flat_scene.local[flat_index] = local;
+  flat_scene.dirty[flat_index] = 1;
+  flat_scene.any_dirty = true;
+}
+
+// 노드의 local TRS를 바꾸고 world 갱신 대상으로 표시한다. (애니메이션 등에서 사용)
+void set_node_trs(int flat_index, const kmuvcl::math::vec3f &t,
+                  const kmuvcl::math::vec4f &r, const kmuvcl::math::vec3f &s)
+{
+  flat_scene.translation[flat_index] = t;
+  flat_scene.rotation[flat_index] = r;
+  flat_scene.scale[flat_index] = s;
+  set_node_local(flat_index, compose_trs(t, r, s));
+}
+
+// local이 바뀐 노드와 그 하위 노드의 world 행렬만 다시 계산한다.
+// 부모가 항상 앞에 있으므로 한 번의 순차 순회로 dirty가 자식에게 전파된다.
+void update_world_transforms()
+{
+  if (!flat_scene.any_dirty)
+    return;
+
+  const size_t num_nodes = flat_scene.node.size();
+  for (size_t i = 0; i < num_nodes; ++i)
+  {
+    int parent = flat_scene.parent[i];
+    if (parent >= 0 && flat_scene.dirty[parent])
+      flat_scene.dirty[i] = 1;
+
+    if (!flat_scene.dirty[i])
+      continue;
+
+    if (parent >= 0)
+      flat_scene.world[i] = flat_scene.world[parent] * flat_scene.local[i];
+    else
+      flat_scene.world[i] = flat_scene.local[i];
+    flat_scene.moved.push_back(static_cast<int>(i));
+  }
+
+  std::fill(flat_scene.dirty.begin(), flat_scene.dirty.end(), 0);
+  flat_scene.any_dirty = false;
+}
+
+// 모든 world 행렬을 local로부터 처음부터 다시 계산해 지금의 flat_scene.world와 비교한다.
+// 증분 갱신이 하위 노드를 빠뜨리면 여기서 0이 아닌 차이가 나온다.
+float world_transform_error()
+{
+  const size_t num_nodes = flat_scene.node.size();
+  std::vector<kmuvcl::math::mat4f> full(num_nodes);
+  float max_error = 0.0f;
+  for (size_t i = 0; i < num_nodes; ++i)
+  {
+    int parent = flat_scene.parent[i];
+    full[i] = parent >= 0 ? full[parent] * flat_scene.local[i] : flat_scene.local[i];
+    for (unsigned int c = 0; c < 4; ++c)
+      for (unsigned int r = 0; r < 4; ++r)
+        max_error = std::max(max_error, std::abs(full[i](r, c) - flat_scene.world[i](r, c)));
+  }
+  return max_error;
+}
+
+// 메쉬나 자식이 있는 노드를 누를 때마다 하나씩 돌아가며 local Y축으로 degrees만큼 돌리고,
+// 증분 갱신한 world 행렬이 전체를 다시 계산한 것과 같은지 출력한다.
+void rotate_next_node(float degrees)
+{
+  static size_t next_node = 0;
+
+  const size_t num_nodes = flat_scene.node.size();
+  for (size_t k = 0; k < num_nodes; ++k)
+  {
+    size_t i = (next_node + k) % num_nodes;
+    bool has_children = i + 1 < num_nodes && flat_scene.parent[i + 1] == static_cast<int>(i);
+    if (flat_scene.mesh[i] < 0 && !has_children)
+      continue;
+    next_node = i + 1;
+
+    // local * (Y축 회전): 노드의 local 좌표계에서 돌린다.
+    set_node_local(static_cast<int>(i),
+                   flat_scene.local[i] * kmuvcl::math::rotate(degrees, 0.0f, 1.0f, 0.0f));
+
+    size_t moved_before = flat_scene.moved.size();
+    update_world_transforms();
+    std::cout << "Rotated node " << flat_scene.node[i] << ": "
+              << flat_scene.moved.size() - moved_before << " of " << num_nodes
+              << " world matrices updated, max difference from a full update "
+              << world_transform_error() << std::endl;
+    return;
+  }
+}
+
+// 상위 비트부터: blend 1 | program 7 | texture 16 | sampler 12 | material 16 | VAO 12.
+// blend 외의 필드는 GL 이름(또는 인덱스+1)의 하위 비트만 쓴다. 비트가 겹쳐도 정렬 품질만
+// 조금 떨어질 뿐 제출할 때는 실제 값을 비교하므로 결과는 같다. 블렌딩하는 패킷끼리는
+// 깊이 순서로 정렬하지 않는다.
+uint64_t draw_packet_key(const DrawPacket &packet)
+{
+  uint64_t key = 0;
+  key |= uint64_t(packet.blend ? 1 : 0) << 63;
+  key |= uint64_t(packet.program & 0x7f) << 56;
+  key |= uint64_t(packet.texture.texture & 0xffff) << 40;
+  key |= uint64_t(packet.texture.sampler & 0xfff) << 28;
+  key |= uint64_t((packet.material + 1) & 0xffff) << 12;
+  key |= uint64_t(packet.vao & 0xfff);
+  return key;
+}
+
+size_t triangle_count(GLenum mode, GLsizei count)
+{
+  if (mode == GL_TRIANGLES)
+    return count / 3;
+  if (mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN)
+    return count > 2 ? count - 2 : 0;
+  return 0;
+}
+
+kmuvcl::math::mat4f instance_world(const DrawInstance &instance)
+{
+  kmuvcl::math::mat4f world = flat_scene.world[instance.node];
+  if (instance.gpu_instance >= 0)
+    world = world * node_gpu_instances[flat_scene.node[instance.node]][instance.gpu_instance];
+  if (!mesh_dequantization.empty())
+    world = world * mesh_dequantization[instance.mesh];
+  return world;
+}
+
+void set_instance_bounds(size_t index)
+{
+  const DrawInstance &instance = draw_instances[index];
+  const PrimitiveObject &object = primitive_objects[instance.mesh][instance.primitive];
+  if (culling::is_valid(object.bounds))
+  {
+    kmuvcl::math::mat4f world = instance_world(instance);
+    const float *m = world;
+    world_boxes.set(index, m, object.bounds);
+  }
+  else
+  {
+    world_boxes.set_unbounded(index);
+  }
+}
+
+// scene과 VAO(로컬 bounds)가 준비된 뒤 한 번 호출한다. instance 목록과 world bounds를 만들고,
+// instance가 충분히 많으면 BVH를 만든다.
+void init_draw_instances()
+{
+  draw_instances.clear();
+  node_first_instance.assign(flat_scene.node.size() + 1, 0);
+  if (node_gpu_instances.size() != model.nodes.size())
+    node_gpu_instances.assign(model.nodes.size(), std::vector<kmuvcl::math::mat4f>());
+
+  int num_slots = 0;
+  primitive_slots.assign(primitive_objects.size(), std::vector<int>());
+  for (size_t m = 0; m < primitive_objects.size(); ++m)
+  {
+    for (size_t j = 0; j < primitive_objects[m].size(); ++j)
+      primitive_slots[m].push_back(num_slots++);
+  }
+  slot_packet.assign(num_slots, -1);
+
+  update_world_transforms();
+  for (size_t i = 0; i < flat_scene.node.size(); ++i)
+  {
+    node_first_instance[i] = draw_instances.size();
+    int mesh_index = flat_scene.mesh[i];
+    if (mesh_index < 0)
+      continue;
+
+    // EXT_mesh_gpu_instancing이 있으면 노드 자체는 그리지 않고 instance만 그린다.
+    int num_gpu_instances = static_cast<int>(node_gpu_instances[flat_scene.node[i]].size());
+    for (int g = num_gpu_instances > 0 ? 0 : -1; g < num_gpu_instances; ++g)
+    {
+      for (size_t j = 0; j < primitive_objects[mesh_index].size(); ++j)
+      {
+        DrawInstance instance = {static_cast<int>(i), mesh_index, static_cast<int>(j), g,
+                                 primitive_slots[mesh_index][j]};
+        draw_instances.push_back(instance);
+      }
+    }
+  }
+  node_first_instance[flat_scene.node.size()] = draw_instances.size();
+  flat_scene.moved.clear();
+
+  world_boxes.resize(draw_instances.size());
+  std::vector<uint32_t> bounded;
+  unbounded_instances.clear();
+  for (size_t i = 0; i < draw_instances.size(); ++i)
+  {
+    set_instance_bounds(i);
+    if (world_boxes.is_unbounded(i))
+      unbounded_instances.push_back(static_cast<uint32_t>(i));
+    else
+      bounded.push_back(static_cast<uint32_t>(i));
+  }
+
+  use_scene_bvh = bounded.size() >= bvh_min_instances;
+  scene_bvh_stale = false;
+  if (use_scene_bvh)
+  {
+    std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+    bvh::build(scene_bvh, world_boxes, bounded);
+    std::cout << "Built BVH over " << bounded.size() << " instances ("
+              << scene_bvh.nodes.size() << " nodes) in "
+              << std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - begin)
+                     .count()
+              << " ms" << std::endl;
+  }
+  else
+  {
+    scene_bvh = bvh::Bvh();
+  }
+}
+
+// update_world_transforms()에서 world가 바뀐 노드의 instance bounds만 다시 계산하고 BVH를 refit한다.
+// 한 프레임에 바뀐 상자가 많아 refit이 선형 컬링보다 비싸면(bvh::refit_beats_linear_cull) refit을 미루고
+// 선형으로 컬링하다가, 아무것도 움직이지 않은 첫 프레임에 refit_all()로 한 번에 맞춘다.
+void update_instance_bounds()
+{
+  if (flat_scene.moved.empty())
+  {
+    if (scene_bvh_stale)
+    {
+      bvh::refit_all(scene_bvh, world_boxes);
+      scene_bvh_stale = false;
+    }
+    return;
+  }
+
+  std::vector<uint32_t> changed;
+  for (int node : flat_scene.moved)
+  {
+    for (size_t i = node_first_instance[node]; i < node_first_instance[node + 1]; ++i)
+    {
+      set_instance_bounds(i);
+      changed.push_back(static_cast<uint32_t>(i));
+    }
+  }
+  flat_scene.moved.clear();
+
+  if (!use_scene_bvh || scene_bvh_stale)
+    return;
+  if (bvh::refit_beats_linear_cull(scene_bvh, changed.size()))
+    bvh::refit(scene_bvh, world_boxes, changed);
+  else
+    scene_bvh_stale = true;
+}
+
+// draw instance마다 mat_VP의 절두체 안에 있는지를 box_visible에 남긴다.
+void cull_primitives()
+{
+  if (!frustum_culling)
+  {
+    box_visible.assign(draw_instances.size(), 1);
+    return;
+  }
+
+  const float *vp = mat_VP;
+  culling::Frustum frustum = culling::extract_frustum(vp);
+  if (!use_scene_bvh || scene_bvh_stale)
+  {
+    culling::cull_boxes(frustum, world_boxes, box_visible);
+    return;
+  }
+
+  box_visible.assign(draw_instances.size(), 0);
+  bvh_query_result.clear();
+  bvh::query_frustum(scene_bvh, world_boxes, frustum, bvh_query_result);
+  for (uint32_t i : bvh_query_result)
+    box_visible[i] = 1;
+  for (uint32_t i : unbounded_instances)
+    box_visible[i] = 1;
+}
+
+void collect_draw_packets()
+{
+  draw_packets.clear();
+  draw_keys.clear();
+
+  update_instance_bounds();
+  cull_primitives();
+
+  // 보이는 instance를 primitive(slot)별 패킷으로 세고, 패킷마다 instance_matrices 구간을 정한다.
+  for (size_t i = 0; i < draw_instances.size(); ++i)
+  {
+    if (!box_visible[i])
+    {
+      render_stats.culled += 1;
+      continue;
+    }
+
+    const DrawInstance &instance = draw_instances[i];
+    int &packet_index = slot_packet[instance.slot];
+    if (packet_index < 0)
+    {
+      const PrimitiveObject &object = primitive_objects[instance.mesh][instance.primitive];
+      const MaterialRecord &material = material_records[object.material + 1];
+
+      DrawPacket packet;
+      packet.program = object.program;
+      packet.vao = object.in_arena ? arena_vao : object.vao;
+      packet.texture = material.base_color_texture;
+      packet.material = object.material;
+      packet.blend = material.alpha_mode == ALPHA_BLEND;
+      packet.mode = object.mode;
+      packet.count = object.count;
+      packet.index_type = object.index_type;
+      packet.index_offset = object.index_offset;
+      packet.in_arena = object.in_arena;
+      packet.arena_first_index = object.arena_first_index;
+      packet.arena_base_vertex = object.arena_base_vertex;
+
+      packet_index = static_cast<int>(draw_packets.size());
+      draw_keys.push_back(std::make_pair(draw_packet_key(packet),
+                                         static_cast<uint32_t>(draw_packets.size())));
+      draw_packets.push_back(packet);
+    }
+    draw_packets[packet_index].instance_count += 1;
+  }
+
+  size_t num_instances = 0;
+  for (DrawPacket &packet : draw_packets)
+  {
+    packet.first_instance = num_instances;
+    num_instances += packet.instance_count;
+    packet.instance_count = 0;
+  }
+
+  instance_matrices.resize(num_instances);
+  for (size_t i = 0; i < draw_instances.size(); ++i)
+  {
+    if (!box_visible[i])
+      continue;
+
+    const DrawInstance &instance = draw_instances[i];
+    DrawPacket &packet = draw_packets[slot_packet[instance.slot]];
+    instance_matrices[packet.first_instance + packet.instance_count] = instance_world(instance);
+    packet.instance_count += 1;
+  }
+
+  for (const DrawInstance &instance : draw_instances)
+    slot_packet[instance.slot] = -1;
+
+// 키가 같으면 인덱스(scene graph 순서)로 정렬되어 결과가 프레임마다 같다.
+  if (sort_render_queue)
+    std::sort(draw_keys.begin(), draw_keys.end());
+}
+
+void init_frame_ring(size_t region_size)
+{
+  delete_frame_ring();
+
+  frame_ring.region_size = region_size;
+  frame_ring.persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+
+  const GLsizeiptr size = static_cast<GLsizeiptr>(region_size * frame_ring_regions);
+  glGenBuffers(1, &frame_ring.buffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, frame_ring.buffer);
+  if (frame_ring.persistent)
+  {
+    // coherent로 map하면 쓴 내용이 flush 없이 그 뒤의 draw에 보인다.
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glBufferStorage(GL_COPY_WRITE_BUFFER, size, NULL, flags);
+    frame_ring.mapped = static_cast<unsigned char *>(
+        glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, size, flags));
+  }
+  else
+  {
+    glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STREAM_DRAW);
+  }
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+// 버퍼를 지워도 GPU가 아직 읽는 중이면 드라이버가 다 읽은 뒤에 해제한다.
+void delete_frame_ring()
+{
+  for (GLsync &fence : frame_ring.fences)
+  {
+    if (fence != 0)
+      glDeleteSync(fence);
+    fence = 0;
+  }
+
+  if (frame_ring.buffer != 0)
+  {
+    if (frame_ring.mapped)
+    {
+      glBindBuffer(GL_COPY_WRITE_BUFFER, frame_ring.buffer);
+      glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+      glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    glDeleteBuffers(1, &frame_ring.buffer);
+  }
+
+  size_t waits = frame_ring.waits;
+  frame_ring = FrameRing();
+  frame_ring.waits = waits;
+}
+
+// 이번 프레임 구간에 bytes만큼 쓸 수 있게 한다. 구간이 작으면 ring을 키워서 다시 만들고,
+// 구간을 GPU가 아직 읽고 있으면 그 fence가 끝날 때까지 기다린다.
+void begin_frame_ring(size_t bytes)
+{
+  if (bytes > frame_ring.region_size)
+  {
+    size_t region_size = std::max(frame_ring.region_size, frame_ring_initial_size);
+    while (region_size < bytes)
+      region_size *= 2;
+    init_frame_ring(region_size);
+    std::cout << "Frame ring resized to " << frame_ring_regions << " x " << region_size
+              << " bytes" << std::endl;
+  }
+
+  GLsync &fence = frame_ring.fences[frame_ring.region];
+  if (fence != 0)
+  {
+    if (wait_fence(fence))
+      frame_ring.waits += 1;
+    glDeleteSync(fence);
+    fence = 0;
+  }
+
+  frame_ring.used = 0;
+  if (!frame_ring.persistent)
+  {
+    // fence로 이미 동기화했으므로 드라이버가 따로 기다리지 않게 unsynchronized로 map한다.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, frame_ring.buffer);
+    frame_ring.mapped = static_cast<unsigned char *>(glMapBufferRange(
+        GL_COPY_WRITE_BUFFER, frame_ring.region * frame_ring.region_size, frame_ring.region_size,
+        GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT));
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+}
+
+// 이번 구간에 data를 alignment에 맞춰 쓰고, 버퍼 안의 위치를 돌려준다.
+// begin_frame_ring()에 넘긴 bytes가 정렬로 늘어나는 만큼까지 포함해야 한다.
+GLintptr frame_ring_write(const void *data, size_t size, size_t alignment)
+{
+  size_t offset = (frame_ring.used + alignment - 1) / alignment * alignment;
+  assert(offset + size <= frame_ring.region_size);
+  frame_ring.used = offset + size;
+
+  size_t region_offset = frame_ring.region * frame_ring.region_size;
+  unsigned char *dst = frame_ring.mapped + (frame_ring.persistent ? region_offset : 0) + offset;
+  if (size > 0)
+    memcpy(dst, data, size);
+  return static_cast<GLintptr>(region_offset + offset);
+}
+
+// persistent map이 아니면 draw가 읽기 전에 구간의 map을 푼다.
+void finish_frame_ring_writes()
+{
+  if (frame_ring.persistent)
+    return;
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, frame_ring.buffer);
+  glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  frame_ring.mapped = nullptr;
+}
+
+// 이번 구간을 읽는 명령을 모두 낸 뒤, 프레임 끝(swap 직전)에 한 번 호출한다.
+// (fence를 만들면 명령을 flush하는 드라이버가 있어 그리기 제출 시간 측정 밖에 둔다)
+// begin_frame_ring() 없이 불려도 이전 fence가 남지 않게 지우고 덮어쓴다.
+void end_frame_ring()
+{
+  GLsync &fence = frame_ring.fences[frame_ring.region];
+  if (fence != 0)
+    glDeleteSync(fence);
+  fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  frame_ring.region = (frame_ring.region + 1) % frame_ring_regions;
+}
+
+// 바뀐 상태만 바인딩하고 바꾼 횟수를 render_stats에 센다.
+// 카메라/조명은 프레임마다 FrameBlock에 한 번 바인딩하고, material이 바뀌면 MaterialBlock에
+// 바인딩한 material_buffer 구간과 블렌드/컬링 상태만 바꾼다.
+void bind_draw_state(GLuint program, const TextureBinding &texture, int material,
+                     GLuint vao, GLuint *bound_program, TextureBinding *bound_texture,
+                     int *bound_material, GLuint *bound_vao)
+{
+  if (program != *bound_program)
+  {
+    glUseProgram(program);
+    *bound_program = program;
+    render_stats.program_changes += 1;
+  }
+  if (material != *bound_material)
+  {
+    const MaterialRecord &record = material_records[material + 1];
+    glBindBufferRange(GL_UNIFORM_BUFFER, material_block_binding, material_buffer,
+                      record.uniforms, sizeof(MaterialUniforms));
+    apply_material_state(record);
+    *bound_material = material;
+    render_stats.material_changes += 1;
+  }
+  if (texture.texture != bound_texture->texture)
+  {
+    glBindTexture(GL_TEXTURE_2D, texture.texture);
+    bound_texture->texture = texture.texture;
+    render_stats.texture_changes += 1;
+  }
+  if (texture.sampler != bound_texture->sampler)
+  {
+    glBindSampler(0, texture.sampler);
+    bound_texture->sampler = texture.sampler;
+    render_stats.sampler_changes += 1;
+  }
+  if (vao != *bound_vao)
+  {
+    glBindVertexArray(vao);
+    *bound_vao = vao;
+    render_stats.vao_changes += 1;
+  }
+}
+
+// instance 행렬 attribute(a_model)가 frame_ring의 offset부터 읽도록 바인딩된 VAO를 고친다.
+// GL_ARRAY_BUFFER에 frame_ring.buffer가 바인딩되어 있어야 한다.
+void point_instance_attributes(GLintptr offset)
+{
+  for (GLint c = 0; c < 4; ++c)
+  {
+    glVertexAttribPointer(loc_a_model + c, 4, GL_FLOAT, GL_FALSE, sizeof(kmuvcl::math::mat4f),
+                          BUFFER_OFFSET(offset + c * 4 * sizeof(float)));
+  }
+}
+
+// 정렬된 패킷 중 arena에 있는 것은 (program, texture, sampler, material, mode)가 같은 동안 한
+// 묶음의 indirect command로 모아 glMultiDrawElementsIndirect 한 번에 그리고, 나머지만 하나씩 그린다.
+// 블렌딩하는 패킷은 arena에 있어도 하나씩 그려서, 키 순서대로 불투명한 패킷보다 뒤에 그린다.
+// 프레임 상수, instance 행렬, indirect command는 draw 전에 frame_ring의 이번 구간에 모두 쓴다.
+void submit_render_queue()
+{
+  GLuint bound_program = 0;
+  GLuint bound_vao = 0;
+  TextureBinding bound_texture;
+  int bound_material = -2; // material -1(기본 material)도 처음에는 바인딩하도록
+
+  view_position_wc[0] = mat_view(0, 3);
+  view_position_wc[1] = mat_view(1, 3);
+  view_position_wc[2] = mat_view(2, 3);
+
+  const bool multi_draw = use_multi_draw && multi_draw_supported && arena_vao != 0;
+  indirect_commands.clear();
+  multi_draw_batches.clear();
+  single_draw_packets.clear();
+  for (const std::pair<uint64_t, uint32_t> &key : draw_keys)
+  {
+    const DrawPacket &packet = draw_packets[key.second];
+    if (!multi_draw || !packet.in_arena || packet.blend)
+    {
+      single_draw_packets.push_back(key.second);
+      continue;
+    }
+
+    if (multi_draw_batches.empty() ||
+        multi_draw_batches.back().program != packet.program ||
+        multi_draw_batches.back().texture.texture != packet.texture.texture ||
+        multi_draw_batches.back().texture.sampler != packet.texture.sampler ||
+        multi_draw_batches.back().material != packet.material ||
+        multi_draw_batches.back().mode != packet.mode)
+    {
+      MultiDrawBatch batch;
+      batch.program = packet.program;
+      batch.texture = packet.texture;
+      batch.material = packet.material;
+      batch.mode = packet.mode;
+      batch.first_command = indirect_commands.size();
+      batch.num_commands = 0;
+      batch.num_instances = 0;
+      multi_draw_batches.push_back(batch);
+    }
+
+    // 인덱스가 없던 primitive도 arena에서는 0..n-1 인덱스를 만들어 두었으므로 count가 같다.
+    DrawElementsIndirectCommand command;
+    command.count = static_cast<GLuint>(packet.count);
+    command.instance_count = static_cast<GLuint>(packet.instance_count);
+    command.first_index = packet.arena_first_index;
+    command.base_vertex = packet.arena_base_vertex;
+    command.base_instance = static_cast<GLuint>(packet.first_instance);
+    indirect_commands.push_back(command);
+
+    MultiDrawBatch &batch = multi_draw_batches.back();
+    batch.num_commands += 1;
+    batch.num_instances += packet.instance_count;
+    render_stats.triangles += triangle_count(packet.mode, packet.count) * packet.instance_count;
+  }
+
+  FrameUniforms frame;
+  memset(&frame, 0, sizeof(frame));
+  memcpy(frame.VP, static_cast<const float *>(mat_VP), sizeof(frame.VP));
+  memcpy(frame.view_position_wc, static_cast<const float *>(view_position_wc), 3 * sizeof(float));
+  memcpy(frame.light_position_wc, static_cast<const float *>(light_position_wc), 3 * sizeof(float));
+  memcpy(frame.light_ambient, static_cast<const float *>(light_ambient), sizeof(frame.light_ambient));
+  memcpy(frame.light_diffuse, static_cast<const float *>(light_diffuse), sizeof(frame.light_diffuse));
+  memcpy(frame.light_specular, static_cast<const float *>(light_specular), sizeof(frame.light_specular));
+
+  const size_t instance_bytes = instance_matrices.size() * sizeof(kmuvcl::math::mat4f);
+  const size_t indirect_bytes = indirect_commands.size() * sizeof(DrawElementsIndirectCommand);
+  begin_frame_ring(sizeof(FrameUniforms) + instance_bytes + indirect_bytes +
+                   uniform_buffer_alignment + sizeof(kmuvcl::math::mat4f) + sizeof(GLuint));
+  GLintptr frame_offset = frame_ring_write(&frame, sizeof(frame), uniform_buffer_alignment);
+  GLintptr instance_offset = frame_ring_write(instance_matrices.data(), instance_bytes,
+                                              sizeof(kmuvcl::math::mat4f));
+  GLintptr indirect_offset = frame_ring_write(indirect_commands.data(), indirect_bytes,
+                                              sizeof(GLuint));
+  finish_frame_ring_writes();
+
+  glBindBufferRange(GL_UNIFORM_BUFFER, frame_block_binding, frame_ring.buffer, frame_offset,
+                    sizeof(FrameUniforms));
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glBindSampler(0, 0);
+  glBindBuffer(GL_ARRAY_BUFFER, frame_ring.buffer);
+
+  if (!indirect_commands.empty())
+  {
+    // arena는 baseInstance로 instance 행렬을 찾으므로 이번 프레임 구간의 시작만 가리키면 된다.
+    glBindVertexArray(arena_vao);
+    bound_vao = arena_vao;
+    render_stats.vao_changes += 1;
+    point_instance_attributes(instance_offset);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, frame_ring.buffer);
+    for (const MultiDrawBatch &batch : multi_draw_batches)
+    {
+      bind_draw_state(batch.program, batch.texture, batch.material, arena_vao,
+                      &bound_program, &bound_texture, &bound_material, &bound_vao);
+      glMultiDrawElementsIndirect(batch.mode, GL_UNSIGNED_INT,
+                                  BUFFER_OFFSET(indirect_offset +
+                                                batch.first_command * sizeof(DrawElementsIndirectCommand)),
+                                  batch.num_commands, 0);
+      render_stats.draw_calls += 1;
+      render_stats.instances += batch.num_instances;
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  }
+
+  for (uint32_t index : single_draw_packets)
+  {
+    const DrawPacket &packet = draw_packets[index];
+    bind_draw_state(packet.program, packet.texture, packet.material, packet.vao,
+                    &bound_program, &bound_texture, &bound_material, &bound_vao);
+
+    // GL 3.3에는 baseInstance가 없으므로 instance 행렬 attribute를 패킷 구간으로 옮긴다.
+    point_instance_attributes(instance_offset +
+                              packet.first_instance * sizeof(kmuvcl::math::mat4f));
+
+    if (packet.in_arena)
+    {
+      // multi-draw를 끄면 arena의 primitive도 arena_vao에서 하나씩 그린다. (VBO가 arena에만 있다)
+      glDrawElementsInstancedBaseVertex(packet.mode, packet.count, GL_UNSIGNED_INT,
+                                        BUFFER_OFFSET(packet.arena_first_index * sizeof(GLuint)),
+                                        packet.instance_count, packet.arena_base_vertex);
+    }
+    else if (packet.index_type != 0)
+    {
+      glDrawElementsInstanced(packet.mode, packet.count, packet.index_type,
+                              BUFFER_OFFSET(packet.index_offset), packet.instance_count);
+    }
+    else
+    {
+      glDrawArraysInstanced(packet.mode, 0, packet.count, packet.instance_count);
+    }
+    render_stats.draw_calls += 1;
+    render_stats.instances += packet.instance_count;
+    render_stats.triangles += triangle_count(packet.mode, packet.count) * packet.instance_count;
+  }
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glUseProgram(0);
+  // 깊이 쓰기가 꺼져 있으면 다음 glClear가 깊이 버퍼를 지우지 못하므로 기본 상태로 되돌린다.
+  glDisable(GL_BLEND);
+  glDepthMask(GL_TRUE);
+  glDisable(GL_CULL_FACE);
+
+  render_stats_total.draw_calls += render_stats.draw_calls;
+  render_stats_total.instances += render_stats.instances;
+  render_stats_total.program_changes += render_stats.program_changes;
+  render_stats_total.vao_changes += render_stats.vao_changes;
+  render_stats_total.texture_changes += render_stats.texture_changes;
+  render_stats_total.sampler_changes += render_stats.sampler_changes;
+  render_stats_total.material_changes += render_stats.material_changes;
+  render_stats_total.culled += render_stats.culled;
+  render_stats_total.triangles += render_stats.triangles;
+}
+
+void draw_scene()
+{
+  update_world_transforms();
+
+  mat_VP = mat_proj * mat_view;
+
+  render_stats = RenderStats();
+  collect_draw_packets();
+  submit_render_queue();
+}
+
+bool read_batch_list(const std::string &path, std::vector<BatchJob> *jobs)
+{
+  std::ifstream file(path.c_str());
+  if (!file)
+    return false;
+
+  std::string line;
+  while (std::getline(file, line))
+  {
+    std::istringstream fields(line);
+    BatchJob job;
+    if (!(fields >> job.model_path) || job.model_path[0] == '#')
+      continue;
+
+    int camera;
+    while (fields >> camera)
+      job.cameras.push_back(camera);
+    if (job.cameras.empty())
+      job.cameras.push_back(0);
+    jobs->push_back(job);
+  }
+  return true;
+}
+
+std::string thumbnail_path(size_t job_index, const std::string &model_path, int camera)
+{
+  size_t name_begin = model_path.find_last_of("/\\");
+  name_begin = name_begin == std::string::npos ? 0 : name_begin + 1;
+  size_t name_end = model_path.find_last_of('.');
+  if (name_end == std::string::npos || name_end < name_begin)
+    name_end = model_path.size();
+
+  return batch_output_dir + "/" + std::to_string(job_index) + "_" +
+         model_path.substr(name_begin, name_end - name_begin) + "_" + std::to_string(camera) +
+         ".png";
+}
+
+// 창 없는 EGL 컨텍스트를 만들어 current로 한다. Mesa의 surfaceless 플랫폼이 있으면 그것을 쓰고,
+// EGL_KHR_surfaceless_context가 없으면 1x1 pbuffer를 붙인다.
+bool init_headless_context(EGLDisplay *display, EGLContext *context)
+{
+  PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+      reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+          eglGetProcAddress("eglGetPlatformDisplayEXT"));
+  *display = get_platform_display
+                 ? get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL)
+                 : EGL_NO_DISPLAY;
+  if (*display == EGL_NO_DISPLAY)
+    *display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+  EGLint major, minor;
+  if (*display == EGL_NO_DISPLAY || !eglInitialize(*display, &major, &minor))
+  {
+    std::cout << "Cannot initialize EGL" << std::endl;
+    return false;
+  }
+
+  const EGLint config_attribs[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+                                   EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+  EGLConfig config;
+  EGLint num_configs = 0;
+  if (!eglBindAPI(EGL_OPENGL_API) ||
+      !eglChooseConfig(*display, config_attribs, &config, 1, &num_configs) || num_configs < 1)
+  {
+    std::cout << "No EGL config for desktop OpenGL" << std::endl;
+    eglTerminate(*display);
+    return false;
+  }
+
+  // 버전을 지정하지 않으면 compatibility 컨텍스트를 받는다. (GLSL 1.20 셰이더를 그대로 쓴다)
+  *context = eglCreateContext(*display, config, EGL_NO_CONTEXT, NULL);
+  if (*context == EGL_NO_CONTEXT)
+  {
+    std::cout << "Cannot create an EGL context" << std::endl;
+    eglTerminate(*display);
+    return false;
+  }
+
+  if (!eglMakeCurrent(*display, EGL_NO_SURFACE, EGL_NO_SURFACE, *context))
+  {
+    const EGLint surface_attribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    EGLSurface surface = eglCreatePbufferSurface(*display, config, surface_attribs);
+    if (surface == EGL_NO_SURFACE || !eglMakeCurrent(*display, surface, surface, *context))
+    {
+      std::cout << "Cannot make the EGL context current" << std::endl;
+      eglDestroyContext(*display, *context);
+      eglTerminate(*display);
+      return false;
+    }
+  }
+  return true;
+}
+
+void delete_headless_context(EGLDisplay display, EGLContext context)
+{
+  eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+  eglDestroyContext(display, context);
+  eglTerminate(display);
+}
+
+// size x size FBO를 만들어 바인딩하고 viewport를 맞춘다.
+bool init_offscreen_target(OffscreenTarget *target, int size)
+{
+  target->size = size;
+  glGenFramebuffers(1, &target->framebuffer);
+  glGenRenderbuffers(2, target->renderbuffers);
+  glBindRenderbuffer(GL_RENDERBUFFER, target->renderbuffers[0]);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size, size);
+  glBindRenderbuffer(GL_RENDERBUFFER, target->renderbuffers[1]);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+  glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                            target->renderbuffers[0]);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER,
+                            target->renderbuffers[1]);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+  {
+    std::cout << "Offscreen framebuffer is incomplete" << std::endl;
+    delete_offscreen_target(target);
+    return false;
   }
-
-  std::cout << std::endl;
-
-  return res;
+  glViewport(0, 0, size, size);
+  return true;
 }
 
-void init_buffer_objects()
+void delete_offscreen_target(OffscreenTarget *target)
 {
-  const std::vector<tinygltf::Mesh> &meshes = model.meshes;
-  const std::vector<tinygltf::Accessor> &accessors = model.accessors;
-  const std::vector<tinygltf::BufferView> &bufferViews = model.bufferViews;
-  const std::vector<tinygltf::Buffer> &buffers = model.buffers;
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  if (target->framebuffer != 0)
+    glDeleteFramebuffers(1, &target->framebuffer);
+  if (target->renderbuffers[0] != 0)
+    glDeleteRenderbuffers(2, target->renderbuffers);
+  *target = OffscreenTarget();
+}
 
-  for (const tinygltf::Mesh &mesh : meshes)
+// 헤드리스 모드에서 모델 하나를 처음부터 끝까지 올린다. 실패하면 올리다 만 것을 비운다.
+bool load_scene_objects(const std::string &filename)
+{
+  if (!load_scene(filename))
   {
-    for (const tinygltf::Primitive &primitive : mesh.primitives)
-    {
-        if(primitive.indices > -1)
-        //if (strcmp(filename, "triangleWithoutIndices.gltf") != 0)
-        {
-          const tinygltf::Accessor &accessor = accessors[primitive.indices];
-          const tinygltf::BufferView &bufferView = bufferViews[accessor.bufferView];
-          const tinygltf::Buffer &buffer = buffers[bufferView.buffer];        
-          glGenBuffers(1, &index_buffer);
-          glBindBuffer(bufferView.target, index_buffer);
-          glBufferData(bufferView.target, bufferView.byteLength,
-                       &buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
-        }
-        for (const auto &attrib : primitive.attributes)
-        {
-          const tinygltf::Accessor &accessor = accessors[attrib.second];
-          const tinygltf::BufferView &bufferView = bufferViews[accessor.bufferView];
-          const tinygltf::Buffer &buffer = buffers[bufferView.buffer];
-          if (attrib.first.compare("POSITION") == 0)
-          {
-            glGenBuffers(1, &position_buffer);
-            glBindBuffer(bufferView.target, position_buffer);
-            glBufferData(bufferView.target, bufferView.byteLength,
-                         &buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
-          }
-
-          else if (attrib.first.compare("COLOR_0") == 0)
-          {
-            glGenBuffers(1, &color_buffer);
-            glBindBuffer(bufferView.target, color_buffer);
-            glBufferData(bufferView.target, bufferView.byteLength,
-                         &buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
-          }
-          
-          else if (attrib.first.compare("NORMAL") == 0)
-          {
-            glGenBuffers(1, &normal_buffer);
-            glBindBuffer(bufferView.target, normal_buffer);
-            glBufferData(bufferView.target, bufferView.byteLength,
-                         &buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
-          }
-          
-          else if (attrib.first.compare("TEXCOORD_0") == 0)
-          {
-            glGenBuffers(1, &texcoord_buffer);
-            glBindBuffer(bufferView.target, texcoord_buffer);
-            glBufferData(bufferView.target, bufferView.byteLength,
-                         &buffer.data.at(0) + bufferView.byteOffset, GL_STATIC_DRAW);
-          }
-      }
-    }
+    unload_scene();
+    return false;
   }
+  init_buffer_objects();
+  init_texture_objects(false);
+  init_scene_objects(texture_bindings);
+  return true;
 }
 
-void init_texture_objects()
+void start_thumbnail_writer(size_t num_threads)
 {
-  const std::vector<tinygltf::Texture> &textures = model.textures;
-  const std::vector<tinygltf::Image> &images = model.images;
-  const std::vector<tinygltf::Sampler> &samplers = model.samplers;
+  // 렌더 스레드가 만든 RGBA는 아래 줄부터라 PNG로 쓸 때 뒤집는다. (스레드를 띄우기 전에 한 번)
+  stbi_flip_vertically_on_write(1);
 
-  for (const tinygltf::Texture &texture : textures)
-  {
-    glGenTextures(1, &diffuse_texid);
-    glBindTexture(GL_TEXTURE_2D, diffuse_texid);
+  thumbnail_writer.closing = false;
+  thumbnail_writer.max_queued = 2 * num_threads;
+  for (size_t i = 0; i < num_threads; ++i)
+    thumbnail_writer.threads.push_back(std::thread(run_thumbnail_writer));
+}
 
-    const tinygltf::Image &image = images[texture.source];
-    const tinygltf::Sampler &sampler = samplers[texture.sampler];
+// thumbnail의 픽셀은 큐로 옮긴다. 큐가 차 있으면 자리가 날 때까지 기다린다.
+void queue_thumbnail(Thumbnail &thumbnail)
+{
+  std::unique_lock<std::mutex> lock(thumbnail_writer.mutex);
+  thumbnail_writer.queue_changed.wait(
+      lock, [] { return thumbnail_writer.queue.size() < thumbnail_writer.max_queued; });
+  thumbnail_writer.queue.push_back(Thumbnail());
+  std::swap(thumbnail_writer.queue.back(), thumbnail);
+  thumbnail_writer.queue_changed.notify_all();
+}
 
-    GLenum format = GL_RGBA;
-    if (image.component == 1)
+// 작업 스레드 본체. 큐가 비고 stop_thumbnail_writer()가 불리면 끝난다.
+void run_thumbnail_writer()
+{
+  for (;;)
+  {
+    Thumbnail thumbnail;
     {
-      format = GL_RED;
+      std::unique_lock<std::mutex> lock(thumbnail_writer.mutex);
+      thumbnail_writer.queue_changed.wait(
+          lock, [] { return thumbnail_writer.closing || !thumbnail_writer.queue.empty(); });
+      if (thumbnail_writer.queue.empty())
+        return;
+      std::swap(thumbnail, thumbnail_writer.queue.front());
+      thumbnail_writer.queue.pop_front();
+      thumbnail_writer.queue_changed.notify_all();
     }
-    else if (image.component == 2)
+
+    int ok = stbi_write_png(thumbnail.path.c_str(), thumbnail.width, thumbnail.height, 4,
+                            thumbnail.pixels.data(), thumbnail.width * 4);
+
+    std::lock_guard<std::mutex> lock(thumbnail_writer.mutex);
+    if (ok)
     {
-      format = GL_RG;
+      thumbnail_writer.written += 1;
     }
-    else if (image.component == 3)
+    else
     {
-      format = GL_RGB;
+      thumbnail_writer.failed += 1;
+      std::cout << "Cannot write " << thumbnail.path << std::endl;
     }
+  }
+}
 
-    GLenum type = GL_UNSIGNED_BYTE;
-    if (image.bits == 16)
-    {
-      type = GL_UNSIGNED_SHORT;
-    }
+// 큐에 남은 장을 모두 쓴 뒤 작업 스레드를 끝낸다.
+void stop_thumbnail_writer()
+{
+  {
+    std::lock_guard<std::mutex> lock(thumbnail_writer.mutex);
+    thumbnail_writer.closing = true;
+  }
+  thumbnail_writer.queue_changed.notify_all();
+  for (std::thread &thread : thumbnail_writer.threads)
+    thread.join();
+  thumbnail_writer.threads.clear();
+}
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,
-                 image.width, image.height, 0, format, type, &image.image[0]);
+// 지금 FBO의 내용을 다음 칸의 PBO로 읽기 시작하고, 앞서 읽기 시작한 장을 인코딩 큐에 넘긴다.
+void read_thumbnail(ThumbnailReadback *readback, const std::string &path)
+{
+  int slot = readback->slot;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->buffers[slot]);
+  glReadPixels(0, 0, readback->size, readback->size, GL_RGBA, GL_UNSIGNED_BYTE, BUFFER_OFFSET(0));
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  readback->fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  readback->paths[slot] = path;
+
+  readback->slot = 1 - slot;
+  collect_thumbnail(readback, readback->slot);
+}
 
-    //glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, sampler.minFilter);
-    //glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, sampler.magFilter);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sampler.wrapS);
-    glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, sampler.wrapT);
-    //glGenerateMipmap(GL_TEXTURE_2D);
+// slot의 읽기가 끝나기를 기다려 픽셀을 복사해 인코딩 큐에 넣는다. 읽는 중인 장이 없으면 아무것도 하지 않는다.
+void collect_thumbnail(ThumbnailReadback *readback, int slot)
+{
+  GLsync &fence = readback->fences[slot];
+  if (fence == 0)
+    return;
+  wait_fence(fence);
+  glDeleteSync(fence);
+  fence = 0;
+
+  Thumbnail thumbnail;
+  thumbnail.path = readback->paths[slot];
+  thumbnail.width = readback->size;
+  thumbnail.height = readback->size;
+  thumbnail.pixels.resize(size_t(readback->size) * readback->size * 4);
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->buffers[slot]);
+  const void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, thumbnail.pixels.size(),
+                                        GL_MAP_READ_BIT);
+  if (mapped)
+  {
+    memcpy(thumbnail.pixels.data(), mapped, thumbnail.pixels.size());
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
   }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  if (mapped)
+    queue_thumbnail(thumbnail);
+  else
+    std::cout << "Cannot map the readback buffer for " << thumbnail.path << std::endl;
 }
 
-void set_transform()
+// --batch: 목록의 모델을 하나씩 올려 카메라마다 썸네일을 쓰고 처리 속도를 출력한다.
+// 실패한 모델이 있으면 1을 돌려준다.
+int run_batch()
 {
-  const std::vector<tinygltf::Node> &nodes = model.nodes;
-  const std::vector<tinygltf::Camera> &cameras = model.cameras;
-  const tinygltf::Camera &camera = cameras[camera_index];
+  std::vector<BatchJob> jobs;
+  if (!read_batch_list(batch_list_path, &jobs))
+  {
+    std::cout << "Cannot read batch list: " << batch_list_path << std::endl;
+    return -1;
+  }
 
-  if (model.cameras.size() > 0)
+  EGLDisplay display;
+  EGLContext context;
+  if (!init_headless_context(&display, &context))
+    return -1;
+
+  // Initialize GLEW library
+  if (glewInit() != GLEW_OK)
+    std::cout << "GLEW Init Error!" << std::endl;
+  std::cout << glGetString(GL_VERSION) << " (" << glGetString(GL_RENDERER) << ")" << std::endl;
+
+  init_state();
+  init_frame_ring(frame_ring_initial_size);
+
+  const int size = batch_image_size;
+  OffscreenTarget target;
+  if (!init_offscreen_target(&target, size))
   {
-    if (camera.type.compare("perspective") == 0)
-    {
-      float fovy = kmuvcl::math::rad2deg(camera.perspective.yfov);
-      float aspectRatio = camera.perspective.aspectRatio;
-      float znear = camera.perspective.znear;
-      float zfar = camera.perspective.zfar;
-      /*
-    std::cout << "(camera.mode() == Camera::kPerspective)" << std::endl;
-    std::cout << "(fovy, aspect, n, f): " << fovy << ", " << aspectRatio << ", " << znear << ", " << zfar << std::endl;
-    */
-      mat_proj = kmuvcl::math::perspective(fovy, aspectRatio, znear, zfar);
-    }
-    else // (camera.type.compare("orthographic") == 0)
+    delete_frame_ring();
+    delete_headless_context(display, context);
+    return -1;
+  }
+
+  ThumbnailReadback readback;
+  readback.size = size;
+  glGenBuffers(2, readback.buffers);
+  for (int i = 0; i < 2; ++i)
+  {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffers[i]);
+    glBufferData(GL_PIXEL_PACK_BUFFER, size_t(size) * size * 4, NULL, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+  unsigned num_cores = std::thread::hardware_concurrency();
+  start_thumbnail_writer(num_cores > 1 ? num_cores - 1 : 1);
+
+  std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+  size_t num_models = 0;
+  size_t num_images = 0;
+  size_t num_empty = 0;
+  size_t num_failed = 0;
+  for (size_t j = 0; j < jobs.size(); ++j)
+  {
+    const BatchJob &job = jobs[j];
+    if (!load_scene_objects(job.model_path))
     {
-      float xmag = camera.orthographic.xmag;
-      float ymag = camera.orthographic.ymag;
-      float znear = camera.orthographic.znear;
-      float zfar = camera.orthographic.zfar;
-      /*
-    std::cout << "(camera.mode() == Camera::kOrtho)" << std::endl;
-    std::cout << "(xmag, ymag, n, f): " << xmag << ", " << ymag << ", " << znear << ", " << zfar << std::endl;
-    */
-      mat_proj = kmuvcl::math::ortho(-xmag, xmag, -ymag, ymag, znear, zfar);
+      num_failed += 1;
+      continue;
     }
+    num_models += 1;
 
-    for (const tinygltf::Node &node : nodes)
+    for (int camera : job.cameras)
     {
-      if (node.camera == camera_index)
+      if (camera < 0 || (camera > 0 && size_t(camera) >= model.cameras.size()))
       {
-        mat_view.set_to_identity();
-        if (node.scale.size() == 3)
-        {
-          mat_view = mat_view * kmuvcl::math::scale<float>(
-                                    1.0f / node.scale[0], 1.0f / node.scale[1], 1.0f / node.scale[2]);
-        }
-
-        if (node.rotation.size() == 4)
-        {
-          mat_view = mat_view * kmuvcl::math::quat2mat(
-                                    node.rotation[0], node.rotation[1], node.rotation[2], node.rotation[3])
-                                    .transpose();
-        }
-
-        if (node.translation.size() == 3)
-        {
-          mat_view = mat_view * kmuvcl::math::translate<float>(
-                                    -node.translation[0], -node.translation[1], -node.translation[2]);
-        }
+        std::cout << "Skipping camera " << camera << " of " << job.model_path << " ("
+                  << model.cameras.size() << " cameras)" << std::endl;
+        continue;
+      }
+      camera_index = camera;
+
+      glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+      glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+      set_transform();
+      draw_scene();
+      end_frame_ring();
+      if (render_stats.instances == 0)
+      {
+        std::cout << "Warning: camera " << camera << " of " << job.model_path
+                  << " drew nothing (" << render_stats.culled << " instances culled)" << std::endl;
+        num_empty += 1;
       }
+      read_thumbnail(&readback, thumbnail_path(j, job.model_path, camera));
+      num_images += 1;
     }
+
+    unload_scene();
   }
-  else
-  {
-    //mat_view.set_to_identity();
-    mat_view = kmuvcl::math::translate(-1.3f, -1.3f, -4.0f);
+  collect_thumbnail(&readback, readback.slot);
+  collect_thumbnail(&readback, 1 - readback.slot);
+  stop_thumbnail_writer();
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+  std::cout << "Batch: " << num_models << " models, " << num_images << " images ("
+            << thumbnail_writer.written << " written) in " << seconds << " s: "
+            << num_models / seconds << " models/s, " << num_images / seconds << " images/s";
+  if (num_empty > 0)
+    std::cout << ", " << num_empty << " images empty";
+  if (num_failed > 0 || thumbnail_writer.failed > 0)
+    std::cout << ", " << num_failed << " models and " << thumbnail_writer.failed
+              << " images failed";
+  std::cout << std::endl;
 
-    //mat_proj.set_to_identity();
-    float fovy = 70.0f;
-    float aspectRatio = 1.0f;
-    float znear = 0.01f;
-    float zfar = 100.0f;
+  glDeleteBuffers(2, readback.buffers);
+  delete_offscreen_target(&target);
+  delete_shader_programs();
+  delete_frame_ring();
+  delete_headless_context(display, context);
 
-    mat_proj = kmuvcl::math::perspective(fovy, aspectRatio, znear, zfar);
-  }
+  return num_failed > 0 || thumbnail_writer.failed > 0 ? 1 : 0;
 }
 
-void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods)
+// 백분위는 nearest-rank: 정렬한 값에서 ceil(p * n)번째
+FrameTimeSummary summarize_frame_times(std::vector<double> times)
 {
-  if (key == GLFW_KEY_Q && action == GLFW_PRESS)
+  FrameTimeSummary summary;
+  if (times.empty())
+    return summary;
+
+  std::sort(times.begin(), times.end());
+  const size_t n = times.size();
+  const double percentiles[3] = {0.50, 0.95, 0.99};
+  double *values[3] = {&summary.median, &summary.p95, &summary.p99};
+  for (int p = 0; p < 3; ++p)
   {
-    camera_index = camera_index == 0 ? 1 : 0;
+    size_t rank = static_cast<size_t>(std::ceil(percentiles[p] * n));
+    *values[p] = times[std::max<size_t>(rank, 1) - 1];
   }
+  summary.min = times.front();
+  for (double time : times)
+    summary.mean += time;
+  summary.mean /= n;
+  return summary;
 }
 
-void draw_node(const tinygltf::Node &node, kmuvcl::math::mat4f mat_model)
+std::string json_string(const std::string &value)
 {
-  const std::vector<tinygltf::Node> &nodes = model.nodes;
-  const std::vector<tinygltf::Mesh> &meshes = model.meshes;
-
-  if (node.scale.size() == 3)
+  std::string quoted = "\"";
+  for (char c : value)
   {
-    mat_model = mat_model * kmuvcl::math::scale<float>(
-                                node.scale[0], node.scale[1], node.scale[2]);
+    if (c == '"' || c == '\\')
+      quoted += '\\';
+    if (static_cast<unsigned char>(c) < 0x20)
+      quoted += ' ';
+    else
+      quoted += c;
   }
-  if (node.rotation.size() == 4)
+  return quoted + "\"";
+}
+
+std::string json_summary(const FrameTimeSummary &summary)
+{
+  std::ostringstream json;
+  json << "{\"min\": " << summary.min << ", \"median\": " << summary.median
+       << ", \"p95\": " << summary.p95 << ", \"p99\": " << summary.p99
+       << ", \"mean\": " << summary.mean << "}";
+  return json.str();
+}
+
+// 카메라가 없는 모델의 벤치마크 경로: 보이는 instance들의 world AABB를 감싸는 구를 프레임
+// num_frames개에 걸쳐 한 바퀴 돈다. 조금 위에서 내려다보고, 구 전체가 화면에 들어오는 거리다.
+void set_orbit_transform(int frame, int num_frames)
+{
+  culling::Aabb bounds = culling::empty_aabb();
+  for (size_t i = 0; i < world_boxes.size(); ++i)
   {
-    mat_model = mat_model * kmuvcl::math::quat2mat(
-                                node.rotation[0], node.rotation[1], node.rotation[2], node.rotation[3]);
+    if (world_boxes.is_unbounded(i))
+      continue;
+    const float lo[3] = {world_boxes.center_x[i] - world_boxes.extent_x[i],
+                         world_boxes.center_y[i] - world_boxes.extent_y[i],
+                         world_boxes.center_z[i] - world_boxes.extent_z[i]};
+    const float hi[3] = {world_boxes.center_x[i] + world_boxes.extent_x[i],
+                         world_boxes.center_y[i] + world_boxes.extent_y[i],
+                         world_boxes.center_z[i] + world_boxes.extent_z[i]};
+    culling::grow(bounds, lo);
+    culling::grow(bounds, hi);
   }
-  if (node.translation.size() == 3)
+
+  float center[3] = {0.0f, 0.0f, 0.0f};
+  float radius = 1.0f;
+  if (culling::is_valid(bounds))
   {
-    mat_model = mat_model * kmuvcl::math::translate<float>(
-                                node.translation[0], node.translation[1], node.translation[2]);
+    float extent = 0.0f;
+    for (int k = 0; k < 3; ++k)
+    {
+      center[k] = 0.5f * (bounds.min[k] + bounds.max[k]);
+      extent += (bounds.max[k] - center[k]) * (bounds.max[k] - center[k]);
+    }
+    radius = std::max(std::sqrt(extent), 1e-3f);
   }
-  if (node.matrix.size() == 16)
-  {
-    kmuvcl::math::mat4f mat_node;
-    mat_node(0, 0) = node.matrix[0];
-    mat_node(0, 1) = node.matrix[1];
-    mat_node(0, 2) = node.matrix[2];
-    mat_node(0, 3) = node.matrix[3];
-
-    mat_node(1, 0) = node.matrix[4];
-    mat_node(1, 1) = node.matrix[5];
-    mat_node(1, 2) = node.matrix[6];
-    mat_node(1, 3) = node.matrix[7];
-
-    mat_node(2, 0) = node.matrix[8];
-    mat_node(2, 1) = node.matrix[9];
-    mat_node(2, 2) = node.matrix[10];
-    mat_node(2, 3) = node.matrix[11];
 
-    mat_node(3, 0) = node.matrix[12];
-    mat_node(3, 1) = node.matrix[13];
-    mat_node(3, 2) = node.matrix[14];
-    mat_node(3, 3) = node.matrix[15];
+  const float fovy = 60.0f;
+  const float distance = radius / std::sin(kmuvcl::math::deg2rad(fovy * 0.5f));
+  const float angle = 2.0f * kmuvcl::math::MATH_PI * frame / std::max(num_frames, 1);
+  mat_view = kmuvcl::math::lookAt(center[0] + distance * std::cos(angle) * 0.9f,
+                                  center[1] + distance * 0.436f,
+                                  center[2] + distance * std::sin(angle) * 0.9f,
+                                  center[0], center[1], center[2], 0.0f, 1.0f, 0.0f);
+  mat_proj = kmuvcl::math::perspective(fovy, 1.0f, distance * 0.01f, distance * 2.0f + radius);
+}
 
-    mat_model = mat_model * mat_node;
+// model.cameras 중 하나라도 절두체 안에 draw instance가 있으면 true. (그리지는 않는다)
+// camera_index는 0으로 되돌린다.
+bool any_camera_sees_scene()
+{
+  bool visible = false;
+  for (size_t c = 0; c < model.cameras.size() && !visible; ++c)
+  {
+    camera_index = static_cast<int>(c);
+    set_transform();
+    mat_VP = mat_proj * mat_view;
+    update_instance_bounds();
+    cull_primitives();
+    visible = std::find(box_visible.begin(), box_visible.end(), 1) != box_visible.end();
   }
-
-  if (node.mesh > -1)
-    draw_mesh(meshes[node.mesh], mat_model);
-  
-  for (size_t i = 0; i < node.children.size(); ++i)
-    draw_node(nodes[node.children[i]], mat_model);
+  camera_index = 0;
+  return visible;
 }
 
-void draw_mesh(const tinygltf::Mesh &mesh, const kmuvcl::math::mat4f &mat_model)
+// 모델 하나의 벤치마크. 결과를 JSON 객체 하나로 돌려준다.
+std::string bench_model(const std::string &filename, bool gpu_timer)
 {
-  const std::vector<tinygltf::Material> &materials = model.materials;
-  const std::vector<tinygltf::Texture> &textures = model.textures;
-  const std::vector<tinygltf::Accessor> &accessors = model.accessors;
-  const std::vector<tinygltf::BufferView> &bufferViews = model.bufferViews;
+  std::ostringstream json;
+  json << "{\"model\": " << json_string(filename);
 
-  glUseProgram(program);
-  mat_PVM = mat_proj * mat_view * mat_model;
-  glUniformMatrix4fv(loc_u_PVM, 1, GL_FALSE, mat_PVM);
-  glUniformMatrix4fv(loc_u_M, 1, GL_FALSE, mat_model);
-  view_position_wc[0] = mat_view(0, 3);
-  view_position_wc[1] = mat_view(1, 3);
-  view_position_wc[2] = mat_view(2, 3);
-  glUniform3fv(loc_u_view_position_wc, 1, view_position_wc);
-  glUniform3fv(loc_u_light_position_wc, 1, light_position_wc);
-  glUniform4fv(loc_u_light_ambient, 1, light_ambient);
-  glUniform4fv(loc_u_light_diffuse, 1, light_diffuse);
-  glUniform4fv(loc_u_light_specular, 1, light_specular);
-  glUniform4fv(loc_u_material_ambient, 1, material_ambient);
-  glUniform4fv(loc_u_material_specular, 1, material_specular);
-  glUniform1f(loc_u_material_shininess, material_shininess);
-  for (const tinygltf::Primitive &primitive : mesh.primitives)
-  {
-    if (primitive.material > -1)
-    {
-      const tinygltf::Material &material = materials[primitive.material];
-      for (const std::pair<std::string, tinygltf::Parameter> parameter : material.values)
-      {
-        if (parameter.first.compare("baseColorTexture") == 0)
-        {
-          if (parameter.second.TextureIndex() > -1)
-          {
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, diffuse_texid);
-
-            glUniform1i(loc_u_diffuse_texture, 0);
-          }
-        }
-      }
-    }
-    int count = 0;
-    for (const std::pair<std::string, int> &attrib : primitive.attributes)
-    {
-      const int accessor_index = attrib.second;
-      const tinygltf::Accessor &accessor = accessors[accessor_index];
-
-      count = accessor.count;
+  std::chrono::steady_clock::time_point load_begin = std::chrono::steady_clock::now();
+  if (!load_scene_objects(filename))
+  {
+    json << ", \"error\": \"load failed\"}";
+    return json.str();
+  }
+  glFinish();
+  double load_ms = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - load_begin)
+                       .count();
+
+  // 카메라가 장면을 하나도 보지 못하면 빈 프레임만 재게 되므로 궤도 경로로 잰다.
+  bool use_cameras = !model.cameras.empty();
+  if (use_cameras && !draw_instances.empty() && !any_camera_sees_scene())
+  {
+    std::cout << "Warning: no camera of " << filename
+              << " sees the scene; benchmarking the orbit path instead" << std::endl;
+    use_cameras = false;
+  }
 
-      const tinygltf::BufferView &bufferView = bufferViews[accessor.bufferView];
-      const int byteStride = accessor.ByteStride(bufferView);
+  std::vector<GLuint> queries(gpu_timer ? bench_frames : 0);
+  if (gpu_timer)
+    glGenQueries(bench_frames, queries.data());
 
-      if (attrib.first.compare("POSITION") == 0)
-      {
-        glBindBuffer(bufferView.target, position_buffer);
-        glEnableVertexAttribArray(loc_a_position);
-        glVertexAttribPointer(loc_a_position,
-                              accessor.type, accessor.componentType,
-                              accessor.normalized ? GL_TRUE : GL_FALSE, byteStride,
-                              BUFFER_OFFSET(accessor.byteOffset));
-      }
-      else if (attrib.first.compare("COLOR_0") == 0)
-      {
-        glBindBuffer(bufferView.target, color_buffer);
-        glEnableVertexAttribArray(loc_a_color);
-        glVertexAttribPointer(loc_a_color,
-                              accessor.type, accessor.componentType,
-                              accessor.normalized ? GL_TRUE : GL_FALSE, byteStride,
-                              BUFFER_OFFSET(accessor.byteOffset));
-      }
-      
-      else if (attrib.first.compare("NORMAL") == 0)
-      {
-        glBindBuffer(bufferView.target, normal_buffer);
-        glEnableVertexAttribArray(loc_a_normal);
-        glVertexAttribPointer(loc_a_normal,
-                              accessor.type, accessor.componentType,
-                              accessor.normalized ? GL_TRUE : GL_FALSE, byteStride,
-                              BUFFER_OFFSET(accessor.byteOffset));
-      }
-      
-      else if (attrib.first.compare("TEXCOORD_0") == 0)
-      {
-        glBindBuffer(bufferView.target, texcoord_buffer);
-        glEnableVertexAttribArray(loc_a_texcoord);
-        glVertexAttribPointer(loc_a_texcoord,
-                              accessor.type, accessor.componentType,
-                              accessor.normalized ? GL_TRUE : GL_FALSE, byteStride,
-                              BUFFER_OFFSET(accessor.byteOffset));
-      }
+  std::vector<double> cpu_ms;
+  cpu_ms.reserve(bench_frames);
+  RenderStats totals;
+  size_t state_changes = 0;
+  std::chrono::steady_clock::time_point frames_begin;
+  for (int f = -bench_warmup_frames; f < bench_frames; ++f)
+  {
+    if (f == 0)
+    {
+      glFinish();
+      frames_begin = std::chrono::steady_clock::now();
     }
-    if(primitive.indices > -1)
-    //if (strcmp(filename, "triangleWithoutIndices.gltf") != 0)
+    std::chrono::steady_clock::time_point frame_begin = std::chrono::steady_clock::now();
+
+    glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if (use_cameras)
     {
-      const tinygltf::Accessor &index_accessor = accessors[primitive.indices];
-      const tinygltf::BufferView &bufferView = bufferViews[index_accessor.bufferView];
-      //std::cout << index_accessor.count << std::endl;
-      glBindBuffer(bufferView.target, index_buffer);
-      glDrawElements(primitive.mode,
-                     index_accessor.count,
-                     index_accessor.componentType,
-                     BUFFER_OFFSET(index_accessor.byteOffset));
+      camera_index = (f + bench_warmup_frames) % static_cast<int>(model.cameras.size());
+      set_transform();
     }
     else
     {
-      glDrawArrays(primitive.mode, 0, count);
+      set_orbit_transform(f, bench_frames);
     }
 
-    // 정점 attribute 배열 비활성화
-    glDisableVertexAttribArray(loc_a_texcoord);
-    glDisableVertexAttribArray(loc_a_normal);
-    glDisableVertexAttribArray(loc_a_color);
-    glDisableVertexAttribArray(loc_a_position);
+    if (f >= 0 && gpu_timer)
+      glBeginQuery(GL_TIME_ELAPSED, queries[f]);
+    draw_scene();
+    if (f >= 0 && gpu_timer)
+      glEndQuery(GL_TIME_ELAPSED);
+    end_frame_ring();
+    glFlush(); // 창 모드의 swap처럼 프레임마다 GPU에 넘긴다.
+
+    if (f < 0)
+      continue;
+    cpu_ms.push_back(std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - frame_begin)
+                         .count());
+    totals.draw_calls += render_stats.draw_calls;
+    totals.instances += render_stats.instances;
+    state_changes += render_stats.state_changes();
+    totals.triangles += render_stats.triangles;
+    totals.culled += render_stats.culled;
+  }
+  glFinish();
+  double frames_seconds = std::chrono::duration<double>(
+                              std::chrono::steady_clock::now() - frames_begin)
+                              .count();
+
+  std::vector<double> gpu_ms;
+  for (GLuint query : queries)
+  {
+    GLuint64 elapsed_ns = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed_ns);
+    gpu_ms.push_back(elapsed_ns * 1e-6);
   }
-  glUseProgram(0);
+  if (gpu_timer)
+    glDeleteQueries(bench_frames, queries.data());
+
+  const double frames = std::max(bench_frames, 1);
+  json << ", \"load_ms\": " << load_ms
+       << ", \"scene_cache\": \""
+       << (!use_scene_cache ? "disabled" : scene_cache_hit ? "hit" : "miss") << "\""
+       << ", \"camera_path\": \"" << (use_cameras ? "cameras" : "orbit") << "\""
+       << ", \"cameras\": " << model.cameras.size()
+       << ", \"frames\": " << bench_frames
+       << ", \"fps\": " << bench_frames / frames_seconds
+       << ", \"cpu_ms\": " << json_summary(summarize_frame_times(cpu_ms))
+       << ", \"gpu_ms\": " << (gpu_timer ? json_summary(summarize_frame_times(gpu_ms)) : "null")
+       << ", \"per_frame\": {\"draw_calls\": " << totals.draw_calls / frames
+       << ", \"instances\": " << totals.instances / frames
+       << ", \"triangles\": " << totals.triangles / frames
+       << ", \"state_changes\": " << state_changes / frames
+       << ", \"culled\": " << totals.culled / frames << "}}";
+
+  unload_scene();
+  return json.str();
 }
 
-void draw_scene()
+// --bench: 모델마다 bench_model()을 돌려 JSON 하나로 쓴다. 실패한 모델이 있으면 1을 돌려준다.
+int run_bench()
 {
-  const std::vector<tinygltf::Node> &nodes = model.nodes;
+  EGLDisplay display;
+  EGLContext context;
+  if (!init_headless_context(&display, &context))
+    return -1;
 
-  kmuvcl::math::mat4f mat_model;
-  mat_model.set_to_identity();
+  // Initialize GLEW library
+  if (glewInit() != GLEW_OK)
+    std::cout << "GLEW Init Error!" << std::endl;
 
-  for (const tinygltf::Scene &scene : model.scenes)
+  init_state();
+  init_frame_ring(frame_ring_initial_size);
+
+  OffscreenTarget target;
+  if (!init_offscreen_target(&target, bench_image_size))
+  {
+    delete_frame_ring();
+    delete_headless_context(display, context);
+    return -1;
+  }
+
+  const bool gpu_timer = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+  if (!gpu_timer)
+    std::cout << "GL_TIME_ELAPSED queries are not supported; gpu_ms is null" << std::endl;
+
+  std::ostringstream json;
+  json << "{\"renderer\": " << json_string(reinterpret_cast<const char *>(glGetString(GL_RENDERER)))
+       << ", \"version\": " << json_string(reinterpret_cast<const char *>(glGetString(GL_VERSION)))
+       << ", \"size\": " << bench_image_size << ", \"warmup_frames\": " << bench_warmup_frames
+       << ", \"models\": [";
+  size_t num_failed = 0;
+  for (size_t i = 0; i < bench_models.size(); ++i)
+  {
+    std::string result = bench_model(bench_models[i], gpu_timer);
+    if (result.find("\"error\"") != std::string::npos)
+      num_failed += 1;
+    json << (i > 0 ? ",\n  " : "\n  ") << result;
+  }
+  json << "\n]}\n";
+
+  delete_offscreen_target(&target);
+  delete_shader_programs();
+  delete_frame_ring();
+  delete_headless_context(display, context);
+
+  if (bench_output_path.empty())
+  {
+    std::cout << json.str();
+  }
+  else
   {
-    for (size_t i = 0; i < scene.nodes.size(); ++i)
+    std::ofstream file(bench_output_path.c_str());
+    file << json.str();
+    if (!file)
     {
-      const tinygltf::Node &node = nodes[scene.nodes[i]];
-      draw_node(node, mat_model);
+      std::cout << "Cannot write " << bench_output_path << std::endl;
+      return -1;
     }
+    std::cout << "Wrote " << bench_output_path << std::endl;
   }
+  return num_failed > 0 ? 1 : 0;
 }
 /*
 // object rendering: 현재 scene은 삼각형 하나로 구성되어 있음.
@@ -829,8 +4308,50 @@ void render_object()
   glUseProgram(0);
 }
 */
-int main(void)
+int main(int argc, char **argv)
 {
+  for (int i = 1; i < argc; ++i)
+  {
+    std::string option = argv[i];
+    if (option == "--quantize")
+      quantize_attributes = true;
+    else if (option == "--vertex-layout=interleaved")
+      vertex_layout_options.layout = vertex_layout::INTERLEAVED;
+    else if (option == "--vertex-layout=separate")
+      vertex_layout_options.layout = vertex_layout::SEPARATE;
+    else if (option == "--packed-vertices")
+      vertex_layout_options.alignment = 1;
+    else if (option == "--no-program-cache")
+      use_program_cache = false;
+    else if (option == "--no-async-load")
+      async_loading = false;
+    else if (option == "--no-scene-cache")
+      use_scene_cache = false;
+    else if (option.compare(0, 12, "--cache-dir=") == 0)
+      scene_cache_dir = option.substr(12);
+    else if (option.compare(0, 8, "--batch=") == 0)
+      batch_list_path = option.substr(8);
+    else if (option.compare(0, 12, "--batch-out=") == 0)
+      batch_output_dir = option.substr(12);
+    else if (option.compare(0, 13, "--batch-size=") == 0)
+      batch_image_size = std::max(1, std::atoi(option.c_str() + 13));
+    else if (option.compare(0, 8, "--bench=") == 0)
+      bench_models.push_back(option.substr(8));
+    else if (option.compare(0, 15, "--bench-frames=") == 0)
+      bench_frames = std::max(1, std::atoi(option.c_str() + 15));
+    else if (option.compare(0, 13, "--bench-size=") == 0)
+      bench_image_size = std::max(1, std::atoi(option.c_str() + 13));
+    else if (option.compare(0, 12, "--bench-out=") == 0)
+      bench_output_path = option.substr(12);
+    else
+      std::cout << "Unknown option: " << option << std::endl;
+  }
+
+  if (!batch_list_path.empty())
+    return run_batch();
+  if (!bench_models.empty())
+    return run_bench();
+
   std::cout << "파일 이름 입력: ";
   char dir[] = "BoxTextured/";
   std::cin >> filename;
@@ -860,32 +4381,107 @@ int main(void)
   std::cout << glGetString(GL_VERSION) << std::endl;
 
   init_state();
-  init_shader_program();
-
-  load_model(model, strcat(dir, filename));
-  //load_model(model, "BoxTextured/BoxTextured.gltf");
+  init_frame_ring(frame_ring_initial_size);
 
-  // GPU의 VBO를 초기화하는 함수 호출
-  init_buffer_objects();
-  init_texture_objects();
+  std::chrono::steady_clock::time_point startup_begin = std::chrono::steady_clock::now();
+  if (!async_loading || !start_resource_loader(window, std::string(dir) + filename))
+  {
+    //load_model(model, "BoxTextured/BoxTextured.gltf");
+    if (!load_scene(std::string(dir) + filename))
+    {
+      // 오류는 load_model()이 이미 출력했다.
+      glfwSetWindowShouldClose(window, GLFW_TRUE);
+    }
+    else
+    {
+      // GPU의 VBO를 초기화하는 함수 호출
+      init_buffer_objects();
+      init_texture_objects(false);
+      init_scene_objects(texture_bindings);
+      glFinish();
+      std::cout << "Startup (load + GPU upload): "
+                << std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - startup_begin)
+                       .count()
+                << " ms" << std::endl;
+    }
+  }
   glfwSetKeyCallback(window, key_callback);
 
+  // 프레임당 CPU 쪽 그리기 제출 시간 (set_transform + draw_scene)
+  double draw_cpu_ms = 0.0;
+  size_t num_frames = 0;
+
   // Loop until the user closes the window
+  bool first_frame = true;
   while (!glfwWindowShouldClose(window))
   {
+    poll_resource_loader(window);
+
     glClearColor(0.5f, 0.5f, 0.5f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    set_transform();
-    draw_scene();
+
+    // scene이 올라오기 전에는 model을 로더 스레드가 쓰고 있으므로 배경만 그린다.
+    if (scene_resident)
+    {
+      std::chrono::steady_clock::time_point draw_begin = std::chrono::steady_clock::now();
+      set_transform();
+      draw_scene();
+      draw_cpu_ms += std::chrono::duration<double, std::milli>(
+                         std::chrono::steady_clock::now() - draw_begin)
+                         .count();
+      num_frames += 1;
+      end_frame_ring();
+    }
     //if(model.textures.size() == 0)
     //render_object();
     // Swap front and back buffers
     glfwSwapBuffers(window);
 
+    if (first_frame)
+    {
+      std::cout << "First frame after "
+                << std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - startup_begin)
+                       .count()
+                << " ms" << std::endl;
+      first_frame = false;
+    }
+
     // Poll for and process events
     glfwPollEvents();
   }
 
+  if (num_frames > 0)
+  {
+    std::cout << "CPU draw submission: " << draw_cpu_ms / num_frames
+              << " ms/frame over " << num_frames << " frames" << std::endl;
+    std::cout << "Per frame: " << double(render_stats_total.draw_calls) / num_frames
+              << " draw calls for " << double(render_stats_total.instances) / num_frames
+              << " instances, " << double(render_stats_total.state_changes()) / num_frames
+              << " state changes (program " << double(render_stats_total.program_changes) / num_frames
+              << ", VAO " << double(render_stats_total.vao_changes) / num_frames
+              << ", texture " << double(render_stats_total.texture_changes) / num_frames
+              << ", sampler " << double(render_stats_total.sampler_changes) / num_frames
+              << ", material " << double(render_stats_total.material_changes) / num_frames
+              << ")" << std::endl;
+    std::cout << "Per frame: " << double(render_stats_total.triangles) / num_frames
+              << " triangles submitted, " << double(render_stats_total.culled) / num_frames
+              << " primitives culled" << std::endl;
+    std::cout << "Frame ring (" << (frame_ring.persistent ? "persistent" : "unsynchronized")
+              << " map, " << frame_ring_regions << " x " << frame_ring.region_size
+              << " bytes): waited on a fence " << frame_ring.waits << " times" << std::endl;
+  }
+
+  stop_resource_loader();
+  delete_material_uniforms();
+  delete_shader_programs();
+  delete_texture_objects();
+  delete_geometry_arena();
+  delete_vertex_array_objects();
+  delete_frame_ring();
+  delete_buffer_objects();
+
   glfwTerminate();
 
   return 0;
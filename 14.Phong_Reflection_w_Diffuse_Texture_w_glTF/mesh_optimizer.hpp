@@ -0,0 +1,674 @@
+#ifndef MESH_OPTIMIZER_HPP
+#define MESH_OPTIMIZER_HPP
+
+// 로드할 때 인덱스 버퍼의 삼각형 순서를 바꾸는 최적화
+//
+//  1. vertex cache: Forsyth의 점수 방식으로, 최근에 쓴 정점을 많이 공유하는 삼각형을
+//     먼저 그리도록 순서를 바꾼다. (post-transform cache에서 다시 변환하는 정점 수가 준다)
+//  2. overdraw: 1의 결과를 cache가 거의 비는 지점에서 cluster로 나누고, 바깥을 향하는
+//     cluster부터 그리도록 cluster 순서를 바꾼다. (어느 방향에서 봐도 앞쪽 면이 먼저 그려질
+//     가능성이 높아져 early-z로 버려지는 fragment가 는다) cluster 안의 순서는 그대로다.
+//  3. vertex fetch: 정점을 인덱스에서 처음 쓰이는 순서로 옮기고 인덱스를 고친다.
+//     (정점 버퍼를 앞에서부터 차례로 읽게 된다)
+//
+// cache 효율은 FIFO cache를 흉내 내서 ACMR(삼각형당 cache miss)과 ATVR(정점당 cache miss,
+// 1이 최적)로 잰다.
+//
+// optimize_model()은 tinygltf::Model의 버퍼를 그 자리에서 고친다. 나머지 함수는 uint32 인덱스
+// 배열만 다룬다.
+//
+// tiny_gltf.h를 먼저 include해야 한다. (구현부가 중복 정의되지 않도록 여기서는 include하지 않는다)
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace mesh_optimizer
+{
+// 분석에 쓰는 FIFO cache 크기
+const size_t analysis_cache_size = 16;
+
+// Forsyth 점수 계산에 쓰는 LRU cache 크기와 상수
+const int forsyth_cache_size = 32;
+const float cache_decay_power = 1.5f;
+const float last_triangle_score = 0.75f;
+const float valence_boost_scale = 2.0f;
+const float valence_boost_power = 0.5f;
+
+struct CacheStats
+{
+  size_t triangles = 0;
+  size_t vertices = 0; // 인덱스에서 쓰이는 정점 수
+  size_t misses = 0;
+
+  double acmr() const
+  {
+    return triangles ? double(misses) / triangles : 0.0;
+  }
+  double atvr() const
+  {
+    return vertices ? double(misses) / vertices : 0.0;
+  }
+
+  void add(const CacheStats &other)
+  {
+    triangles += other.triangles;
+    vertices += other.vertices;
+    misses += other.misses;
+  }
+};
+
+// FIFO post-transform cache 흉내. 정점마다 cache에 들어간 시각을 기억하고, 지금 시각과의
+// 차이가 cache 크기 이하면 cache에 있는 것으로 본다.
+struct FifoCache
+{
+  std::vector<size_t> timestamps;
+  size_t size;
+  size_t time;
+
+  FifoCache(size_t vertex_count, size_t cache_size)
+      : timestamps(vertex_count, 0), size(cache_size), time(cache_size + 1)
+  {
+  }
+
+  // 모든 정점이 cache에서 밀려난 것으로 만든다.
+  void clear()
+  {
+    time += size + 1;
+  }
+
+  // 정점을 하나 읽고 miss면 true
+  bool access(uint32_t v)
+  {
+    if (time - timestamps[v] <= size)
+      return false;
+    timestamps[v] = time++;
+    return true;
+  }
+
+  unsigned int access_triangle(const uint32_t *tri)
+  {
+    return access(tri[0]) + access(tri[1]) + access(tri[2]);
+  }
+};
+
+// FIFO cache를 흉내 내서 cache miss를 센다.
+inline CacheStats analyze_vertex_cache(const std::vector<uint32_t> &indices, size_t vertex_count,
+                                       size_t cache_size = analysis_cache_size)
+{
+  CacheStats stats;
+  stats.triangles = indices.size() / 3;
+
+  FifoCache cache(vertex_count, cache_size);
+  std::vector<unsigned char> used(vertex_count, 0);
+  for (uint32_t index : indices)
+  {
+    stats.misses += cache.access(index) ? 1 : 0;
+    if (!used[index])
+    {
+      used[index] = 1;
+      stats.vertices += 1;
+    }
+  }
+  return stats;
+}
+
+// 정점 점수: cache 안의 위치(최근일수록 높다)와 남은 삼각형 수(적을수록 높다)
+inline float compute_vertex_score(int cache_position, unsigned int live_triangles)
+{
+  if (live_triangles == 0)
+    return -1.0f;
+
+  float score = 0.0f;
+  if (cache_position >= 0)
+  {
+    if (cache_position < 3)
+    {
+      // 방금 그린 삼각형의 정점은 다음 삼각형이 바로 이어 쓰지 않도록 고정 점수를 준다.
+      score = last_triangle_score;
+    }
+    else
+    {
+      float scaler = 1.0f / (forsyth_cache_size - 3);
+      score = std::pow(1.0f - (cache_position - 3) * scaler, cache_decay_power);
+    }
+  }
+  return score + valence_boost_scale * std::pow(float(live_triangles), -valence_boost_power);
+}
+
+// 자주 쓰는 범위(남은 삼각형 max_valence개 미만)는 표에서 찾는다.
+const unsigned int max_valence = 32;
+
+inline float vertex_score(int cache_position, unsigned int live_triangles)
+{
+  struct Table
+  {
+    float score[forsyth_cache_size + 1][max_valence]; // [cache 위치 + 1][남은 삼각형 수]
+    Table()
+    {
+      for (int c = 0; c <= forsyth_cache_size; ++c)
+      {
+        for (unsigned int v = 0; v < max_valence; ++v)
+          score[c][v] = compute_vertex_score(c - 1, v);
+      }
+    }
+  };
+  static const Table table;
+
+  if (live_triangles >= max_valence)
+    return compute_vertex_score(cache_position, live_triangles);
+  return table.score[cache_position + 1][live_triangles];
+}
+
+// Forsyth의 "Linear-Speed Vertex Cache Optimisation" 순서로 삼각형을 다시 배열한다.
+inline void optimize_vertex_cache(std::vector<uint32_t> &indices, size_t vertex_count)
+{
+  const size_t num_triangles = indices.size() / 3;
+  if (num_triangles == 0)
+    return;
+
+  // 정점 -> 그 정점을 쓰는 삼각형 목록
+  std::vector<unsigned int> live(vertex_count, 0);
+  for (size_t i = 0; i < num_triangles * 3; ++i)
+    live[indices[i]] += 1;
+
+  std::vector<size_t> adjacency_offset(vertex_count + 1, 0);
+  for (size_t v = 0; v < vertex_count; ++v)
+    adjacency_offset[v + 1] = adjacency_offset[v] + live[v];
+  std::vector<uint32_t> adjacency(adjacency_offset[vertex_count]);
+  {
+    std::vector<size_t> fill(adjacency_offset.begin(), adjacency_offset.end() - 1);
+    for (size_t t = 0; t < num_triangles; ++t)
+    {
+      for (int k = 0; k < 3; ++k)
+        adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+    }
+  }
+
+  std::vector<int> cache_position(vertex_count, -1);
+  std::vector<float> score(vertex_count);
+  for (size_t v = 0; v < vertex_count; ++v)
+    score[v] = vertex_score(-1, live[v]);
+
+  std::vector<unsigned char> emitted(num_triangles, 0);
+  std::vector<float> triangle_score(num_triangles);
+  for (size_t t = 0; t < num_triangles; ++t)
+  {
+    triangle_score[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] +
+                        score[indices[t * 3 + 2]];
+  }
+
+  std::vector<uint32_t> result;
+  result.reserve(num_triangles * 3);
+
+  // cache는 크기 + 3칸을 두어 새 삼각형의 정점을 앞에 넣을 때 밀려나는 정점을 받는다.
+  std::vector<uint32_t> cache, next_cache;
+  cache.reserve(forsyth_cache_size + 3);
+  next_cache.reserve(forsyth_cache_size + 3);
+
+  size_t scan = 0; // cache 주변에 후보가 없을 때 남은 삼각형을 찾기 시작할 위치
+  size_t best = 0;
+  float best_score = triangle_score[0];
+  for (size_t t = 1; t < num_triangles; ++t)
+  {
+    if (triangle_score[t] > best_score)
+    {
+      best = t;
+      best_score = triangle_score[t];
+    }
+  }
+
+  for (size_t n = 0; n < num_triangles; ++n)
+  {
+    if (best_score < 0.0f)
+    {
+      while (emitted[scan])
+        ++scan;
+      best = scan;
+    }
+
+    const uint32_t *tri = &indices[best * 3];
+    result.insert(result.end(), tri, tri + 3);
+    emitted[best] = 1;
+
+    // 정점의 남은 삼각형 목록에서 방금 그린 삼각형을 빼고, cache 앞쪽으로 옮긴다.
+    next_cache.assign(tri, tri + 3);
+    for (int k = 0; k < 3; ++k)
+    {
+      uint32_t v = tri[k];
+      uint32_t *begin = &adjacency[adjacency_offset[v]];
+      uint32_t *end = begin + live[v];
+      uint32_t *found = std::find(begin, end, static_cast<uint32_t>(best));
+      std::swap(*found, *(end - 1));
+      live[v] -= 1;
+    }
+    for (uint32_t v : cache)
+    {
+      if (v != tri[0] && v != tri[1] && v != tri[2])
+        next_cache.push_back(v);
+    }
+    cache.swap(next_cache);
+
+    // cache 밖으로 밀려난 정점까지 점수를 다시 매기고, 그 정점을 쓰는 삼각형 중 최고를 고른다.
+    best_score = -1.0f;
+    for (size_t i = 0; i < cache.size(); ++i)
+    {
+      uint32_t v = cache[i];
+      cache_position[v] = i < size_t(forsyth_cache_size) ? int(i) : -1;
+      float new_score = vertex_score(cache_position[v], live[v]);
+      float delta = new_score - score[v];
+      score[v] = new_score;
+
+      for (size_t a = adjacency_offset[v]; a < adjacency_offset[v] + live[v]; ++a)
+      {
+        uint32_t t = adjacency[a];
+        triangle_score[t] += delta;
+        if (triangle_score[t] > best_score)
+        {
+          best = t;
+          best_score = triangle_score[t];
+        }
+      }
+    }
+    if (cache.size() > size_t(forsyth_cache_size))
+      cache.resize(forsyth_cache_size);
+  }
+
+  indices.swap(result);
+}
+
+// vertex cache 순서를 유지한 채 cluster 단위로 앞쪽 면이 먼저 오게 한다. (Tipsify 논문의
+// fast linear-speed overdraw 방식) positions는 정점마다 xyz 3개. threshold는 cluster를 더
+// 잘게 나눌 때 허용하는 ACMR 증가 비율(1.05면 5%)이다.
+inline void optimize_overdraw(std::vector<uint32_t> &indices, const std::vector<float> &positions,
+                              size_t vertex_count, float threshold = 1.05f)
+{
+  const size_t num_triangles = indices.size() / 3;
+  if (num_triangles < 2 || positions.size() < vertex_count * 3)
+    return;
+
+  // 세 정점이 모두 miss인 삼각형에서는 cache가 사실상 비었으므로 거기서 hard cluster를 나눈다.
+  std::vector<size_t> hard;
+  FifoCache cache(vertex_count, analysis_cache_size);
+  for (size_t t = 0; t < num_triangles; ++t)
+  {
+    if (cache.access_triangle(&indices[t * 3]) == 3 || t == 0)
+      hard.push_back(t);
+  }
+  hard.push_back(num_triangles);
+
+  // hard cluster 안을 다시 soft cluster로 나눈다. 빈 cache에서 시작한 soft cluster의 ACMR이
+  // hard cluster 전체 ACMR * threshold 이하로 내려오면 거기서 끊는다. cluster는 순서가 바뀌어
+  // 빈 cache에서 시작할 수 있으므로, 이렇게 하면 재배열 뒤의 ACMR 증가가 threshold 안에 든다.
+  std::vector<size_t> clusters;
+  for (size_t h = 0; h + 1 < hard.size(); ++h)
+  {
+    size_t begin = hard[h];
+    size_t end = hard[h + 1];
+
+    cache.clear();
+    size_t total = 0;
+    for (size_t t = begin; t < end; ++t)
+      total += cache.access_triangle(&indices[t * 3]);
+    float cluster_threshold = threshold * float(total) / float(end - begin);
+
+    clusters.push_back(begin);
+    cache.clear();
+    size_t start = begin;
+    size_t running = 0;
+    for (size_t t = begin; t + 1 < end; ++t)
+    {
+      running += cache.access_triangle(&indices[t * 3]);
+      if (float(running) / float(t + 1 - start) <= cluster_threshold)
+      {
+        clusters.push_back(t + 1);
+        cache.clear();
+        start = t + 1;
+        running = 0;
+      }
+    }
+  }
+  clusters.push_back(num_triangles);
+  const size_t num_clusters = clusters.size() - 1;
+  if (num_clusters < 2)
+    return;
+
+  // 메쉬 중심 (삼각형 넓이 가중)
+  std::vector<float> centroid(num_clusters * 3, 0.0f);
+  std::vector<float> normal(num_clusters * 3, 0.0f);
+  std::vector<float> area(num_clusters, 0.0f);
+  float mesh_centroid[3] = {0.0f, 0.0f, 0.0f};
+  float mesh_area = 0.0f;
+  for (size_t c = 0; c < num_clusters; ++c)
+  {
+    for (size_t t = clusters[c]; t < clusters[c + 1]; ++t)
+    {
+      const float *p0 = &positions[indices[t * 3] * 3];
+      const float *p1 = &positions[indices[t * 3 + 1] * 3];
+      const float *p2 = &positions[indices[t * 3 + 2] * 3];
+      float e1[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+      float e2[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+      float n[3] = {e1[1] * e2[2] - e1[2] * e2[1],
+                    e1[2] * e2[0] - e1[0] * e2[2],
+                    e1[0] * e2[1] - e1[1] * e2[0]};
+      float a = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]); // 넓이의 2배
+
+      for (int k = 0; k < 3; ++k)
+      {
+        float center = (p0[k] + p1[k] + p2[k]) / 3.0f;
+        centroid[c * 3 + k] += center * a;
+        normal[c * 3 + k] += n[k];
+        mesh_centroid[k] += center * a;
+      }
+      area[c] += a;
+      mesh_area += a;
+    }
+  }
+  if (mesh_area <= 0.0f)
+    return;
+  for (int k = 0; k < 3; ++k)
+    mesh_centroid[k] /= mesh_area;
+
+  // 중심에서 cluster로 가는 방향과 cluster 법선이 같은 쪽일수록(바깥을 향할수록) 먼저 그린다.
+  std::vector<std::pair<float, uint32_t>> order(num_clusters);
+  for (size_t c = 0; c < num_clusters; ++c)
+  {
+    float key = 0.0f;
+    if (area[c] > 0.0f)
+    {
+      float length = std::sqrt(normal[c * 3] * normal[c * 3] + normal[c * 3 + 1] * normal[c * 3 + 1] +
+                               normal[c * 3 + 2] * normal[c * 3 + 2]);
+      for (int k = 0; k < 3; ++k)
+      {
+        float direction = centroid[c * 3 + k] / area[c] - mesh_centroid[k];
+        key += direction * (length > 0.0f ? normal[c * 3 + k] / length : 0.0f);
+      }
+    }
+    order[c] = std::make_pair(-key, static_cast<uint32_t>(c));
+  }
+  std::stable_sort(order.begin(), order.end());
+
+  std::vector<uint32_t> result;
+  result.reserve(indices.size());
+  for (const std::pair<float, uint32_t> &cluster : order)
+  {
+    result.insert(result.end(), indices.begin() + clusters[cluster.second] * 3,
+                  indices.begin() + clusters[cluster.second + 1] * 3);
+  }
+  indices.swap(result);
+}
+
+// 정점을 인덱스에서 처음 쓰이는 순서로 다시 번호 매기고 인덱스를 고친다.
+// 돌려주는 remap[옛 번호] = 새 번호. 쓰이지 않는 정점은 개수가 바뀌지 않도록 뒤에 붙인다.
+inline std::vector<uint32_t> optimize_vertex_fetch_remap(std::vector<uint32_t> &indices,
+                                                         size_t vertex_count)
+{
+  const uint32_t unused = ~0u;
+  std::vector<uint32_t> remap(vertex_count, unused);
+  uint32_t next = 0;
+  for (uint32_t &index : indices)
+  {
+    if (remap[index] == unused)
+      remap[index] = next++;
+    index = remap[index];
+  }
+  for (uint32_t &r : remap)
+  {
+    if (r == unused)
+      r = next++;
+  }
+  return remap;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+/// tinygltf::Model에 적용
+////////////////////////////////////////////////////////////////////////////////
+struct Options
+{
+  bool vertex_cache = true;
+  bool overdraw = true;
+  bool vertex_fetch = true;
+  float overdraw_threshold = 1.05f;
+};
+
+struct Report
+{
+  size_t primitives = 0; // 다시 배열한 primitive 수
+  size_t skipped = 0;    // 인덱스가 없거나 삼각형이 아니거나 accessor를 같이 쓰는 primitive
+  size_t remapped = 0;   // 정점 순서까지 바꾼 primitive 수
+  CacheStats before;
+  CacheStats after;
+};
+
+// accessor의 i번째 원소 위치. 범위를 벗어나면 nullptr.
+inline unsigned char *element_at(tinygltf::Model &model, const tinygltf::Accessor &accessor,
+                                 size_t element_size, size_t i)
+{
+  const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
+  tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
+
+  int stride = accessor.ByteStride(bufferView);
+  if (stride <= 0)
+    return nullptr;
+
+  size_t offset = bufferView.byteOffset + accessor.byteOffset + i * size_t(stride);
+  if (offset + element_size > buffer.data.size())
+    return nullptr;
+  return buffer.data.data() + offset;
+}
+
+inline size_t element_size(const tinygltf::Accessor &accessor)
+{
+  int32_t component_size = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+  int32_t num_components = tinygltf::GetTypeSizeInBytes(accessor.type); // 성분 개수를 돌려준다.
+  if (component_size <= 0 || num_components <= 0)
+    return 0;
+  return size_t(component_size) * size_t(num_components);
+}
+
+// 고쳐 쓸 수 있는 accessor인지 (bufferView가 있고 sparse가 아니며 데이터가 버퍼 안에 있다)
+inline bool is_writable(tinygltf::Model &model, int accessor_index)
+{
+  if (accessor_index < 0 || size_t(accessor_index) >= model.accessors.size())
+    return false;
+  const tinygltf::Accessor &accessor = model.accessors[accessor_index];
+  if (accessor.bufferView < 0 || size_t(accessor.bufferView) >= model.bufferViews.size() ||
+      accessor.sparse.isSparse)
+    return false;
+  size_t size = element_size(accessor);
+  if (size == 0)
+    return false;
+
+  const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
+  if (bufferView.buffer < 0 || size_t(bufferView.buffer) >= model.buffers.size())
+    return false;
+  model.buffers[bufferView.buffer].Materialize();
+  return accessor.count == 0 || element_at(model, accessor, size, accessor.count - 1) != nullptr;
+}
+
+inline bool read_indices(tinygltf::Model &model, const tinygltf::Accessor &accessor,
+                         std::vector<uint32_t> *indices)
+{
+  size_t size = element_size(accessor);
+  indices->resize(accessor.count);
+  for (size_t i = 0; i < accessor.count; ++i)
+  {
+    const unsigned char *p = element_at(model, accessor, size, i);
+    if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
+    {
+      (*indices)[i] = *p;
+    }
+    else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+    {
+      uint16_t v;
+      std::memcpy(&v, p, sizeof(v));
+      (*indices)[i] = v;
+    }
+    else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT)
+    {
+      std::memcpy(&(*indices)[i], p, sizeof(uint32_t));
+    }
+    else
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline void write_indices(tinygltf::Model &model, const tinygltf::Accessor &accessor,
+                          const std::vector<uint32_t> &indices)
+{
+  size_t size = element_size(accessor);
+  for (size_t i = 0; i < indices.size(); ++i)
+  {
+    unsigned char *p = element_at(model, accessor, size, i);
+    if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE)
+    {
+      *p = static_cast<unsigned char>(indices[i]);
+    }
+    else if (accessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT)
+    {
+      uint16_t v = static_cast<uint16_t>(indices[i]);
+      std::memcpy(p, &v, sizeof(v));
+    }
+    else
+    {
+      std::memcpy(p, &indices[i], sizeof(uint32_t));
+    }
+  }
+}
+
+// accessor의 원소를 remap[옛 번호] = 새 번호 순서로 옮긴다.
+inline void remap_accessor(tinygltf::Model &model, const tinygltf::Accessor &accessor,
+                           const std::vector<uint32_t> &remap)
+{
+  size_t size = element_size(accessor);
+  std::vector<unsigned char> copy(accessor.count * size);
+  for (size_t i = 0; i < accessor.count; ++i)
+    std::memcpy(&copy[remap[i] * size], element_at(model, accessor, size, i), size);
+  for (size_t i = 0; i < accessor.count; ++i)
+    std::memcpy(element_at(model, accessor, size, i), &copy[i * size], size);
+}
+
+// float VEC3 POSITION만 읽는다. (overdraw 정렬에만 쓴다)
+inline bool read_positions(tinygltf::Model &model, const tinygltf::Accessor &accessor,
+                           std::vector<float> *positions)
+{
+  if (accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT ||
+      accessor.type != TINYGLTF_TYPE_VEC3)
+    return false;
+
+  positions->resize(accessor.count * 3);
+  for (size_t i = 0; i < accessor.count; ++i)
+    std::memcpy(&(*positions)[i * 3], element_at(model, accessor, 12, i), 12);
+  return true;
+}
+
+// 인덱스가 있는 삼각형 primitive마다 인덱스를 다시 배열하고, 필요하면 정점 순서도 바꾼다.
+// 다른 primitive와 accessor를 같이 쓰는 primitive는 건너뛴다. (한쪽 순서만 바꾸면 다른
+// 쪽이 깨지므로) 버퍼가 매핑되어 있으면 복사한 뒤 고친다.
+inline Report optimize_model(tinygltf::Model &model, const Options &options)
+{
+  Report report;
+
+  // accessor마다 몇 번 primitive에서 쓰이는지
+  std::vector<unsigned int> uses(model.accessors.size(), 0);
+  for (const tinygltf::Mesh &mesh : model.meshes)
+  {
+    for (const tinygltf::Primitive &primitive : mesh.primitives)
+    {
+      std::vector<int> accessors;
+      for (const std::pair<const std::string, int> &attrib : primitive.attributes)
+        accessors.push_back(attrib.second);
+      for (const std::map<std::string, int> &target : primitive.targets)
+      {
+        for (const std::pair<const std::string, int> &attrib : target)
+          accessors.push_back(attrib.second);
+      }
+      accessors.push_back(primitive.indices);
+      for (int accessor : accessors)
+      {
+        if (accessor >= 0 && size_t(accessor) < uses.size())
+          uses[accessor] += 1;
+      }
+    }
+  }
+
+  for (const tinygltf::Mesh &mesh : model.meshes)
+  {
+    for (const tinygltf::Primitive &primitive : mesh.primitives)
+    {
+      std::map<std::string, int>::const_iterator position = primitive.attributes.find("POSITION");
+      if (primitive.mode != TINYGLTF_MODE_TRIANGLES || primitive.indices < 0 ||
+          position == primitive.attributes.end() || !is_writable(model, primitive.indices) ||
+          uses[primitive.indices] != 1 || !is_writable(model, position->second))
+      {
+        report.skipped += 1;
+        continue;
+      }
+
+      const tinygltf::Accessor &index_accessor = model.accessors[primitive.indices];
+      size_t vertex_count = model.accessors[position->second].count;
+      std::vector<uint32_t> indices;
+      if (!read_indices(model, index_accessor, &indices) || indices.size() % 3 != 0)
+      {
+        report.skipped += 1;
+        continue;
+      }
+      bool in_range = true;
+      for (uint32_t index : indices)
+        in_range = in_range && index < vertex_count;
+      if (!in_range)
+      {
+        report.skipped += 1;
+        continue;
+      }
+
+      report.before.add(analyze_vertex_cache(indices, vertex_count));
+
+      if (options.vertex_cache)
+        optimize_vertex_cache(indices, vertex_count);
+
+      std::vector<float> positions;
+      if (options.overdraw && read_positions(model, model.accessors[position->second], &positions))
+        optimize_overdraw(indices, positions, vertex_count, options.overdraw_threshold);
+
+      // 정점을 옮기려면 이 primitive의 모든 attribute(모프 타깃 포함)를 혼자 써야 한다.
+      std::vector<int> vertex_accessors;
+      bool remappable = options.vertex_fetch;
+      for (const std::pair<const std::string, int> &attrib : primitive.attributes)
+        vertex_accessors.push_back(attrib.second);
+      for (const std::map<std::string, int> &target : primitive.targets)
+      {
+        for (const std::pair<const std::string, int> &attrib : target)
+          vertex_accessors.push_back(attrib.second);
+      }
+      for (int accessor : vertex_accessors)
+      {
+        remappable = remappable && is_writable(model, accessor) && uses[accessor] == 1 &&
+                     model.accessors[accessor].count == vertex_count;
+      }
+
+      if (remappable)
+      {
+        std::vector<uint32_t> remap = optimize_vertex_fetch_remap(indices, vertex_count);
+        for (int accessor : vertex_accessors)
+          remap_accessor(model, model.accessors[accessor], remap);
+        report.remapped += 1;
+      }
+
+      write_indices(model, index_accessor, indices);
+      report.after.add(analyze_vertex_cache(indices, vertex_count));
+      report.primitives += 1;
+    }
+  }
+  return report;
+}
+} // namespace mesh_optimizer
+
+#endif // MESH_OPTIMIZER_HPP
@@ -0,0 +1,174 @@
+#ifndef PROGRAM_CACHE_HPP
+#define PROGRAM_CACHE_HPP
+
+// 링크된 셰이더 program의 바이너리 캐시 (shader/ 아래, 또는 --cache-dir 아래의 "programs.cache")
+//
+// glGetProgramBinary로 받은 바이너리를 키별로 모아 파일 하나에 저장하고, 다음 실행에서는
+// glProgramBinary로 넘겨 컴파일과 링크를 건너뛴다. 키는 드라이버(GL_VENDOR, GL_RENDERER,
+// GL_VERSION)와 #define을 붙인 뒤의 vertex/fragment 소스를 해시한 값이라, 드라이버나 소스가
+// 바뀌면 자연히 다른 키가 되어 다시 컴파일한다. 드라이버가 바이너리를 거부하면 호출하는 쪽에서
+// 다시 컴파일해 그 키의 바이너리를 바꾼다.
+//
+// 파일 형식: Header, 그 뒤에 (EntryHeader, binary)가 count개. 모두 이 기계의 바이트 순서다.
+// GL을 부르지 않는다.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace program_cache
+{
+// 파일 배치가 바뀌면 올린다.
+const uint32_t VERSION = 1;
+
+struct Header
+{
+  char magic[4]; // "PRGC"
+  uint32_t version;
+  uint32_t count;
+  uint32_t reserved;
+};
+
+struct EntryHeader
+{
+  uint64_t key;
+  uint32_t format; // glGetProgramBinary의 binaryFormat
+  uint32_t size;
+};
+
+struct Entry
+{
+  uint32_t format = 0;
+  std::vector<unsigned char> binary;
+};
+typedef std::map<uint64_t, Entry> Entries;
+
+const char magic[4] = {'P', 'R', 'G', 'C'};
+
+// 64비트 FNV-1a. 소스 몇 KB를 시작할 때 한 번 해시하므로 바이트 단위로 충분하다.
+inline uint64_t hash_string(const std::string &str, uint64_t hash = 14695981039346656037ull)
+{
+  for (unsigned char c : str)
+    hash = (hash ^ c) * 1099511628211ull;
+  // 이어 붙인 문자열의 경계가 키에 남도록 길이도 섞는다.
+  return (hash ^ str.size()) * 1099511628211ull;
+}
+
+inline uint64_t program_key(const std::string &driver, const std::string &vertex_source,
+                            const std::string &fragment_source)
+{
+  return hash_string(fragment_source, hash_string(vertex_source, hash_string(driver)));
+}
+
+// 파일이 없으면 entries를 비운 채 true. 파일이 있는데 읽을 수 없으면 false이고 이유를 err에 남긴다.
+inline bool read_entries(const std::string &path, Entries *entries, std::string *err)
+{
+  entries->clear();
+
+  std::ifstream file(path.c_str(), std::ifstream::binary);
+  if (!file)
+    return true;
+
+  std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)),
+                                  std::istreambuf_iterator<char>());
+
+  Header header;
+  if (data.size() < sizeof(header))
+  {
+    *err = "truncated header";
+    return false;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  if (std::memcmp(header.magic, magic, sizeof(magic)) != 0)
+  {
+    *err = "not a program cache";
+    return false;
+  }
+  if (header.version != VERSION)
+  {
+    *err = "version " + std::to_string(header.version) + " (expected " +
+           std::to_string(VERSION) + ")";
+    return false;
+  }
+
+  size_t offset = sizeof(header);
+  for (uint32_t i = 0; i < header.count; ++i)
+  {
+    EntryHeader entry_header;
+    if (data.size() - offset < sizeof(entry_header))
+    {
+      *err = "truncated entry";
+      entries->clear();
+      return false;
+    }
+    std::memcpy(&entry_header, data.data() + offset, sizeof(entry_header));
+    offset += sizeof(entry_header);
+    if (data.size() - offset < entry_header.size)
+    {
+      *err = "truncated entry";
+      entries->clear();
+      return false;
+    }
+
+    Entry &entry = (*entries)[entry_header.key];
+    entry.format = entry_header.format;
+    entry.binary.assign(data.begin() + offset, data.begin() + offset + entry_header.size);
+    offset += entry_header.size;
+  }
+  return true;
+}
+
+// 다 쓴 뒤에 이름을 바꿔서, 쓰다 만 파일이 남지 않게 한다.
+inline bool write_entries(const std::string &path, const Entries &entries, std::string *err)
+{
+  std::string temp_path = path + ".tmp";
+  {
+    std::ofstream file(temp_path.c_str(), std::ofstream::binary | std::ofstream::trunc);
+    if (!file)
+    {
+      *err = "cannot write " + temp_path;
+      return false;
+    }
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = VERSION;
+    header.count = static_cast<uint32_t>(entries.size());
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    for (const std::pair<const uint64_t, Entry> &entry : entries)
+    {
+      EntryHeader entry_header;
+      entry_header.key = entry.first;
+      entry_header.format = entry.second.format;
+      entry_header.size = static_cast<uint32_t>(entry.second.binary.size());
+      file.write(reinterpret_cast<const char *>(&entry_header), sizeof(entry_header));
+      file.write(reinterpret_cast<const char *>(entry.second.binary.data()),
+                 entry.second.binary.size());
+    }
+
+    if (!file)
+    {
+      *err = "cannot write " + temp_path;
+      std::remove(temp_path.c_str());
+      return false;
+    }
+  }
+
+  if (std::rename(temp_path.c_str(), path.c_str()) != 0)
+  {
+    *err = "cannot rename " + temp_path + " to " + path;
+    std::remove(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+} // namespace program_cache
+
+#endif // PROGRAM_CACHE_HPP
@@ -0,0 +1,487 @@
+#ifndef QUANTIZATION_HPP
+#define QUANTIZATION_HPP
+
+// 로드할 때 정점 attribute를 작은 정수 형식으로 바꾸는 양자화 (KHR_mesh_quantization과 같은 형식)
+//
+//  - POSITION: 메쉬 전체의 bounding box를 [-1, 1]로 옮긴 int16 normalized. 복원 변환
+//    (quantized * scale + offset, 세 축이 같은 scale이라 법선 변환이 그대로다)은 메쉬마다
+//    돌려주고, 뷰어가 instance의 world 행렬 뒤에 곱한다.
+//  - NORMAL: 팔면체(octahedral) 인코딩한 int16 normalized VEC2. (KHR_mesh_quantization에는
+//    없는 형식이라 이 뷰어 안에서만 쓴다. 뷰어가 primitive마다 NORMAL accessor 형식을
+//    is_octahedral_normal()로 보고 OCTAHEDRAL_NORMALS 셰이더 조합을 골라 복원한다)
+//  - TEXCOORD_n: 값이 모두 [0, 1] 안이면 uint16 normalized. 벗어나면 float로 둔다.
+//  - COLOR_n: uint8 normalized
+// 이미 정수 형식인 attribute(KHR_mesh_quantization 파일)는 법선만 팔면체로 바꾸고 그대로 둔다.
+// 메쉬마다 원본과 복원 값의 최대 오차를 Report에 남긴다.
+//
+// tiny_gltf.h를 먼저 include해야 한다. (구현부가 중복 정의되지 않도록 여기서는 include하지 않는다)
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace quantization
+{
+// quantized 위치 -> 원래 위치: p * scale + offset
+struct Dequantization
+{
+  float offset[3] = {0.0f, 0.0f, 0.0f};
+  float scale = 1.0f;
+};
+
+struct MeshReport
+{
+  std::string name;
+  bool positions = false; // 위치를 양자화했는가
+  double position_error = 0.0; // 원래 단위의 최대 오차
+  double position_extent = 0.0; // bounding box의 가장 긴 변
+  double normal_error = 0.0;    // 최대 각도 오차(도)
+  double texcoord_error = 0.0;
+  size_t bytes_before = 0; // 바꾼 attribute의 정점 데이터 크기
+  size_t bytes_after = 0;
+};
+
+struct Report
+{
+  std::vector<MeshReport> meshes;
+  size_t bytes_before = 0;
+  size_t bytes_after = 0;
+};
+
+inline int16_t quantize_snorm16(float v)
+{
+  return static_cast<int16_t>(std::lround(std::max(-1.0f, std::min(1.0f, v)) * 32767.0f));
+}
+
+inline float dequantize_snorm16(int16_t v)
+{
+  return std::max(v / 32767.0f, -1.0f);
+}
+
+// 단위 벡터를 팔면체에 투영해 [-1, 1]^2로 편다. (아래쪽 반구는 대각선으로 접는다)
+inline void encode_octahedral(const float n[3], int16_t out[2])
+{
+  float length = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+  if (length == 0.0f)
+  {
+    out[0] = out[1] = 0;
+    return;
+  }
+  float x = n[0] / length;
+  float y = n[1] / length;
+  if (n[2] < 0.0f)
+  {
+    float fx = (1.0f - std::fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+    float fy = (1.0f - std::fabs(x)) * (y >= 0.0f ? 1.0f : -1.0f);
+    x = fx;
+    y = fy;
+  }
+  out[0] = quantize_snorm16(x);
+  out[1] = quantize_snorm16(y);
+}
+
+inline void decode_octahedral(const int16_t e[2], float n[3])
+{
+  n[0] = dequantize_snorm16(e[0]);
+  n[1] = dequantize_snorm16(e[1]);
+  n[2] = 1.0f - std::fabs(n[0]) - std::fabs(n[1]);
+  if (n[2] < 0.0f)
+  {
+    float x = (1.0f - std::fabs(n[1])) * (n[0] >= 0.0f ? 1.0f : -1.0f);
+    float y = (1.0f - std::fabs(n[0])) * (n[1] >= 0.0f ? 1.0f : -1.0f);
+    n[0] = x;
+    n[1] = y;
+  }
+  float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+  for (int k = 0; k < 3; ++k)
+    n[k] /= length;
+}
+
+// quantize_normals()가 만든 팔면체 인코딩 법선인지 (int16 normalized VEC2)
+inline bool is_octahedral_normal(const tinygltf::Accessor &accessor)
+{
+  return accessor.type == TINYGLTF_TYPE_VEC2 &&
+         accessor.componentType == TINYGLTF_COMPONENT_TYPE_SHORT && accessor.normalized;
+}
+
+// accessor를 float 배열로 읽는다. 정수는 normalized면 [-1, 1]/[0, 1]로, 아니면 값 그대로.
+inline bool read_floats(const tinygltf::Model &model, int accessor_index,
+                        std::vector<float> *values, int *num_components)
+{
+  if (accessor_index < 0 || size_t(accessor_index) >= model.accessors.size())
+    return false;
+  const tinygltf::Accessor &accessor = model.accessors[accessor_index];
+  if (accessor.bufferView < 0 || accessor.sparse.isSparse)
+    return false;
+
+  const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
+  const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
+  const int component_size = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+  const int components = tinygltf::GetTypeSizeInBytes(accessor.type); // 성분 개수를 돌려준다.
+  const int stride = accessor.ByteStride(bufferView);
+  if (component_size <= 0 || components <= 0 || stride <= 0)
+    return false;
+
+  size_t begin = bufferView.byteOffset + accessor.byteOffset;
+  if (accessor.count > 0 &&
+      begin + (accessor.count - 1) * size_t(stride) + components * component_size > buffer.Size())
+    return false;
+
+  *num_components = components;
+  values->resize(accessor.count * components);
+  for (size_t i = 0; i < accessor.count; ++i)
+  {
+    const unsigned char *element = buffer.Data() + begin + i * size_t(stride);
+    for (int k = 0; k < components; ++k)
+    {
+      const unsigned char *p = element + k * component_size;
+      float value = 0.0f;
+      switch (accessor.componentType)
+      {
+      case TINYGLTF_COMPONENT_TYPE_FLOAT:
+        std::memcpy(&value, p, sizeof(float));
+        break;
+      case TINYGLTF_COMPONENT_TYPE_BYTE:
+      {
+        int8_t v = *reinterpret_cast<const int8_t *>(p);
+        value = accessor.normalized ? std::max(v / 127.0f, -1.0f) : float(v);
+        break;
+      }
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        value = accessor.normalized ? *p / 255.0f : float(*p);
+        break;
+      case TINYGLTF_COMPONENT_TYPE_SHORT:
+      {
+        int16_t v;
+        std::memcpy(&v, p, sizeof(v));
+        value = accessor.normalized ? std::max(v / 32767.0f, -1.0f) : float(v);
+        break;
+      }
+      case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+      {
+        uint16_t v;
+        std::memcpy(&v, p, sizeof(v));
+        value = accessor.normalized ? v / 65535.0f : float(v);
+        break;
+      }
+      default:
+        return false;
+      }
+      (*values)[i * components + k] = value;
+    }
+  }
+  return true;
+}
+
+// 양자화한 데이터를 모으는 새 buffer. 정점 attribute마다 bufferView 하나를 만든다.
+struct Output
+{
+  tinygltf::Model &model;
+  int buffer;
+
+  explicit Output(tinygltf::Model &target) : model(target)
+  {
+    buffer = static_cast<int>(model.buffers.size());
+    model.buffers.push_back(tinygltf::Buffer());
+  }
+
+  // element_size 바이트짜리 원소 count개를 4바이트 stride로 담는 accessor를 만든다.
+  // 돌려주는 포인터에 원소를 stride 간격으로 쓴다.
+  int add_accessor(const tinygltf::Accessor &source, int component_type, int type,
+                   size_t element_size, size_t *stride, unsigned char **data)
+  {
+    std::vector<unsigned char> &bytes = model.buffers[buffer].data;
+    *stride = (element_size + 3) / 4 * 4;
+
+    tinygltf::BufferView view;
+    view.buffer = buffer;
+    view.byteOffset = bytes.size();
+    view.byteLength = *stride * source.count;
+    view.byteStride = *stride;
+    view.target = TINYGLTF_TARGET_ARRAY_BUFFER;
+    bytes.resize(bytes.size() + view.byteLength, 0);
+
+    tinygltf::Accessor accessor;
+    accessor.name = source.name;
+    accessor.bufferView = static_cast<int>(model.bufferViews.size());
+    accessor.byteOffset = 0;
+    accessor.componentType = component_type;
+    accessor.normalized = true;
+    accessor.count = source.count;
+    accessor.type = type;
+    model.bufferViews.push_back(view);
+    model.accessors.push_back(accessor);
+
+    *data = model.buffers[buffer].data.data() + view.byteOffset;
+    return static_cast<int>(model.accessors.size() - 1);
+  }
+};
+
+inline size_t accessor_bytes(const tinygltf::Accessor &accessor)
+{
+  int component_size = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+  int components = tinygltf::GetTypeSizeInBytes(accessor.type);
+  if (component_size <= 0 || components <= 0)
+    return 0;
+  return accessor.count * size_t(component_size * components);
+}
+
+// 메쉬 하나의 POSITION을 양자화한다. 모든 primitive의 위치가 float VEC3이고 모프 타깃이
+// 없을 때만 바꾼다. (타깃의 변위가 원래 단위로 남으므로)
+inline void quantize_positions(tinygltf::Model &model, tinygltf::Mesh &mesh, Output &output,
+                               Dequantization *dequantization, MeshReport *report)
+{
+  float lo[3] = {0.0f, 0.0f, 0.0f};
+  float hi[3] = {0.0f, 0.0f, 0.0f};
+  bool first = true;
+  std::map<int, std::vector<float>> positions; // 원본 accessor -> 값
+  for (const tinygltf::Primitive &primitive : mesh.primitives)
+  {
+    std::map<std::string, int>::const_iterator it = primitive.attributes.find("POSITION");
+    if (it == primitive.attributes.end() || !primitive.targets.empty())
+      return;
+    const tinygltf::Accessor &accessor = model.accessors[it->second];
+    if (accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT || accessor.type != TINYGLTF_TYPE_VEC3)
+      return;
+
+    std::vector<float> &values = positions[it->second];
+    int components = 0;
+    if (values.empty() && !read_floats(model, it->second, &values, &components))
+      return;
+    for (size_t i = 0; i + 2 < values.size(); i += 3)
+    {
+      for (int k = 0; k < 3; ++k)
+      {
+        lo[k] = first ? values[i + k] : std::min(lo[k], values[i + k]);
+        hi[k] = first ? values[i + k] : std::max(hi[k], values[i + k]);
+      }
+      first = false;
+    }
+  }
+  if (positions.empty())
+    return;
+
+  float scale = 0.0f;
+  for (int k = 0; k < 3; ++k)
+  {
+    dequantization->offset[k] = 0.5f * (lo[k] + hi[k]);
+    scale = std::max(scale, 0.5f * (hi[k] - lo[k]));
+  }
+  dequantization->scale = scale > 0.0f ? scale : 1.0f;
+  report->positions = true;
+  report->position_extent = 2.0 * scale;
+
+  std::map<int, int> replaced;
+  for (const std::pair<const int, std::vector<float>> &source : positions)
+  {
+    const tinygltf::Accessor &original = model.accessors[source.first];
+    size_t stride = 0;
+    unsigned char *data = nullptr;
+    int index = output.add_accessor(original, TINYGLTF_COMPONENT_TYPE_SHORT, TINYGLTF_TYPE_VEC3,
+                                    3 * sizeof(int16_t), &stride, &data);
+
+    // min/max는 양자화된 정수 값으로 둔다. (KHR_mesh_quantization 규칙)
+    std::vector<double> qmin(3, 32767.0), qmax(3, -32767.0);
+    const std::vector<float> &values = source.second;
+    for (size_t i = 0; i < original.count; ++i)
+    {
+      int16_t q[3];
+      for (int k = 0; k < 3; ++k)
+      {
+        float p = values[i * 3 + k];
+        q[k] = quantize_snorm16((p - dequantization->offset[k]) / dequantization->scale);
+        float restored = dequantize_snorm16(q[k]) * dequantization->scale + dequantization->offset[k];
+        report->position_error = std::max(report->position_error, double(std::fabs(restored - p)));
+        qmin[k] = std::min(qmin[k], double(q[k]));
+        qmax[k] = std::max(qmax[k], double(q[k]));
+      }
+      std::memcpy(data + i * stride, q, sizeof(q));
+    }
+    if (original.count > 0)
+    {
+      model.accessors[index].minValues = qmin;
+      model.accessors[index].maxValues = qmax;
+    }
+
+    report->bytes_before += accessor_bytes(original);
+    report->bytes_after += stride * original.count;
+    replaced[source.first] = index;
+  }
+
+  for (tinygltf::Primitive &primitive : mesh.primitives)
+    primitive.attributes["POSITION"] = replaced[primitive.attributes["POSITION"]];
+}
+
+// NORMAL을 팔면체 인코딩으로 바꾼다. 원래 형식과 관계없이 모두 바꾼다.
+// 바꿀 수 없으면 false. (원래 법선을 그대로 두고, 그 primitive는 일반 법선 셰이더로 그린다)
+inline bool quantize_normals(tinygltf::Model &model, int accessor_index, Output &output,
+                             int *replaced, MeshReport *report)
+{
+  std::vector<float> values;
+  int components = 0;
+  if (!read_floats(model, accessor_index, &values, &components) || components != 3)
+    return false;
+
+  const tinygltf::Accessor original = model.accessors[accessor_index];
+  size_t stride = 0;
+  unsigned char *data = nullptr;
+  *replaced = output.add_accessor(original, TINYGLTF_COMPONENT_TYPE_SHORT, TINYGLTF_TYPE_VEC2,
+                                  2 * sizeof(int16_t), &stride, &data);
+  for (size_t i = 0; i < original.count; ++i)
+  {
+    const float *n = &values[i * 3];
+    int16_t e[2];
+    encode_octahedral(n, e);
+    std::memcpy(data + i * stride, e, sizeof(e));
+
+    float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    if (length > 0.0f)
+    {
+      float decoded[3];
+      decode_octahedral(e, decoded);
+      float cosine = (n[0] * decoded[0] + n[1] * decoded[1] + n[2] * decoded[2]) / length;
+      double degrees = std::acos(std::max(-1.0f, std::min(1.0f, cosine))) * 180.0 / 3.14159265358979323846;
+      report->normal_error = std::max(report->normal_error, degrees);
+    }
+  }
+
+  report->bytes_before += accessor_bytes(original);
+  report->bytes_after += stride * original.count;
+  return true;
+}
+
+// float TEXCOORD가 모두 [0, 1] 안이면 uint16 normalized로 바꾼다.
+inline bool quantize_texcoords(tinygltf::Model &model, int accessor_index, Output &output,
+                               int *replaced, MeshReport *report)
+{
+  const tinygltf::Accessor original = model.accessors[accessor_index];
+  std::vector<float> values;
+  int components = 0;
+  if (original.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT ||
+      !read_floats(model, accessor_index, &values, &components) || components != 2)
+    return false;
+  for (float v : values)
+  {
+    if (!(v >= 0.0f && v <= 1.0f))
+      return false;
+  }
+
+  size_t stride = 0;
+  unsigned char *data = nullptr;
+  *replaced = output.add_accessor(original, TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT,
+                                  TINYGLTF_TYPE_VEC2, 2 * sizeof(uint16_t), &stride, &data);
+  for (size_t i = 0; i < original.count; ++i)
+  {
+    uint16_t q[2];
+    for (int k = 0; k < 2; ++k)
+    {
+      float v = values[i * 2 + k];
+      q[k] = static_cast<uint16_t>(std::lround(v * 65535.0f));
+      report->texcoord_error = std::max(report->texcoord_error, double(std::fabs(q[k] / 65535.0f - v)));
+    }
+    std::memcpy(data + i * stride, q, sizeof(q));
+  }
+
+  report->bytes_before += accessor_bytes(original);
+  report->bytes_after += stride * original.count;
+  return true;
+}
+
+// float COLOR를 uint8 normalized로 바꾼다.
+inline bool quantize_colors(tinygltf::Model &model, int accessor_index, Output &output,
+                            int *replaced, MeshReport *report)
+{
+  const tinygltf::Accessor original = model.accessors[accessor_index];
+  std::vector<float> values;
+  int components = 0;
+  if (original.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT ||
+      !read_floats(model, accessor_index, &values, &components) ||
+      (components != 3 && components != 4))
+    return false;
+
+  size_t stride = 0;
+  unsigned char *data = nullptr;
+  *replaced = output.add_accessor(original, TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE, original.type,
+                                  components, &stride, &data);
+  for (size_t i = 0; i < original.count; ++i)
+  {
+    for (int k = 0; k < components; ++k)
+    {
+      float v = std::max(0.0f, std::min(1.0f, values[i * components + k]));
+      data[i * stride + k] = static_cast<unsigned char>(std::lround(v * 255.0f));
+    }
+  }
+
+  report->bytes_before += accessor_bytes(original);
+  report->bytes_after += stride * original.count;
+  return true;
+}
+
+// model의 모든 메쉬를 양자화한다. dequantization[mesh]에 위치 복원 변환을 돌려준다.
+// (위치를 바꾸지 않은 메쉬는 항등 변환) 원래 accessor는 남지만 primitive가 더 이상 가리키지 않는다.
+inline Report quantize_model(tinygltf::Model &model, std::vector<Dequantization> *dequantization)
+{
+  Report report;
+  Output output(model);
+  dequantization->assign(model.meshes.size(), Dequantization());
+
+  // 여러 primitive가 같이 쓰는 accessor는 한 번만 바꾼다. (POSITION은 메쉬마다 변환이 달라 따로)
+  std::map<int, int> replaced;
+
+  for (size_t m = 0; m < model.meshes.size(); ++m)
+  {
+    tinygltf::Mesh &mesh = model.meshes[m];
+    MeshReport mesh_report;
+    mesh_report.name = mesh.name;
+
+    quantize_positions(model, mesh, output, &(*dequantization)[m], &mesh_report);
+
+    for (tinygltf::Primitive &primitive : mesh.primitives)
+    {
+      for (std::pair<const std::string, int> &attrib : primitive.attributes)
+      {
+        const std::string &semantic = attrib.first;
+        std::map<int, int>::iterator found = replaced.find(attrib.second);
+        if (found != replaced.end())
+        {
+          attrib.second = found->second;
+          continue;
+        }
+
+        int index = -1;
+        bool done = false;
+        if (semantic == "NORMAL")
+          done = quantize_normals(model, attrib.second, output, &index, &mesh_report);
+        else if (semantic.compare(0, 9, "TEXCOORD_") == 0)
+          done = quantize_texcoords(model, attrib.second, output, &index, &mesh_report);
+        else if (semantic.compare(0, 6, "COLOR_") == 0)
+          done = quantize_colors(model, attrib.second, output, &index, &mesh_report);
+        if (done)
+        {
+          replaced[attrib.second] = index;
+          replaced[index] = index;
+          attrib.second = index;
+        }
+      }
+    }
+
+    report.bytes_before += mesh_report.bytes_before;
+    report.bytes_after += mesh_report.bytes_after;
+    report.meshes.push_back(mesh_report);
+  }
+
+  tinygltf::Buffer &buffer = model.buffers[output.buffer];
+  if (buffer.data.empty())
+    model.buffers.pop_back();
+  else if (std::find(model.extensionsUsed.begin(), model.extensionsUsed.end(),
+                     "KHR_mesh_quantization") == model.extensionsUsed.end())
+    model.extensionsUsed.push_back("KHR_mesh_quantization");
+  return report;
+}
+} // namespace quantization
+
+#endif // QUANTIZATION_HPP
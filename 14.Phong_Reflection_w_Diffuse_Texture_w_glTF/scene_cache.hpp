@@ -0,0 +1,1343 @@
+#ifndef SCENE_CACHE_HPP
+#define SCENE_CACHE_HPP
+
+// 전처리된 scene 캐시 (원본 .gltf/.glb 옆의 "<파일 이름>.cache")
+//
+// glTF를 한 번 읽은 뒤 GPU에 올릴 형태로 저장해 두고, 다음 실행부터는 캐시 파일을
+// mmap해서 JSON 파싱이나 이미지 디코딩 없이 tinygltf::Model을 다시 채운다.
+//  - 정점 attribute는 model의 배치(vertex_layout.hpp)를 그대로 두고 stream 단위로 옮긴다.
+//    stride가 같은 stream끼리 한 bufferView에, 인덱스는 모두 한 bufferView에 모은다.
+//    두 종류 모두 하나의 blob에 들어 있고 Buffer::mapped가 캐시 파일을 가리킨다.
+//  - 이미지는 디코딩된 픽셀을 저장하고 Image::mapped가 캐시 파일을 가리킨다.
+//  - 평탄화된 노드 배열(SceneCacheNode), EXT_mesh_gpu_instancing의 instance 행렬
+//    (SceneCacheInstance), 양자화한 위치의 메쉬별 복원 변환(SceneCacheMesh), 노드/scene,
+//    material 파라미터(확장 제외), 텍스처, sampler, 카메라를 저장한다. 애니메이션/스킨은
+//    저장하지 않는다.
+//  - 정점/인덱스는 로드 옵션(mesh_optimizer.hpp 최적화 등)을 적용한 뒤의 데이터이므로,
+//    캐시를 만들 때와 옵션(SceneCacheOption)이 다르면 쓰지 않는다.
+// 원본 파일과 원본이 참조하는 외부 파일(.bin, 이미지)의 내용 해시가 하나라도 다르거나
+// SCENE_CACHE_VERSION이 다르면 캐시를 쓰지 않는다.
+//
+// tiny_gltf.h를 먼저 include해야 한다. (구현부가 중복 정의되지 않도록 여기서는 include하지 않는다)
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+// 캐시에 담는 내용이나 배치가 바뀌면 올린다.
+const uint32_t SCENE_CACHE_VERSION = 5;
+
+// 캐시에 저장된 데이터를 바꾸는 로드 옵션 (비트 조합)
+enum SceneCacheOption
+{
+  SCENE_CACHE_OPTIMIZED_MESHES = 1 << 0,       // 인덱스/정점 순서를 최적화했다.
+  SCENE_CACHE_QUANTIZED_ATTRIBUTES = 1 << 1,   // 정점 attribute를 양자화했다.
+  SCENE_CACHE_INTERLEAVED_ATTRIBUTES = 1 << 2, // 정점 attribute를 primitive마다 한 stream에 모았다.
+  SCENE_CACHE_PACKED_ATTRIBUTES = 1 << 3,      // 정점 attribute를 4바이트 정렬 없이 붙였다.
+};
+
+// 평탄화된 노드 하나 (main.cpp의 FlatScene 한 줄)
+struct SceneCacheNode
+{
+  int32_t node;
+  int32_t parent;
+  int32_t mesh;
+  float translation[3];
+  float rotation[4];
+  float scale[3];
+  float local[16]; // 열 우선(column major)
+};
+
+// EXT_mesh_gpu_instancing의 instance 하나 (노드 행렬 뒤에 곱하는 local 행렬)
+struct SceneCacheInstance
+{
+  int32_t node; // model.nodes 인덱스
+  float local[16]; // 열 우선(column major)
+};
+
+// 메쉬 하나의 위치 복원 변환 (quantized 위치 * scale + offset)
+struct SceneCacheMesh
+{
+  float offset[3];
+  float scale;
+};
+
+namespace scene_cache
+{
+////////////////////////////////////////////////////////////////////////////////
+/// 파일 배치: Header, 그 뒤에 16바이트 정렬된 섹션들
+////////////////////////////////////////////////////////////////////////////////
+const char magic[8] = {'G', 'L', 'T', 'F', 'C', 'A', 'C', 'H'};
+const uint32_t endian_tag = 0x01020304;
+const size_t alignment = 16;
+
+enum Section
+{
+  DEPENDENCIES,  // Dependency[], 0번은 원본 파일
+  STRINGS,       // char[]
+  NUMBERS,       // double[] (material 파라미터의 number_array)
+  NAMED_NUMBERS, // NamedNumber[] (material 파라미터의 json_double_value)
+  BLOB,          // 정점/인덱스 데이터
+  PIXELS,        // 디코딩된 이미지 픽셀
+  BUFFER_VIEWS,
+  ACCESSORS,
+  MESHES,
+  PRIMITIVES,
+  ATTRIBUTES,
+  MATERIALS,
+  PARAMETERS,
+  TEXTURES,
+  SAMPLERS,
+  IMAGES,
+  CAMERAS,
+  NODES,
+  NODE_CHILDREN, // int32_t[]
+  SCENES,
+  SCENE_NODES,   // int32_t[]
+  FLAT_NODES,    // SceneCacheNode[]
+  GPU_INSTANCES, // SceneCacheInstance[]
+  MESH_DEQUANTIZATION, // SceneCacheMesh[] (양자화하지 않았으면 비어 있다)
+  NUM_SECTIONS
+};
+
+struct SectionEntry
+{
+  uint64_t offset; // 파일 처음부터
+  uint64_t size;   // 바이트
+};
+
+struct Header
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t endian;
+  int32_t default_scene;
+  uint32_t options; // SceneCacheOption
+  SectionEntry sections[NUM_SECTIONS];
+};
+
+struct StringRef
+{
+  uint32_t offset;
+  uint32_t length;
+};
+
+struct Dependency
+{
+  StringRef path; // 원본 파일이 있는 디렉터리 기준 (0번은 원본 파일 이름)
+  uint64_t size;
+  uint64_t hash;
+};
+
+struct NamedNumber
+{
+  StringRef key;
+  uint32_t reserved;
+  double value;
+};
+
+struct BufferViewRecord
+{
+  uint64_t offset; // BLOB 기준
+  uint64_t length;
+  uint32_t stride;
+  uint32_t target;
+};
+
+struct AccessorRecord
+{
+  int32_t buffer_view;
+  int32_t component_type;
+  uint64_t byte_offset;
+  uint64_t count;
+  int32_t type;
+  uint32_t normalized;
+  uint32_t num_min;
+  uint32_t num_max;
+  double min[16];
+  double max[16];
+};
+
+struct MeshRecord
+{
+  uint32_t first_primitive;
+  uint32_t num_primitives;
+};
+
+struct PrimitiveRecord
+{
+  int32_t mode;
+  int32_t material;
+  int32_t indices;
+  uint32_t first_attribute;
+  uint32_t num_attributes;
+};
+
+struct AttributeRecord
+{
+  StringRef semantic;
+  int32_t accessor;
+};
+
+struct MaterialRecord
+{
+  StringRef name;
+  uint32_t first_parameter;
+  uint32_t num_parameters;
+};
+
+// tinygltf::Parameter 하나. additional이 0이면 Material::values, 1이면 additionalValues.
+struct ParameterRecord
+{
+  StringRef key;
+  uint32_t additional;
+  uint32_t bool_value;
+  uint32_t has_number_value;
+  uint32_t first_number;
+  uint32_t num_numbers;
+  uint32_t first_named_number;
+  uint32_t num_named_numbers;
+  StringRef string_value;
+  uint32_t reserved;
+  double number_value;
+};
+
+struct TextureRecord
+{
+  int32_t source;
+  int32_t sampler;
+};
+
+struct SamplerRecord
+{
+  int32_t min_filter;
+  int32_t mag_filter;
+  int32_t wrap_s;
+  int32_t wrap_t;
+};
+
+struct ImageRecord
+{
+  int32_t width;
+  int32_t height;
+  int32_t component;
+  int32_t bits;
+  int32_t pixel_type;
+  uint32_t levels; // 저장된 mip 레벨 수 (지금은 항상 1)
+  uint64_t pixels_offset; // PIXELS 기준
+  uint64_t pixels_size;
+  StringRef uri;
+  StringRef mime_type;
+};
+
+struct CameraRecord
+{
+  uint32_t orthographic;
+  uint32_t reserved;
+  double aspect_ratio;
+  double yfov;
+  double xmag;
+  double ymag;
+  double znear;
+  double zfar;
+};
+
+struct NodeRecord
+{
+  int32_t mesh;
+  int32_t camera;
+  int32_t skin;
+  uint32_t num_translation; // 0 또는 3
+  uint32_t num_rotation;    // 0 또는 4
+  uint32_t num_scale;       // 0 또는 3
+  uint32_t num_matrix;      // 0 또는 16
+  uint32_t first_child;
+  uint32_t num_children;
+  uint32_t reserved;
+  double translation[3];
+  double rotation[4];
+  double scale[3];
+  double matrix[16];
+};
+
+struct SceneRecord
+{
+  uint32_t first_node;
+  uint32_t num_nodes;
+};
+////////////////////////////////////////////////////////////////////////////////
+
+// 64비트 FNV-1a를 8바이트 단위로 적용한 내용 해시. 곱셈끼리 기다리지 않도록 32바이트씩
+// 네 갈래로 나누어 계산한 뒤 합친다. (바이트 단위 FNV-1a보다 훨씬 빠르다)
+inline uint64_t hash_bytes(const unsigned char *data, size_t size)
+{
+  const uint64_t prime = 1099511628211ull;
+  uint64_t lanes[4] = {14695981039346656037ull, 14695981039346656037ull ^ 1,
+                       14695981039346656037ull ^ 2, 14695981039346656037ull ^ 3};
+
+  size_t i = 0;
+  for (; i + 32 <= size; i += 32)
+  {
+    for (int k = 0; k < 4; ++k)
+    {
+      uint64_t word;
+      std::memcpy(&word, data + i + 8 * k, 8);
+      lanes[k] = (lanes[k] ^ word) * prime;
+      lanes[k] ^= lanes[k] >> 32;
+    }
+  }
+
+  uint64_t hash = 14695981039346656037ull;
+  for (int k = 0; k < 4; ++k)
+  {
+    hash = (hash ^ lanes[k]) * prime;
+    hash ^= hash >> 32;
+  }
+  for (; i < size; ++i)
+    hash = (hash ^ data[i]) * prime;
+
+  return (hash ^ size) * prime;
+}
+
+inline std::string directory_of(const std::string &path)
+{
+  size_t slash = path.find_last_of("/\\");
+  return slash == std::string::npos ? "" : path.substr(0, slash + 1);
+}
+
+inline bool is_data_uri(const std::string &uri)
+{
+  return uri.compare(0, 5, "data:") == 0;
+}
+
+const uint64_t missing_file_size = ~0ull;
+
+// 파일을 매핑해서 크기와 해시를 구한다. 파일이 없으면 missing_file_size로 표시한다.
+// (원본 로드 때 경고만 나고 빠진 이미지 등. 나중에 생기면 캐시를 다시 만든다)
+inline void hash_file(const std::string &path, uint64_t *size, uint64_t *hash)
+{
+  tinygltf::MappedFile file;
+  std::string err;
+  if (!tinygltf::MapWholeFile(&file, &err, path, nullptr))
+  {
+    *size = missing_file_size;
+    *hash = 0;
+    return;
+  }
+
+  *size = file.size;
+  *hash = hash_bytes(file.data, file.size);
+}
+
+// 캐시 파일에 쓸 섹션들을 모아 두는 곳
+struct Writer
+{
+  std::vector<char> strings;
+  std::vector<unsigned char> sections[NUM_SECTIONS];
+
+  StringRef add_string(const std::string &str)
+  {
+    StringRef ref = {static_cast<uint32_t>(strings.size()),
+                     static_cast<uint32_t>(str.size())};
+    strings.insert(strings.end(), str.begin(), str.end());
+    return ref;
+  }
+
+  template <typename T>
+  uint32_t add(Section section, const T &record)
+  {
+    std::vector<unsigned char> &bytes = sections[section];
+    uint32_t index = static_cast<uint32_t>(bytes.size() / sizeof(T));
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(&record);
+    bytes.insert(bytes.end(), p, p + sizeof(T));
+    return index;
+  }
+
+  template <typename T>
+  size_t count(Section section) const
+  {
+    return sections[section].size() / sizeof(T);
+  }
+
+  // 16바이트 정렬된 위치에 데이터를 붙이고 그 위치를 돌려준다.
+  uint64_t add_aligned(Section section, const unsigned char *data, size_t size)
+  {
+    std::vector<unsigned char> &bytes = sections[section];
+    bytes.resize((bytes.size() + alignment - 1) / alignment * alignment, 0);
+    uint64_t offset = bytes.size();
+    bytes.insert(bytes.end(), data, data + size);
+    return offset;
+  }
+};
+
+// 캐시 파일에서 읽은 섹션 하나를 T 배열로 본다.
+template <typename T>
+struct Array
+{
+  const T *data = nullptr;
+  size_t size = 0;
+
+  const T &operator[](size_t i) const { return data[i]; }
+  bool contains(uint64_t first, uint64_t count) const
+  {
+    return first <= size && count <= size - first;
+  }
+};
+
+struct Reader
+{
+  const unsigned char *base = nullptr;
+  const Header *header = nullptr;
+  Array<char> strings;
+
+  template <typename T>
+  Array<T> get(Section section) const
+  {
+    Array<T> array;
+    array.data = reinterpret_cast<const T *>(base + header->sections[section].offset);
+    array.size = header->sections[section].size / sizeof(T);
+    return array;
+  }
+
+  bool get_string(StringRef ref, std::string *str) const
+  {
+    if (!strings.contains(ref.offset, ref.length))
+      return false;
+    str->assign(strings.data + ref.offset, ref.length);
+    return true;
+  }
+};
+
+// 정점 attribute 하나를 stream으로 옮길 때의 정보
+struct StreamAttribute
+{
+  int accessor;
+  size_t offset; // 정점 안에서의 위치
+  size_t size;   // 원소 하나의 크기
+};
+
+// accessor의 i번째 원소. 범위를 벗어나면 nullptr.
+inline const unsigned char *element_at(const tinygltf::Model &model,
+                                       const tinygltf::Accessor &accessor,
+                                       size_t element_size, size_t i)
+{
+  const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
+  const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
+
+  int stride = accessor.ByteStride(bufferView);
+  if (stride <= 0)
+    return nullptr;
+
+  size_t offset = bufferView.byteOffset + accessor.byteOffset + i * size_t(stride);
+  if (offset + element_size > buffer.Size())
+    return nullptr;
+  return buffer.Data() + offset;
+}
+
+// accessor 원소 하나의 크기. 알 수 없는 타입이면 0.
+inline size_t element_size(const tinygltf::Accessor &accessor)
+{
+  int32_t component_size = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+  int32_t num_components = tinygltf::GetTypeSizeInBytes(accessor.type); // 성분 개수를 돌려준다.
+  if (component_size <= 0 || num_components <= 0)
+    return 0;
+  return size_t(component_size) * size_t(num_components);
+}
+
+// 원본 accessor를 새 bufferView/offset을 가리키는 accessor로 복사한다.
+inline uint32_t add_accessor(Writer &writer, const tinygltf::Accessor &accessor,
+                             int buffer_view, uint64_t byte_offset)
+{
+  AccessorRecord record;
+  std::memset(&record, 0, sizeof(record));
+  record.buffer_view = buffer_view;
+  record.component_type = accessor.componentType;
+  record.byte_offset = byte_offset;
+  record.count = accessor.count;
+  record.type = accessor.type;
+  record.normalized = accessor.normalized ? 1 : 0;
+  record.num_min = static_cast<uint32_t>(std::min<size_t>(accessor.minValues.size(), 16));
+  record.num_max = static_cast<uint32_t>(std::min<size_t>(accessor.maxValues.size(), 16));
+  for (uint32_t i = 0; i < record.num_min; ++i)
+    record.min[i] = accessor.minValues[i];
+  for (uint32_t i = 0; i < record.num_max; ++i)
+    record.max[i] = accessor.maxValues[i];
+  return writer.add(ACCESSORS, record);
+}
+
+// 원본 accessor가 속한 stream: (bufferView, stride, stride 단위로 내린 시작 위치)
+// interleaved된 attribute끼리는 같은 stream이 된다.
+struct StreamKey
+{
+  int buffer_view;
+  size_t stride;
+  size_t base;
+
+  bool operator<(const StreamKey &other) const
+  {
+    if (buffer_view != other.buffer_view)
+      return buffer_view < other.buffer_view;
+    if (stride != other.stride)
+      return stride < other.stride;
+    return base < other.base;
+  }
+};
+
+// 메쉬 데이터를 정점 blob과 인덱스 blob으로 옮겨 BLOB/BUFFER_VIEWS/ACCESSORS/MESHES/
+// PRIMITIVES/ATTRIBUTES 섹션을 채운다. 정점 stream 안의 attribute 배치와 stride는 그대로다.
+inline bool write_geometry(Writer &writer, const tinygltf::Model &model, std::string *err)
+{
+  // stride별 정점 데이터, 그리고 모든 인덱스 데이터
+  std::map<size_t, std::vector<unsigned char>> vertex_data;
+  std::vector<unsigned char> index_data;
+
+  // 아직 bufferView가 정해지지 않았으므로 accessor는 (stride, 0이면 인덱스)와
+  // 데이터 안의 위치만 기억해 두었다가 마지막에 만든다.
+  struct PendingAccessor
+  {
+    int source;
+    size_t stride; // 0이면 인덱스
+    size_t offset;
+  };
+  std::vector<PendingAccessor> pending;
+
+  // primitive가 쓰는 정점 accessor를 stream별로 모은다.
+  std::map<StreamKey, std::vector<StreamAttribute>> streams;
+  std::map<int, uint32_t> vertex_accessors; // 원본 -> 새 accessor
+  for (const tinygltf::Mesh &mesh : model.meshes)
+  {
+    for (const tinygltf::Primitive &primitive : mesh.primitives)
+    {
+      for (const std::pair<const std::string, int> &attrib : primitive.attributes)
+      {
+        if (attrib.second < 0 || size_t(attrib.second) >= model.accessors.size())
+        {
+          *err = "invalid accessor in primitive attribute " + attrib.first;
+          return false;
+        }
+        const tinygltf::Accessor &accessor = model.accessors[attrib.second];
+        if (accessor.bufferView < 0 || accessor.sparse.isSparse)
+        {
+          *err = "sparse accessors or accessors without bufferView are not cached";
+          return false;
+        }
+        if (!vertex_accessors.insert(std::make_pair(attrib.second, 0)).second)
+          continue;
+
+        size_t size = element_size(accessor);
+        int stride = accessor.ByteStride(model.bufferViews[accessor.bufferView]);
+        if (size == 0 || stride <= 0)
+        {
+          *err = "unknown accessor type";
+          return false;
+        }
+        StreamKey key = {accessor.bufferView, size_t(stride),
+                         accessor.byteOffset - accessor.byteOffset % size_t(stride)};
+        StreamAttribute attribute = {attrib.second, accessor.byteOffset - key.base, size};
+        if (attribute.offset + attribute.size > key.stride)
+        {
+          *err = "vertex attribute crosses the byteStride of its bufferView";
+          return false;
+        }
+        streams[key].push_back(attribute);
+      }
+    }
+  }
+
+  for (const std::pair<const StreamKey, std::vector<StreamAttribute>> &stream : streams)
+  {
+    const size_t stride = stream.first.stride;
+    size_t count = 0;
+    for (const StreamAttribute &attribute : stream.second)
+      count = std::max(count, model.accessors[attribute.accessor].count);
+
+    std::vector<unsigned char> &data = vertex_data[stride];
+    size_t base = data.size();
+    data.resize(base + stride * count, 0);
+    for (const StreamAttribute &attribute : stream.second)
+    {
+      const tinygltf::Accessor &accessor = model.accessors[attribute.accessor];
+      for (size_t i = 0; i < accessor.count; ++i)
+      {
+        const unsigned char *src = element_at(model, accessor, attribute.size, i);
+        if (!src)
+        {
+          *err = "accessor data out of buffer range";
+          return false;
+        }
+        std::memcpy(&data[base + i * stride + attribute.offset], src, attribute.size);
+      }
+
+      PendingAccessor pending_accessor = {attribute.accessor, stride, base + attribute.offset};
+      vertex_accessors[attribute.accessor] = static_cast<uint32_t>(pending.size());
+      pending.push_back(pending_accessor);
+    }
+  }
+
+  std::map<int, uint32_t> index_accessors; // 원본 -> 새 accessor
+
+  std::vector<PrimitiveRecord> primitives;
+  std::vector<AttributeRecord> attributes;
+
+  for (const tinygltf::Mesh &mesh : model.meshes)
+  {
+    MeshRecord mesh_record = {static_cast<uint32_t>(primitives.size()),
+                              static_cast<uint32_t>(mesh.primitives.size())};
+    writer.add(MESHES, mesh_record);
+
+    for (const tinygltf::Primitive &primitive : mesh.primitives)
+    {
+      PrimitiveRecord record;
+      record.mode = primitive.mode;
+      record.material = primitive.material;
+      record.indices = -1;
+      record.first_attribute = static_cast<uint32_t>(attributes.size());
+      record.num_attributes = static_cast<uint32_t>(primitive.attributes.size());
+
+      for (const std::pair<const std::string, int> &attrib : primitive.attributes)
+      {
+        AttributeRecord attribute = {writer.add_string(attrib.first),
+                                     static_cast<int32_t>(vertex_accessors[attrib.second])};
+        attributes.push_back(attribute);
+      }
+
+      if (primitive.indices > -1)
+      {
+        if (size_t(primitive.indices) >= model.accessors.size())
+        {
+          *err = "invalid index accessor";
+          return false;
+        }
+
+        std::map<int, uint32_t>::iterator found = index_accessors.find(primitive.indices);
+        if (found == index_accessors.end())
+        {
+          const tinygltf::Accessor &accessor = model.accessors[primitive.indices];
+          if (accessor.bufferView < 0 || accessor.sparse.isSparse)
+          {
+            *err = "sparse index accessors are not cached";
+            return false;
+          }
+
+          size_t size = element_size(accessor);
+          if (size == 0)
+          {
+            *err = "unknown index accessor type";
+            return false;
+          }
+          size_t base = (index_data.size() + 3) / 4 * 4;
+          index_data.resize(base + size * accessor.count, 0);
+          for (size_t i = 0; i < accessor.count; ++i)
+          {
+            const unsigned char *src = element_at(model, accessor, size, i);
+            if (!src)
+            {
+              *err = "index data out of buffer range";
+              return false;
+            }
+            std::memcpy(&index_data[base + i * size], src, size);
+          }
+
+          PendingAccessor pending_accessor = {primitive.indices, 0, base};
+          found = index_accessors.insert(
+              std::make_pair(primitive.indices, static_cast<uint32_t>(pending.size()))).first;
+          pending.push_back(pending_accessor);
+        }
+        record.indices = static_cast<int32_t>(found->second);
+      }
+
+      primitives.push_back(record);
+    }
+  }
+
+  // bufferView: stride별 정점 데이터 하나씩, 마지막에 인덱스 데이터 하나
+  std::map<size_t, int> vertex_views;
+  for (const std::pair<const size_t, std::vector<unsigned char>> &data : vertex_data)
+  {
+    BufferViewRecord view;
+    view.offset = writer.add_aligned(BLOB, data.second.data(), data.second.size());
+    view.length = data.second.size();
+    view.stride = static_cast<uint32_t>(data.first);
+    view.target = TINYGLTF_TARGET_ARRAY_BUFFER;
+    vertex_views[data.first] = static_cast<int>(writer.add(BUFFER_VIEWS, view));
+  }
+
+  int index_view = -1;
+  if (!index_data.empty())
+  {
+    BufferViewRecord view;
+    view.offset = writer.add_aligned(BLOB, index_data.data(), index_data.size());
+    view.length = index_data.size();
+    view.stride = 0;
+    view.target = TINYGLTF_TARGET_ELEMENT_ARRAY_BUFFER;
+    index_view = static_cast<int>(writer.add(BUFFER_VIEWS, view));
+  }
+
+  for (const PendingAccessor &accessor : pending)
+  {
+    int view = accessor.stride != 0 ? vertex_views[accessor.stride] : index_view;
+    add_accessor(writer, model.accessors[accessor.source], view, accessor.offset);
+  }
+
+  for (const PrimitiveRecord &primitive : primitives)
+    writer.add(PRIMITIVES, primitive);
+  for (const AttributeRecord &attribute : attributes)
+    writer.add(ATTRIBUTES, attribute);
+
+  return true;
+}
+
+inline void write_parameters(Writer &writer, const tinygltf::ParameterMap &parameters,
+                             uint32_t additional)
+{
+  for (const std::pair<const std::string, tinygltf::Parameter> &parameter : parameters)
+  {
+    const tinygltf::Parameter &value = parameter.second;
+
+    ParameterRecord record;
+    std::memset(&record, 0, sizeof(record));
+    record.key = writer.add_string(parameter.first);
+    record.additional = additional;
+    record.bool_value = value.bool_value ? 1 : 0;
+    record.has_number_value = value.has_number_value ? 1 : 0;
+    record.number_value = value.number_value;
+    record.string_value = writer.add_string(value.string_value);
+
+    record.first_number = static_cast<uint32_t>(writer.count<double>(NUMBERS));
+    record.num_numbers = static_cast<uint32_t>(value.number_array.size());
+    for (double number : value.number_array)
+      writer.add(NUMBERS, number);
+
+    record.first_named_number = static_cast<uint32_t>(writer.count<NamedNumber>(NAMED_NUMBERS));
+    record.num_named_numbers = static_cast<uint32_t>(value.json_double_value.size());
+    for (const std::pair<const std::string, double> &named : value.json_double_value)
+    {
+      NamedNumber number = {writer.add_string(named.first), 0, named.second};
+      writer.add(NAMED_NUMBERS, number);
+    }
+
+    writer.add(PARAMETERS, record);
+  }
+}
+
+inline void write_scene_records(Writer &writer, const tinygltf::Model &model)
+{
+  for (const tinygltf::Material &material : model.materials)
+  {
+    MaterialRecord record;
+    record.name = writer.add_string(material.name);
+    record.first_parameter = static_cast<uint32_t>(writer.count<ParameterRecord>(PARAMETERS));
+    record.num_parameters = static_cast<uint32_t>(material.values.size() +
+                                                  material.additionalValues.size());
+    writer.add(MATERIALS, record);
+
+    write_parameters(writer, material.values, 0);
+    write_parameters(writer, material.additionalValues, 1);
+  }
+
+  for (const tinygltf::Texture &texture : model.textures)
+  {
+    TextureRecord record = {texture.source, texture.sampler};
+    writer.add(TEXTURES, record);
+  }
+
+  for (const tinygltf::Sampler &sampler : model.samplers)
+  {
+    SamplerRecord record = {sampler.minFilter, sampler.magFilter, sampler.wrapS, sampler.wrapT};
+    writer.add(SAMPLERS, record);
+  }
+
+  for (const tinygltf::Image &image : model.images)
+  {
+    ImageRecord record;
+    std::memset(&record, 0, sizeof(record));
+    record.width = image.width;
+    record.height = image.height;
+    record.component = image.component;
+    record.bits = image.bits;
+    record.pixel_type = image.pixel_type;
+    record.levels = 1;
+    record.pixels_offset = writer.add_aligned(PIXELS, image.Pixels(), image.PixelsSize());
+    record.pixels_size = image.PixelsSize();
+    record.uri = writer.add_string(is_data_uri(image.uri) ? "" : image.uri);
+    record.mime_type = writer.add_string(image.mimeType);
+    writer.add(IMAGES, record);
+  }
+
+  for (const tinygltf::Camera &camera : model.cameras)
+  {
+    CameraRecord record;
+    std::memset(&record, 0, sizeof(record));
+    record.orthographic = camera.type.compare("orthographic") == 0 ? 1 : 0;
+    record.aspect_ratio = camera.perspective.aspectRatio;
+    record.yfov = camera.perspective.yfov;
+    record.xmag = camera.orthographic.xmag;
+    record.ymag = camera.orthographic.ymag;
+    record.znear = record.orthographic ? camera.orthographic.znear : camera.perspective.znear;
+    record.zfar = record.orthographic ? camera.orthographic.zfar : camera.perspective.zfar;
+    writer.add(CAMERAS, record);
+  }
+
+  for (const tinygltf::Node &node : model.nodes)
+  {
+    NodeRecord record;
+    std::memset(&record, 0, sizeof(record));
+    record.mesh = node.mesh;
+    record.camera = node.camera;
+    record.skin = node.skin;
+    record.num_translation = node.translation.size() == 3 ? 3 : 0;
+    record.num_rotation = node.rotation.size() == 4 ? 4 : 0;
+    record.num_scale = node.scale.size() == 3 ? 3 : 0;
+    record.num_matrix = node.matrix.size() == 16 ? 16 : 0;
+    for (uint32_t i = 0; i < record.num_translation; ++i)
+      record.translation[i] = node.translation[i];
+    for (uint32_t i = 0; i < record.num_rotation; ++i)
+      record.rotation[i] = node.rotation[i];
+    for (uint32_t i = 0; i < record.num_scale; ++i)
+      record.scale[i] = node.scale[i];
+    for (uint32_t i = 0; i < record.num_matrix; ++i)
+      record.matrix[i] = node.matrix[i];
+
+    record.first_child = static_cast<uint32_t>(writer.count<int32_t>(NODE_CHILDREN));
+    record.num_children = static_cast<uint32_t>(node.children.size());
+    for (int child : node.children)
+      writer.add(NODE_CHILDREN, static_cast<int32_t>(child));
+
+    writer.add(NODES, record);
+  }
+
+  for (const tinygltf::Scene &scene : model.scenes)
+  {
+    SceneRecord record = {static_cast<uint32_t>(writer.count<int32_t>(SCENE_NODES)),
+                          static_cast<uint32_t>(scene.nodes.size())};
+    for (int node : scene.nodes)
+      writer.add(SCENE_NODES, static_cast<int32_t>(node));
+    writer.add(SCENES, record);
+  }
+}
+
+// 캐시의 레코드가 가리키는 인덱스와 바이트 범위가 모두 범위 안에 있는지 확인한다.
+// 하나라도 어긋나면 캐시를 쓰지 않고 원본을 다시 읽는다. (read_model()은 검사하지 않는다)
+inline bool check_records(const Reader &reader)
+{
+  Array<BufferViewRecord> views = reader.get<BufferViewRecord>(BUFFER_VIEWS);
+  Array<AccessorRecord> accessors = reader.get<AccessorRecord>(ACCESSORS);
+  Array<MeshRecord> meshes = reader.get<MeshRecord>(MESHES);
+  Array<PrimitiveRecord> primitives = reader.get<PrimitiveRecord>(PRIMITIVES);
+  Array<AttributeRecord> attributes = reader.get<AttributeRecord>(ATTRIBUTES);
+  Array<MaterialRecord> materials = reader.get<MaterialRecord>(MATERIALS);
+  Array<ParameterRecord> parameters = reader.get<ParameterRecord>(PARAMETERS);
+  Array<ImageRecord> images = reader.get<ImageRecord>(IMAGES);
+  Array<NodeRecord> nodes = reader.get<NodeRecord>(NODES);
+  Array<SceneRecord> scenes = reader.get<SceneRecord>(SCENES);
+  uint64_t blob_size = reader.header->sections[BLOB].size;
+  uint64_t pixels_size = reader.header->sections[PIXELS].size;
+
+  for (size_t i = 0; i < views.size; ++i)
+  {
+    if (views[i].offset > blob_size || views[i].length > blob_size - views[i].offset)
+      return false;
+  }
+  for (size_t i = 0; i < accessors.size; ++i)
+  {
+    const AccessorRecord &accessor = accessors[i];
+    if (accessor.buffer_view < 0 || size_t(accessor.buffer_view) >= views.size ||
+        accessor.num_min > 16 || accessor.num_max > 16)
+      return false;
+    if (accessor.count == 0)
+      continue;
+
+    // byteOffset + (count - 1) * stride + 원소 크기가 bufferView 안이어야 한다.
+    // (bufferView가 BLOB 안에 있는지는 위에서 봤다)
+    int32_t component_size = tinygltf::GetComponentSizeInBytes(accessor.component_type);
+    int32_t num_components = tinygltf::GetTypeSizeInBytes(accessor.type); // 성분 개수를 돌려준다.
+    if (component_size <= 0 || num_components <= 0)
+      return false;
+    const BufferViewRecord &view = views[accessor.buffer_view];
+    uint64_t element = uint64_t(component_size) * uint64_t(num_components);
+    uint64_t stride = view.stride != 0 ? view.stride : element;
+    if (accessor.byte_offset > view.length || element > view.length - accessor.byte_offset ||
+        accessor.count - 1 > (view.length - accessor.byte_offset - element) / stride)
+      return false;
+  }
+  for (size_t i = 0; i < meshes.size; ++i)
+  {
+    if (!primitives.contains(meshes[i].first_primitive, meshes[i].num_primitives))
+      return false;
+  }
+  for (size_t i = 0; i < primitives.size; ++i)
+  {
+    if (!attributes.contains(primitives[i].first_attribute, primitives[i].num_attributes) ||
+        (primitives[i].indices >= 0 && size_t(primitives[i].indices) >= accessors.size))
+      return false;
+  }
+  for (size_t i = 0; i < attributes.size; ++i)
+  {
+    if (attributes[i].accessor < 0 || size_t(attributes[i].accessor) >= accessors.size)
+      return false;
+  }
+  for (size_t i = 0; i < materials.size; ++i)
+  {
+    if (!parameters.contains(materials[i].first_parameter, materials[i].num_parameters))
+      return false;
+  }
+  for (size_t i = 0; i < parameters.size; ++i)
+  {
+    if (!reader.get<double>(NUMBERS).contains(parameters[i].first_number,
+                                              parameters[i].num_numbers) ||
+        !reader.get<NamedNumber>(NAMED_NUMBERS).contains(parameters[i].first_named_number,
+                                                         parameters[i].num_named_numbers))
+      return false;
+  }
+  for (size_t i = 0; i < images.size; ++i)
+  {
+    const ImageRecord &image = images[i];
+    if (image.pixels_offset > pixels_size || image.pixels_size > pixels_size - image.pixels_offset)
+      return false;
+    if (image.pixels_size == 0) // 디코딩하지 못한 이미지
+      continue;
+
+    // 텍스처를 올릴 때 width * height * component * (bits / 8) 바이트를 읽는다.
+    if (image.width <= 0 || image.height <= 0 || image.component <= 0 || image.component > 4 ||
+        (image.bits != 8 && image.bits != 16))
+      return false;
+    if (uint64_t(image.width) * uint64_t(image.height) * uint64_t(image.component) *
+            uint64_t(image.bits / 8) != image.pixels_size)
+      return false;
+  }
+  for (size_t i = 0; i < nodes.size; ++i)
+  {
+    if (!reader.get<int32_t>(NODE_CHILDREN).contains(nodes[i].first_child, nodes[i].num_children) ||
+        nodes[i].num_translation > 3 || nodes[i].num_rotation > 4 ||
+        nodes[i].num_scale > 3 || nodes[i].num_matrix > 16)
+      return false;
+  }
+  for (size_t i = 0; i < scenes.size; ++i)
+  {
+    if (!reader.get<int32_t>(SCENE_NODES).contains(scenes[i].first_node, scenes[i].num_nodes))
+      return false;
+  }
+
+  // 평탄화된 노드는 부모가 항상 앞에 있다.
+  Array<SceneCacheNode> flat_nodes = reader.get<SceneCacheNode>(FLAT_NODES);
+  for (size_t i = 0; i < flat_nodes.size; ++i)
+  {
+    if (flat_nodes[i].parent >= int64_t(i) ||
+        flat_nodes[i].mesh >= int64_t(meshes.size) ||
+        flat_nodes[i].node < 0 || size_t(flat_nodes[i].node) >= nodes.size)
+      return false;
+  }
+
+  Array<SceneCacheInstance> instances = reader.get<SceneCacheInstance>(GPU_INSTANCES);
+  for (size_t i = 0; i < instances.size; ++i)
+  {
+    if (instances[i].node < 0 || size_t(instances[i].node) >= nodes.size)
+      return false;
+  }
+
+  Array<SceneCacheMesh> dequantization = reader.get<SceneCacheMesh>(MESH_DEQUANTIZATION);
+  if (dequantization.size != 0 && dequantization.size != meshes.size)
+    return false;
+  return true;
+}
+
+inline void read_parameter(const Reader &reader, const ParameterRecord &record,
+                           tinygltf::Parameter *parameter)
+{
+  Array<double> numbers = reader.get<double>(NUMBERS);
+  Array<NamedNumber> named_numbers = reader.get<NamedNumber>(NAMED_NUMBERS);
+
+  parameter->bool_value = record.bool_value != 0;
+  parameter->has_number_value = record.has_number_value != 0;
+  parameter->number_value = record.number_value;
+  reader.get_string(record.string_value, &parameter->string_value);
+  parameter->number_array.assign(numbers.data + record.first_number,
+                                 numbers.data + record.first_number + record.num_numbers);
+  for (uint32_t i = 0; i < record.num_named_numbers; ++i)
+  {
+    const NamedNumber &named = named_numbers[record.first_named_number + i];
+    std::string key;
+    reader.get_string(named.key, &key);
+    parameter->json_double_value[key] = named.value;
+  }
+}
+
+// 검증이 끝난 캐시로 Model을 채운다. 정점/픽셀 데이터는 복사하지 않고 `file`을 가리킨다.
+inline void read_model(const Reader &reader, const tinygltf::MappedFile &file,
+                       tinygltf::Model *model)
+{
+  *model = tinygltf::Model();
+  model->asset.version = "2.0";
+  model->defaultScene = reader.header->default_scene;
+
+  tinygltf::Buffer buffer;
+  buffer.mapped = file;
+  buffer.mapped.data = reader.base + reader.header->sections[BLOB].offset;
+  buffer.mapped.size = reader.header->sections[BLOB].size;
+  model->buffers.push_back(buffer);
+
+  Array<BufferViewRecord> views = reader.get<BufferViewRecord>(BUFFER_VIEWS);
+  model->bufferViews.resize(views.size);
+  for (size_t i = 0; i < views.size; ++i)
+  {
+    tinygltf::BufferView &view = model->bufferViews[i];
+    view.buffer = 0;
+    view.byteOffset = views[i].offset;
+    view.byteLength = views[i].length;
+    view.byteStride = views[i].stride;
+    view.target = static_cast<int>(views[i].target);
+  }
+
+  Array<AccessorRecord> accessors = reader.get<AccessorRecord>(ACCESSORS);
+  model->accessors.resize(accessors.size);
+  for (size_t i = 0; i < accessors.size; ++i)
+  {
+    const AccessorRecord &record = accessors[i];
+    tinygltf::Accessor &accessor = model->accessors[i];
+    accessor.bufferView = record.buffer_view;
+    accessor.componentType = record.component_type;
+    accessor.byteOffset = record.byte_offset;
+    accessor.count = record.count;
+    accessor.type = record.type;
+    accessor.normalized = record.normalized != 0;
+    accessor.minValues.assign(record.min, record.min + record.num_min);
+    accessor.maxValues.assign(record.max, record.max + record.num_max);
+  }
+
+  Array<MeshRecord> meshes = reader.get<MeshRecord>(MESHES);
+  Array<PrimitiveRecord> primitives = reader.get<PrimitiveRecord>(PRIMITIVES);
+  Array<AttributeRecord> attributes = reader.get<AttributeRecord>(ATTRIBUTES);
+  model->meshes.resize(meshes.size);
+  for (size_t i = 0; i < meshes.size; ++i)
+  {
+    tinygltf::Mesh &mesh = model->meshes[i];
+    mesh.primitives.resize(meshes[i].num_primitives);
+    for (uint32_t j = 0; j < meshes[i].num_primitives; ++j)
+    {
+      const PrimitiveRecord &record = primitives[meshes[i].first_primitive + j];
+      tinygltf::Primitive &primitive = mesh.primitives[j];
+      primitive.mode = record.mode;
+      primitive.material = record.material;
+      primitive.indices = record.indices;
+      for (uint32_t k = 0; k < record.num_attributes; ++k)
+      {
+        const AttributeRecord &attribute = attributes[record.first_attribute + k];
+        std::string semantic;
+        reader.get_string(attribute.semantic, &semantic);
+        primitive.attributes[semantic] = attribute.accessor;
+      }
+    }
+  }
+
+  Array<MaterialRecord> materials = reader.get<MaterialRecord>(MATERIALS);
+  Array<ParameterRecord> parameters = reader.get<ParameterRecord>(PARAMETERS);
+  model->materials.resize(materials.size);
+  for (size_t i = 0; i < materials.size; ++i)
+  {
+    tinygltf::Material &material = model->materials[i];
+    reader.get_string(materials[i].name, &material.name);
+    for (uint32_t j = 0; j < materials[i].num_parameters; ++j)
+    {
+      const ParameterRecord &record = parameters[materials[i].first_parameter + j];
+      std::string key;
+      reader.get_string(record.key, &key);
+      tinygltf::ParameterMap &values =
+          record.additional ? material.additionalValues : material.values;
+      read_parameter(reader, record, &values[key]);
+    }
+  }
+
+  Array<TextureRecord> textures = reader.get<TextureRecord>(TEXTURES);
+  model->textures.resize(textures.size);
+  for (size_t i = 0; i < textures.size; ++i)
+  {
+    model->textures[i].source = textures[i].source;
+    model->textures[i].sampler = textures[i].sampler;
+  }
+
+  Array<SamplerRecord> samplers = reader.get<SamplerRecord>(SAMPLERS);
+  model->samplers.resize(samplers.size);
+  for (size_t i = 0; i < samplers.size; ++i)
+  {
+    model->samplers[i].minFilter = samplers[i].min_filter;
+    model->samplers[i].magFilter = samplers[i].mag_filter;
+    model->samplers[i].wrapS = samplers[i].wrap_s;
+    model->samplers[i].wrapT = samplers[i].wrap_t;
+  }
+
+  Array<ImageRecord> images = reader.get<ImageRecord>(IMAGES);
+  model->images.resize(images.size);
+  for (size_t i = 0; i < images.size; ++i)
+  {
+    const ImageRecord &record = images[i];
+    tinygltf::Image &image = model->images[i];
+    image.width = record.width;
+    image.height = record.height;
+    image.component = record.component;
+    image.bits = record.bits;
+    image.pixel_type = record.pixel_type;
+    reader.get_string(record.uri, &image.uri);
+    reader.get_string(record.mime_type, &image.mimeType);
+    image.mapped = file;
+    image.mapped.data = reader.base + reader.header->sections[PIXELS].offset + record.pixels_offset;
+    image.mapped.size = record.pixels_size;
+  }
+
+  Array<CameraRecord> cameras = reader.get<CameraRecord>(CAMERAS);
+  model->cameras.resize(cameras.size);
+  for (size_t i = 0; i < cameras.size; ++i)
+  {
+    const CameraRecord &record = cameras[i];
+    tinygltf::Camera &camera = model->cameras[i];
+    if (record.orthographic)
+    {
+      camera.type = "orthographic";
+      camera.orthographic.xmag = record.xmag;
+      camera.orthographic.ymag = record.ymag;
+      camera.orthographic.znear = record.znear;
+      camera.orthographic.zfar = record.zfar;
+    }
+    else
+    {
+      camera.type = "perspective";
+      camera.perspective.aspectRatio = record.aspect_ratio;
+      camera.perspective.yfov = record.yfov;
+      camera.perspective.znear = record.znear;
+      camera.perspective.zfar = record.zfar;
+    }
+  }
+
+  Array<NodeRecord> nodes = reader.get<NodeRecord>(NODES);
+  Array<int32_t> children = reader.get<int32_t>(NODE_CHILDREN);
+  model->nodes.resize(nodes.size);
+  for (size_t i = 0; i < nodes.size; ++i)
+  {
+    const NodeRecord &record = nodes[i];
+    tinygltf::Node &node = model->nodes[i];
+    node.mesh = record.mesh;
+    node.camera = record.camera;
+    node.skin = record.skin;
+    node.translation.assign(record.translation, record.translation + record.num_translation);
+    node.rotation.assign(record.rotation, record.rotation + record.num_rotation);
+    node.scale.assign(record.scale, record.scale + record.num_scale);
+    node.matrix.assign(record.matrix, record.matrix + record.num_matrix);
+    node.children.assign(children.data + record.first_child,
+                         children.data + record.first_child + record.num_children);
+  }
+
+  Array<SceneRecord> scenes = reader.get<SceneRecord>(SCENES);
+  Array<int32_t> scene_nodes = reader.get<int32_t>(SCENE_NODES);
+  model->scenes.resize(scenes.size);
+  for (size_t i = 0; i < scenes.size; ++i)
+  {
+    model->scenes[i].nodes.assign(scene_nodes.data + scenes[i].first_node,
+                                  scene_nodes.data + scenes[i].first_node + scenes[i].num_nodes);
+  }
+}
+} // namespace scene_cache
+
+// 원본(`source_path`)에서 읽은 model과 평탄화된 노드를 캐시 파일로 저장한다.
+// `options`는 model에 적용한 로드 옵션(SceneCacheOption)이다.
+inline bool save_scene_cache(const std::string &cache_path, const std::string &source_path,
+                             const tinygltf::Model &model,
+                             const std::vector<SceneCacheNode> &flat_nodes,
+                             const std::vector<SceneCacheInstance> &instances,
+                             const std::vector<SceneCacheMesh> &meshes,
+                             uint32_t options, std::string *err)
+{
+  using namespace scene_cache;
+
+  Writer writer;
+
+  // 원본 파일과 외부 파일의 내용 해시
+  std::string source_dir = directory_of(source_path);
+  std::vector<std::string> dependencies(1, source_path.substr(source_dir.size()));
+  for (const tinygltf::Buffer &buffer : model.buffers)
+  {
+    if (!buffer.uri.empty() && !is_data_uri(buffer.uri))
+      dependencies.push_back(buffer.uri);
+  }
+  for (const tinygltf::Image &image : model.images)
+  {
+    if (!image.uri.empty() && !is_data_uri(image.uri))
+      dependencies.push_back(image.uri);
+  }
+  for (const std::string &path : dependencies)
+  {
+    Dependency dependency;
+    dependency.path = writer.add_string(path);
+    hash_file(source_dir + path, &dependency.size, &dependency.hash);
+    writer.add(DEPENDENCIES, dependency);
+  }
+
+  if (!write_geometry(writer, model, err))
+    return false;
+  write_scene_records(writer, model);
+
+  for (const SceneCacheNode &node : flat_nodes)
+    writer.add(FLAT_NODES, node);
+  for (const SceneCacheInstance &instance : instances)
+    writer.add(GPU_INSTANCES, instance);
+  for (const SceneCacheMesh &mesh : meshes)
+    writer.add(MESH_DEQUANTIZATION, mesh);
+
+  writer.sections[STRINGS].assign(writer.strings.begin(), writer.strings.end());
+
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, magic, sizeof(magic));
+  header.version = SCENE_CACHE_VERSION;
+  header.endian = endian_tag;
+  header.default_scene = model.defaultScene;
+  header.options = options;
+
+  uint64_t offset = (sizeof(Header) + alignment - 1) / alignment * alignment;
+  for (int i = 0; i < NUM_SECTIONS; ++i)
+  {
+    header.sections[i].offset = offset;
+    header.sections[i].size = writer.sections[i].size();
+    offset = (offset + writer.sections[i].size() + alignment - 1) / alignment * alignment;
+  }
+
+  // 다 쓴 뒤에 이름을 바꿔서, 쓰다 만 캐시 파일이 남지 않게 한다.
+  std::string temp_path = cache_path + ".tmp";
+  {
+    std::ofstream file(temp_path.c_str(), std::ofstream::binary | std::ofstream::trunc);
+    if (!file)
+    {
+      *err = "cannot write " + temp_path;
+      return false;
+    }
+
+    const char zeros[alignment] = {0};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    uint64_t written = sizeof(header);
+    for (int i = 0; i < NUM_SECTIONS; ++i)
+    {
+      file.write(zeros, header.sections[i].offset - written);
+      file.write(reinterpret_cast<const char *>(writer.sections[i].data()),
+                 writer.sections[i].size());
+      written = header.sections[i].offset + header.sections[i].size;
+    }
+
+    if (!file)
+    {
+      *err = "cannot write " + temp_path;
+      std::remove(temp_path.c_str());
+      return false;
+    }
+  }
+
+  if (std::rename(temp_path.c_str(), cache_path.c_str()) != 0)
+  {
+    *err = "cannot rename " + temp_path + " to " + cache_path;
+    std::remove(temp_path.c_str());
+    return false;
+  }
+  return true;
+}
+
+// 캐시가 있고 원본과 내용, 로드 옵션이 같으면 model과 평탄화된 노드를 채우고 true.
+// 캐시를 쓸 수 없으면 false이고, 그 이유를 `err`에 남긴다.
+inline bool load_scene_cache(const std::string &cache_path, const std::string &source_path,
+                             uint32_t options, tinygltf::Model *model,
+                             std::vector<SceneCacheNode> *flat_nodes,
+                             std::vector<SceneCacheInstance> *instances,
+                             std::vector<SceneCacheMesh> *meshes,
+                             std::string *err)
+{
+  using namespace scene_cache;
+
+  tinygltf::MappedFile file;
+  std::string map_err;
+  if (!tinygltf::MapWholeFile(&file, &map_err, cache_path, nullptr))
+  {
+    *err = "no cache file";
+    return false;
+  }
+
+  Reader reader;
+  reader.base = file.data;
+  reader.header = reinterpret_cast<const Header *>(file.data);
+  if (file.size < sizeof(Header) ||
+      std::memcmp(reader.header->magic, magic, sizeof(magic)) != 0 ||
+      reader.header->endian != endian_tag)
+  {
+    *err = "not a scene cache";
+    return false;
+  }
+  if (reader.header->version != SCENE_CACHE_VERSION)
+  {
+    *err = "cache version differs";
+    return false;
+  }
+  if (reader.header->options != options)
+  {
+    *err = "cache was built with different load options";
+    return false;
+  }
+
+  for (int i = 0; i < NUM_SECTIONS; ++i)
+  {
+    const SectionEntry &section = reader.header->sections[i];
+    if (section.offset % alignment != 0 || section.offset > file.size ||
+        section.size > file.size - section.offset)
+    {
+      *err = "truncated cache file";
+      return false;
+    }
+  }
+  reader.strings = reader.get<char>(STRINGS);
+
+  // 원본과 외부 파일이 캐시를 만들 때와 같은지 확인한다.
+  std::string source_dir = directory_of(source_path);
+  Array<Dependency> dependencies = reader.get<Dependency>(DEPENDENCIES);
+  for (size_t i = 0; i < dependencies.size; ++i)
+  {
+    std::string path;
+    if (!reader.get_string(dependencies[i].path, &path))
+    {
+      *err = "corrupted cache file";
+      return false;
+    }
+    if (i == 0)
+      path = source_path.substr(source_dir.size());
+
+    uint64_t size = 0;
+    uint64_t hash = 0;
+    hash_file(source_dir + path, &size, &hash);
+    if (size != dependencies[i].size || hash != dependencies[i].hash)
+    {
+      *err = path + " has changed";
+      return false;
+    }
+  }
+  if (dependencies.size == 0)
+  {
+    *err = "corrupted cache file";
+    return false;
+  }
+
+  if (!check_records(reader))
+  {
+    *err = "corrupted cache file";
+    return false;
+  }
+
+  read_model(reader, file, model);
+
+  Array<SceneCacheNode> nodes = reader.get<SceneCacheNode>(FLAT_NODES);
+  flat_nodes->assign(nodes.data, nodes.data + nodes.size);
+  Array<SceneCacheInstance> gpu_instances = reader.get<SceneCacheInstance>(GPU_INSTANCES);
+  instances->assign(gpu_instances.data, gpu_instances.data + gpu_instances.size);
+  Array<SceneCacheMesh> dequantization = reader.get<SceneCacheMesh>(MESH_DEQUANTIZATION);
+  meshes->assign(dequantization.data, dequantization.data + dequantization.size);
+  return true;
+}
+
+#endif // SCENE_CACHE_HPP
@@ -1,43 +1,86 @@
 ﻿#version 120                  // GLSL 1.20
+#extension GL_ARB_uniform_buffer_object : require
 
-uniform sampler2D u_diffuse_texture;
-
-uniform vec3 u_view_position_wc;
-uniform vec3 u_light_position_wc;
+// 기능 #define은 vertex.glsl과 같다. (main.cpp가 두 셰이더에 같은 #define을 붙인다)
 
-uniform vec4 u_light_ambient;
-uniform vec4 u_light_diffuse;
-uniform vec4 u_light_specular;
+// 프레임마다 한 번 올리는 값. main.cpp의 FrameUniforms와 같은 std140 배치여야 한다.
+layout(std140) uniform FrameBlock
+{
+  mat4 u_VP;
+  vec3 u_view_position_wc;
+  vec3 u_light_position_wc;
+  vec4 u_light_ambient;
+  vec4 u_light_diffuse;
+  vec4 u_light_specular;
+};
 
-uniform vec4 u_material_ambient;
-uniform vec4 u_material_specular;
-uniform float u_material_shininess;
+// 그리는 primitive의 material. main.cpp의 MaterialUniforms와 같은 std140 배치여야 한다.
+layout(std140) uniform MaterialBlock
+{
+  vec4 u_material_ambient;
+  vec4 u_material_specular;
+  vec4 u_material_base_color;    // baseColorFactor
+  vec4 u_material_emissive;      // emissiveFactor (w는 쓰지 않는다)
+  float u_material_shininess;
+  float u_material_alpha_cutoff; // ALPHA_MASK일 때만 쓴다.
+};
 
+#ifdef HAS_NORMAL
 varying vec3 v_position_wc;
 varying vec3 v_normal_wc;
-varying vec2 v_texcoord;
+#endif
+#ifdef HAS_COLOR
 varying vec3 v_color;
+#endif
+#ifdef HAS_TEXCOORD
+uniform sampler2D u_diffuse_texture;
+varying vec2 v_texcoord;
+#endif
 
 vec4 calc_color()
 {
   vec4 color = vec4(0.0);
 
+  // glTF base color = baseColorFactor * baseColorTexture
+#ifdef HAS_TEXCOORD
+  vec4 base_color = u_material_base_color * texture2D(u_diffuse_texture, v_texcoord);
+#else
+  vec4 base_color = u_material_base_color;
+#endif
+
+#ifdef ALPHA_MASK
+  if (base_color.a < u_material_alpha_cutoff)
+    discard;
+#endif
+
+  color += u_light_ambient * u_material_ambient;
+
+#ifdef HAS_NORMAL
   vec3 n_wc = normalize(v_normal_wc);
   vec3 l_wc = normalize(u_light_position_wc - v_position_wc);
   vec3 r_wc = reflect(-l_wc, n_wc);
   vec3 v_wc = u_view_position_wc;
 
-  color += u_light_ambient * u_material_ambient;
-
-  vec4 material_diffuse = texture2D(u_diffuse_texture, v_texcoord);
-      
   float ndotl = max(0.0, dot(n_wc, l_wc));
-  color += (ndotl * u_light_diffuse * material_diffuse);
+  color += (ndotl * u_light_diffuse * base_color);
 
   float rdotv = max(0.0, dot(r_wc, v_wc) );
   color += (pow(rdotv, u_material_shininess) * u_light_specular * u_material_specular);
+#endif
 
+#ifdef HAS_COLOR
   color += vec4(v_color, 1.0f);
+#else
+  color += vec4(0.0, 0.0, 0.0, 1.0f); // 정점 색이 없을 때 a_color의 기본값
+#endif
+
+  color.rgb += u_material_emissive.rgb;
+
+#ifdef ALPHA_BLEND
+  color.a = base_color.a;
+#else
+  color.a = 1.0;
+#endif
 
   return color;
 }
@@ -1,24 +1,67 @@
 ﻿#version 120                  // GLSL 1.20
+#extension GL_ARB_uniform_buffer_object : require
 
-uniform mat4 u_PVM;
-uniform mat4 u_M;
+// main.cpp가 #version 바로 다음 줄에 primitive에 맞는 기능 #define을 붙여서 컴파일한다.
+//  HAS_NORMAL: a_normal로 조명을 계산한다.  OCTAHEDRAL_NORMALS: a_normal.xy가 팔면체 인코딩된 법선 (--quantize)
+//  HAS_COLOR: a_color를 더한다.  HAS_TEXCOORD: a_texcoord로 baseColorTexture를 샘플링한다.
+//  ALPHA_MASK, ALPHA_BLEND: material의 alphaMode (fragment.glsl만 쓴다)
+
+// 프레임마다 한 번 올리는 값. main.cpp의 FrameUniforms와 같은 std140 배치여야 한다.
+layout(std140) uniform FrameBlock
+{
+  mat4 u_VP;
+  vec3 u_view_position_wc;
+  vec3 u_light_position_wc;
+  vec4 u_light_ambient;
+  vec4 u_light_diffuse;
+  vec4 u_light_specular;
+};
 
 attribute vec3 a_position;    // per-vertex position (per-vertex input)
-attribute vec3 a_normal;      // per-vertex color (per-vertex input)
-attribute vec3 a_color;      // per-vertex color (per-vertex input)
-attribute vec2 a_texcoord;    // per-vertex color (per-vertex input)
+attribute mat4 a_model;       // per-instance world matrix (per-instance input)
 
+#ifdef HAS_NORMAL
+attribute vec3 a_normal;      // per-vertex normal (per-vertex input)
 varying vec3 v_position_wc;
 varying vec3 v_normal_wc;
-varying vec2 v_texcoord;
+#endif
+#ifdef HAS_COLOR
+attribute vec3 a_color;      // per-vertex color (per-vertex input)
 varying vec3 v_color;
+#endif
+#ifdef HAS_TEXCOORD
+attribute vec2 a_texcoord;    // per-vertex texcoord (per-vertex input)
+varying vec2 v_texcoord;
+#endif
+
+#ifdef OCTAHEDRAL_NORMALS
+vec3 decode_octahedral(vec2 e)
+{
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  if (n.z < 0.0)
+    n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+  return normalize(n);
+}
+#endif
 
 void main()
 {
-  gl_Position   = u_PVM * vec4(a_position, 1.0f);
-  
-  v_position_wc = (u_M * vec4(a_position, 1)).xyz;
-  v_normal_wc   = normalize(u_M * vec4(a_normal, 0)).xyz;
+  vec4 position_wc = a_model * vec4(a_position, 1.0f);
+  gl_Position   = u_VP * position_wc;
+
+#ifdef HAS_NORMAL
+#ifdef OCTAHEDRAL_NORMALS
+  vec3 normal = decode_octahedral(a_normal.xy);
+#else
+  vec3 normal = a_normal;
+#endif
+  v_position_wc = position_wc.xyz;
+  v_normal_wc   = normalize(a_model * vec4(normal, 0)).xyz;
+#endif
+#ifdef HAS_COLOR
   v_color = a_color;
+#endif
+#ifdef HAS_TEXCOORD
   v_texcoord    = a_texcoord;
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,281 @@
+#ifndef VERTEX_LAYOUT_HPP
+#define VERTEX_LAYOUT_HPP
+
+// 로드할 때 정점 attribute의 메모리 배치를 다시 짜는 단계
+//
+//  - INTERLEAVED: primitive 하나의 attribute를 모두 한 stream에 나란히 놓는다. 정점 하나를
+//    가져올 때 메모리 한 곳만 읽는다. attribute 순서는 accessor가 선언된 순서(인덱스 순)다.
+//    (tinygltf는 attributes를 semantic 이름순 map으로 들고 있어 JSON의 순서가 남지 않는다)
+//  - SEPARATE: attribute마다 따로 빽빽한 stream을 만든다. 비교(A/B)용
+// 원본의 byteStride가 무엇이든(이미 interleaved된 파일 포함) 원소를 하나씩 읽어 옮긴다.
+// attribute의 정점 안 위치는 성분 크기와 alignment 중 큰 값에 맞추고, stride는 그중 가장
+// 큰 값의 배수로 올린다. alignment가 4면 glTF의 정점 attribute 정렬 규칙을 지킨다.
+// 같은 accessor 조합을 쓰는 primitive끼리는 stream을 같이 쓰고, 같은 stride의 stream은
+// 새 buffer의 한 bufferView에 이어 붙인다. 희소(sparse) accessor나 bufferView가 없는
+// accessor를 쓰는 primitive는 그대로 둔다.
+//
+// tiny_gltf.h를 먼저 include해야 한다. (구현부가 중복 정의되지 않도록 여기서는 include하지 않는다)
+
+#include <algorithm>
+#include <cstring>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace vertex_layout
+{
+enum Layout
+{
+  INTERLEAVED,
+  SEPARATE,
+};
+
+struct Options
+{
+  Layout layout = INTERLEAVED;
+  size_t alignment = 4; // attribute 위치와 stride를 맞출 바이트 수. 1이면 성분 크기에만 맞춘다.
+};
+
+struct Report
+{
+  size_t primitives = 0; // 다시 배치한 primitive 수
+  size_t skipped = 0;    // 그대로 둔 primitive 수
+  size_t streams = 0;    // 만든 stream 수
+  size_t bytes = 0;      // 만든 stream의 크기 합
+  size_t padding = 0;    // 그중 정렬 때문에 비어 있는 바이트
+  // primitive 하나가 읽는 메모리 영역(bufferView 안의 stream) 개수의 합
+  size_t regions_before = 0;
+  size_t regions_after = 0;
+};
+
+// accessor 원소 하나의 크기와 성분 크기. 알 수 없는 타입이면 false.
+inline bool element_layout(const tinygltf::Accessor &accessor, size_t *size,
+                           size_t *component_size)
+{
+  int component = tinygltf::GetComponentSizeInBytes(accessor.componentType);
+  int components = tinygltf::GetTypeSizeInBytes(accessor.type); // 성분 개수를 돌려준다.
+  if (component <= 0 || components <= 0)
+    return false;
+  *size = size_t(component) * size_t(components);
+  *component_size = size_t(component);
+  return true;
+}
+
+// accessor의 원소가 모두 buffer 안에 있으면 첫 원소의 주소와 stride를 돌려준다.
+inline const unsigned char *accessor_data(const tinygltf::Model &model,
+                                          const tinygltf::Accessor &accessor,
+                                          size_t element_size, size_t *stride)
+{
+  if (accessor.bufferView < 0 || size_t(accessor.bufferView) >= model.bufferViews.size() ||
+      accessor.sparse.isSparse)
+    return nullptr;
+
+  const tinygltf::BufferView &bufferView = model.bufferViews[accessor.bufferView];
+  if (bufferView.buffer < 0 || size_t(bufferView.buffer) >= model.buffers.size())
+    return nullptr;
+  const tinygltf::Buffer &buffer = model.buffers[bufferView.buffer];
+
+  int byte_stride = accessor.ByteStride(bufferView);
+  if (byte_stride <= 0)
+    return nullptr;
+
+  size_t begin = bufferView.byteOffset + accessor.byteOffset;
+  if (accessor.count > 0 &&
+      begin + (accessor.count - 1) * size_t(byte_stride) + element_size > buffer.Size())
+    return nullptr;
+
+  *stride = size_t(byte_stride);
+  return buffer.Data() + begin;
+}
+
+// accessor가 읽는 메모리 영역: (bufferView, stride 단위로 내린 시작 위치)
+// interleaved된 attribute끼리는 같은 영역이 된다.
+inline std::pair<int, size_t> accessor_region(const tinygltf::Model &model,
+                                              const tinygltf::Accessor &accessor)
+{
+  if (accessor.bufferView < 0 || size_t(accessor.bufferView) >= model.bufferViews.size())
+    return std::make_pair(accessor.bufferView, accessor.byteOffset);
+
+  int stride = accessor.ByteStride(model.bufferViews[accessor.bufferView]);
+  size_t base = stride > 0 ? accessor.byteOffset - accessor.byteOffset % size_t(stride)
+                           : accessor.byteOffset;
+  return std::make_pair(accessor.bufferView, base);
+}
+
+inline size_t count_regions(const tinygltf::Model &model, const tinygltf::Primitive &primitive)
+{
+  std::set<std::pair<int, size_t>> regions;
+  for (const std::pair<const std::string, int> &attrib : primitive.attributes)
+  {
+    if (attrib.second >= 0 && size_t(attrib.second) < model.accessors.size())
+      regions.insert(accessor_region(model, model.accessors[attrib.second]));
+  }
+  return regions.size();
+}
+
+inline size_t align_up(size_t value, size_t alignment)
+{
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+// model의 모든 primitive에 options의 배치를 적용한다. 원래 accessor는 남지만 다시 배치한
+// primitive는 더 이상 가리키지 않는다.
+inline Report repack_model(tinygltf::Model &model, const Options &options)
+{
+  Report report;
+  const size_t alignment = std::max<size_t>(options.alignment, 1);
+
+  int buffer = static_cast<int>(model.buffers.size());
+  model.buffers.push_back(tinygltf::Buffer());
+
+  // stride별 정점 데이터. bufferView는 마지막에 만들므로 새 accessor가 어느 stride의
+  // 데이터에 들어갔는지 기억해 둔다.
+  std::map<size_t, std::vector<unsigned char>> vertex_data;
+  std::vector<std::pair<int, size_t>> pending; // (새 accessor, stride)
+
+  // accessor 조합(인덱스 순) -> 같은 순서의 새 accessor들
+  std::map<std::vector<int>, std::vector<int>> streams;
+
+  for (tinygltf::Mesh &mesh : model.meshes)
+  {
+    for (tinygltf::Primitive &primitive : mesh.primitives)
+    {
+      if (primitive.attributes.empty())
+        continue;
+
+      size_t regions_before = count_regions(model, primitive);
+
+      // 모든 attribute를 옮길 수 있는지 먼저 확인한다.
+      std::vector<int> accessors;
+      size_t count = 0;
+      bool valid = true;
+      for (const std::pair<const std::string, int> &attrib : primitive.attributes)
+      {
+        size_t size = 0;
+        size_t component_size = 0;
+        size_t stride = 0;
+        if (attrib.second < 0 || size_t(attrib.second) >= model.accessors.size() ||
+            !element_layout(model.accessors[attrib.second], &size, &component_size) ||
+            !accessor_data(model, model.accessors[attrib.second], size, &stride) ||
+            (!accessors.empty() && model.accessors[attrib.second].count != count))
+        {
+          valid = false;
+          break;
+        }
+        count = model.accessors[attrib.second].count;
+        accessors.push_back(attrib.second);
+      }
+      if (!valid)
+      {
+        report.skipped += 1;
+        report.regions_before += regions_before;
+        report.regions_after += regions_before;
+        continue;
+      }
+      std::sort(accessors.begin(), accessors.end());
+      accessors.erase(std::unique(accessors.begin(), accessors.end()), accessors.end());
+
+      // INTERLEAVED는 조합 전체가 stream 하나, SEPARATE는 accessor 하나가 stream 하나
+      std::vector<std::vector<int>> keys;
+      if (options.layout == INTERLEAVED)
+        keys.push_back(accessors);
+      else
+        for (int accessor : accessors)
+          keys.push_back(std::vector<int>(1, accessor));
+
+      std::map<int, int> replaced;
+      for (const std::vector<int> &key : keys)
+      {
+        std::map<std::vector<int>, std::vector<int>>::iterator stream = streams.find(key);
+        if (stream == streams.end())
+        {
+          std::vector<size_t> offsets;
+          size_t stride = 0;
+          size_t vertex_alignment = 1;
+          size_t used = 0;
+          for (int accessor_index : key)
+          {
+            size_t size = 0;
+            size_t component_size = 0;
+            element_layout(model.accessors[accessor_index], &size, &component_size);
+            size_t attribute_alignment = std::max(component_size, alignment);
+            stride = align_up(stride, attribute_alignment);
+            offsets.push_back(stride);
+            stride += size;
+            used += size;
+            vertex_alignment = std::max(vertex_alignment, attribute_alignment);
+          }
+          stride = align_up(stride, vertex_alignment);
+
+          // 같은 stride의 데이터는 stride 단위로 이어 붙여, stream의 시작이 항상 stride의 배수다.
+          std::vector<unsigned char> &data = vertex_data[stride];
+          size_t base = data.size();
+          data.resize(base + stride * count, 0);
+
+          std::vector<int> new_accessors;
+          for (size_t a = 0; a < key.size(); ++a)
+          {
+            const tinygltf::Accessor &source = model.accessors[key[a]];
+            size_t size = 0;
+            size_t component_size = 0;
+            size_t source_stride = 0;
+            element_layout(source, &size, &component_size);
+            const unsigned char *src = accessor_data(model, source, size, &source_stride);
+            for (size_t i = 0; i < count; ++i)
+              std::memcpy(&data[base + i * stride + offsets[a]], src + i * source_stride, size);
+
+            tinygltf::Accessor accessor = source;
+            accessor.bufferView = -1; // 마지막에 정한다.
+            accessor.byteOffset = base + offsets[a];
+            new_accessors.push_back(static_cast<int>(model.accessors.size()));
+            pending.push_back(std::make_pair(new_accessors.back(), stride));
+            model.accessors.push_back(accessor);
+          }
+
+          report.streams += 1;
+          report.bytes += stride * count;
+          report.padding += (stride - used) * count;
+          stream = streams.insert(std::make_pair(key, new_accessors)).first;
+        }
+
+        for (size_t a = 0; a < key.size(); ++a)
+          replaced[key[a]] = stream->second[a];
+      }
+
+      for (std::pair<const std::string, int> &attrib : primitive.attributes)
+        attrib.second = replaced[attrib.second];
+
+      report.primitives += 1;
+      report.regions_before += regions_before;
+      report.regions_after += keys.size();
+    }
+  }
+
+  // bufferView: stride별 정점 데이터 하나씩
+  std::vector<unsigned char> &bytes = model.buffers[buffer].data;
+  std::map<size_t, int> views;
+  for (std::pair<const size_t, std::vector<unsigned char>> &data : vertex_data)
+  {
+    tinygltf::BufferView view;
+    view.buffer = buffer;
+    view.byteOffset = align_up(bytes.size(), 4);
+    view.byteLength = data.second.size();
+    view.byteStride = data.first;
+    view.target = TINYGLTF_TARGET_ARRAY_BUFFER;
+    bytes.resize(view.byteOffset + view.byteLength, 0);
+    std::memcpy(bytes.data() + view.byteOffset, data.second.data(), data.second.size());
+
+    views[data.first] = static_cast<int>(model.bufferViews.size());
+    model.bufferViews.push_back(view);
+  }
+  for (const std::pair<int, size_t> &accessor : pending)
+    model.accessors[accessor.first].bufferView = views[accessor.second];
+
+  if (bytes.empty())
+    model.buffers.pop_back();
+  return report;
+}
+} // namespace vertex_layout
+
+#endif // VERTEX_LAYOUT_HPP
@@ -47,6 +47,7 @@
 #include <cstdlib>
 #include <cstring>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -488,6 +489,16 @@ struct Sampler {
   bool operator==(const Sampler &) const;
 };
 
+///
+/// Read-only view of a file mapped into memory. The mapping is released when
+/// the last copy of `mapping` goes away.
+///
+struct MappedFile {
+  const unsigned char *data = nullptr;
+  size_t size = 0;
+  std::shared_ptr<const void> mapping;
+};
+
 struct Image {
   std::string name;
   int width;
@@ -512,6 +523,15 @@ struct Image {
   // function)
   bool as_is;
 
+  // Set instead of `image` when the decoded pixels live in a mapped file
+  // (e.g. an application-side cache of decoded images).
+  MappedFile mapped;
+
+  const unsigned char *Pixels() const {
+    return mapped.data ? mapped.data : image.data();
+  }
+  size_t PixelsSize() const { return mapped.data ? mapped.size : image.size(); }
+
   Image() : as_is(false) {
     bufferView = -1;
     width = -1;
@@ -754,11 +774,28 @@ class Node {
 
 struct Buffer {
   std::string name;
-  std::vector<unsigned char> data;
+  std::vector<unsigned char> data;  // empty when the buffer is mapped
   std::string
       uri;  // considered as required here but not in the spec (need to clarify)
   Value extras;
 
+  // Set instead of `data` when the payload was memory-mapped
+  // (see FsCallbacks::MapWholeFile).
+  MappedFile mapped;
+
+  const unsigned char *Data() const {
+    return mapped.data ? mapped.data : data.data();
+  }
+  size_t Size() const { return mapped.data ? mapped.size : data.size(); }
+
+  // Copies mapped contents into `data` so that the buffer can be modified.
+  void Materialize() {
+    if (mapped.data) {
+      data.assign(mapped.data, mapped.data + mapped.size);
+      mapped = MappedFile();
+    }
+  }
+
   bool operator==(const Buffer &) const;
 };
 
@@ -884,6 +921,12 @@ typedef bool (*WriteWholeFileFunction)(std::string *, const std::string &,
                                        const std::vector<unsigned char> &,
                                        void *);
 
+///
+/// MapWholeFileFunction type. Signature for custom filesystem callbacks.
+///
+typedef bool (*MapWholeFileFunction)(MappedFile *, std::string *,
+                                     const std::string &, void *);
+
 ///
 /// A structure containing all required filesystem callbacks and a pointer to
 /// their user data.
@@ -895,6 +938,26 @@ struct FsCallbacks {
   WriteWholeFileFunction WriteWholeFile;
 
   void *user_data;  // An argument that is passed to all fs callbacks
+
+  // Optional. When set, external buffers and the glTF file itself are mapped
+  // instead of read, and `Buffer::mapped` points at the file contents.
+  MapWholeFileFunction MapWholeFile;
+};
+
+///
+/// Time (in milliseconds) the last Load*() call spent in each stage. A stage
+/// counts only its own time: a stage nested in another one (e.g. reading an
+/// external .bin file while parsing `buffers`) is taken out of the outer one,
+/// so the fields add up to the wall time of the call. Images decoded on worker
+/// threads count as the time the loading thread waits for them. When files
+/// are mapped, reading the pages lands in the stage that first touches them.
+///
+struct LoadStageTimes {
+  double file_io = 0.0;     // reading or mapping the glTF/GLB and other files
+  double json_parse = 0.0;  // parsing the JSON into `Model` (all the rest)
+  double base64_decode = 0.0;           // data URIs of buffers and images
+  double buffer_materialization = 0.0;  // `Buffer` data, Draco meshes
+  double image_decode = 0.0;            // `images`, up to decoded pixels
 };
 
 #ifndef TINYGLTF_NO_FS
@@ -909,6 +972,9 @@ bool ReadWholeFile(std::vector<unsigned char> *out, std::string *err,
 
 bool WriteWholeFile(std::string *err, const std::string &filepath,
                     const std::vector<unsigned char> &contents, void *);
+
+bool MapWholeFile(MappedFile *out, std::string *err,
+                  const std::string &filepath, void *);
 #endif
 
 class TinyGLTF {
@@ -989,6 +1055,37 @@ class TinyGLTF {
   ///
   void SetFsCallbacks(FsCallbacks callbacks);
 
+  ///
+  /// Decode images on a pool of worker threads instead of one by one while
+  /// parsing. The encoded bytes of every image are collected first and
+  /// decoded after the JSON has been parsed; Load*() returns only after all
+  /// images are decoded. `num_threads` <= 0 uses the number of hardware
+  /// threads. The image loader callback must be thread-safe when enabled.
+  ///
+  void SetParallelImageDecoding(bool enabled, int num_threads = 0);
+
+  ///
+  /// Decode time (in milliseconds) of each image from the last Load*() call,
+  /// indexed like `Model::images`. Images that were not decoded report 0.
+  ///
+  const std::vector<double> &GetImageDecodeTimes() const {
+    return image_decode_times_;
+  }
+
+  ///
+  /// Parse the JSON with SAX events instead of building a full DOM first.
+  /// Elements of the large top-level arrays (nodes, accessors, bufferViews,
+  /// meshes, ...) are turned into `Model` entries as soon as each one has
+  /// been read, so only one of them is held as JSON at a time. Images and
+  /// the small top-level properties still go through the DOM.
+  ///
+  void SetStreamingJsonParse(bool enabled) { streaming_json_parse_ = enabled; }
+
+  ///
+  /// Per-stage times of the last Load*() call. See `LoadStageTimes`.
+  ///
+  const LoadStageTimes &GetLoadStageTimes() const { return load_stage_times_; }
+
  private:
   ///
   /// Loads glTF asset from string(memory).
@@ -1004,16 +1101,28 @@ class TinyGLTF {
   size_t bin_size_;
   bool is_binary_;
 
+  MappedFile bin_file_;  // GLB file mapped by LoadBinaryFromFile()
+
+  bool parallel_image_decoding_ = false;
+  int image_decode_threads_ = 0;
+  std::vector<double> image_decode_times_;
+
+  bool streaming_json_parse_ = false;
+
+  LoadStageTimes load_stage_times_;
+
   FsCallbacks fs = {
 #ifndef TINYGLTF_NO_FS
       &tinygltf::FileExists, &tinygltf::ExpandFilePath,
       &tinygltf::ReadWholeFile, &tinygltf::WriteWholeFile,
 
-      nullptr  // Fs callback user data
+      nullptr,  // Fs callback user data
+      nullptr   // MapWholeFile
 #else
       nullptr, nullptr, nullptr, nullptr,
 
-      nullptr  // Fs callback user data
+      nullptr,  // Fs callback user data
+      nullptr   // MapWholeFile
 #endif
   };
 
@@ -1044,11 +1153,14 @@ class TinyGLTF {
 
 #if defined(TINYGLTF_IMPLEMENTATION) || defined(__INTELLISENSE__)
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 //#include <cassert>
 #ifndef TINYGLTF_NO_FS
 #include <fstream>
 #endif
 #include <sstream>
+#include <thread>
 
 #ifdef __clang__
 // Disable some warnings for external files.
@@ -1163,6 +1275,22 @@ class TinyGLTF {
 #include <wordexp.h>
 #endif
 
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__GNUC__) || defined(__clang__)) && !defined(TINYGLTF_NO_SIMD)
+// SSE4.1/AVX2 code paths are compiled with function target attributes and
+// picked at runtime, so no extra compiler flags are needed.
+#define TINYGLTF_BASE64_X86 1
+#include <immintrin.h>
+#endif
+
+#if !defined(_WIN32) && !defined(TINYGLTF_NO_FS) && \
+    !defined(TINYGLTF_ANDROID_LOAD_FROM_ASSETS)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #if defined(__sparcv9)
 // Big endian
 #else
@@ -1268,8 +1396,10 @@ bool Asset::operator==(const Asset &other) const {
          this->minVersion == other.minVersion && this->version == other.version;
 }
 bool Buffer::operator==(const Buffer &other) const {
-  return this->data == other.data && this->extras == other.extras &&
-         this->name == other.name && this->uri == other.uri;
+  return this->Size() == other.Size() &&
+         std::equal(this->Data(), this->Data() + this->Size(), other.Data()) &&
+         this->extras == other.extras && this->name == other.name &&
+         this->uri == other.uri;
 }
 bool BufferView::operator==(const BufferView &other) const {
   return this->buffer == other.buffer && this->byteLength == other.byteLength &&
@@ -1287,7 +1417,10 @@ bool Camera::operator==(const Camera &other) const {
 bool Image::operator==(const Image &other) const {
   return this->bufferView == other.bufferView &&
          this->component == other.component && this->extras == other.extras &&
-         this->height == other.height && this->image == other.image &&
+         this->height == other.height &&
+         this->PixelsSize() == other.PixelsSize() &&
+         std::equal(this->Pixels(), this->Pixels() + this->PixelsSize(),
+                    other.Pixels()) &&
          this->mimeType == other.mimeType && this->name == other.name &&
          this->uri == other.uri && this->width == other.width;
 }
@@ -1464,6 +1597,7 @@ static std::string GetBaseFilename(const std::string &filepath) {
 
 std::string base64_encode(unsigned char const *, unsigned int len);
 std::string base64_decode(std::string const &s);
+size_t base64_decode_into(const char *in, size_t len, unsigned char *out);
 
 /*
    base64.cpp and base64.h
@@ -1504,10 +1638,6 @@ static const std::string base64_chars =
     "abcdefghijklmnopqrstuvwxyz"
     "0123456789+/";
 
-static inline bool is_base64(unsigned char c) {
-  return (isalnum(c) || (c == '+') || (c == '/'));
-}
-
 std::string base64_encode(unsigned char const *bytes_to_encode,
                           unsigned int in_len) {
   std::string ret;
@@ -1549,54 +1679,277 @@ std::string base64_encode(unsigned char const *bytes_to_encode,
 }
 
 std::string base64_decode(std::string const &encoded_string) {
-  int in_len = static_cast<int>(encoded_string.size());
-  int i = 0;
-  int j = 0;
-  int in_ = 0;
-  unsigned char char_array_4[4], char_array_3[3];
-  std::string ret;
+  std::string ret(encoded_string.size() / 4 * 3 + 3, '\0');
+  size_t n = base64_decode_into(encoded_string.data(), encoded_string.size(),
+                                reinterpret_cast<unsigned char *>(&ret[0]));
+  ret.resize(n);
+  return ret;
+}
 
-  while (in_len-- && (encoded_string[in_] != '=') &&
-         is_base64(encoded_string[in_])) {
-    char_array_4[i++] = encoded_string[in_];
-    in_++;
-    if (i == 4) {
-      for (i = 0; i < 4; i++)
-        char_array_4[i] =
-            static_cast<unsigned char>(base64_chars.find(char_array_4[i]));
-
-      char_array_3[0] =
-          (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-      char_array_3[1] =
-          ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-      char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
-
-      for (i = 0; (i < 3); i++) ret += char_array_3[i];
-      i = 0;
+// Sextet value of each base64 character, 0xff for anything else
+// (including the '=' padding).
+static const unsigned char base64_values[256] = {
+#define TINYGLTF_B64_XX 0xff
+#define TINYGLTF_B64_X16                                                  \
+  TINYGLTF_B64_XX, TINYGLTF_B64_XX, TINYGLTF_B64_XX, TINYGLTF_B64_XX,     \
+      TINYGLTF_B64_XX, TINYGLTF_B64_XX, TINYGLTF_B64_XX, TINYGLTF_B64_XX, \
+      TINYGLTF_B64_XX, TINYGLTF_B64_XX, TINYGLTF_B64_XX, TINYGLTF_B64_XX, \
+      TINYGLTF_B64_XX, TINYGLTF_B64_XX, TINYGLTF_B64_XX, TINYGLTF_B64_XX
+    TINYGLTF_B64_X16, TINYGLTF_B64_X16,
+    // '+' = 62, '/' = 63
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 62, 0xff,
+    0xff, 0xff, 63,
+    // '0'..'9' = 52..61
+    52, 53, 54, 55, 56, 57, 58, 59, 60, 61, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    // 'A'..'Z' = 0..25
+    0xff, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19,
+    20, 21, 22, 23, 24, 25, 0xff, 0xff, 0xff, 0xff, 0xff,
+    // 'a'..'z' = 26..51
+    0xff, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, 39, 40, 41, 42,
+    43, 44, 45, 46, 47, 48, 49, 50, 51, 0xff, 0xff, 0xff, 0xff, 0xff,
+    TINYGLTF_B64_X16, TINYGLTF_B64_X16, TINYGLTF_B64_X16, TINYGLTF_B64_X16,
+    TINYGLTF_B64_X16, TINYGLTF_B64_X16, TINYGLTF_B64_X16, TINYGLTF_B64_X16
+#undef TINYGLTF_B64_X16
+#undef TINYGLTF_B64_XX
+};
+
+// Decodes from `in` up to the first '=' or non-base64 character. Returns the
+// number of characters consumed; `*written` receives the bytes produced.
+static size_t base64_decode_scalar(const char *in, size_t len,
+                                   unsigned char *out, size_t *written) {
+  const unsigned char *src = reinterpret_cast<const unsigned char *>(in);
+  size_t i = 0;
+  size_t o = 0;
+
+  for (; i + 4 <= len; i += 4) {
+    unsigned int a = base64_values[src[i]];
+    unsigned int b = base64_values[src[i + 1]];
+    unsigned int c = base64_values[src[i + 2]];
+    unsigned int d = base64_values[src[i + 3]];
+    if ((a | b | c | d) & 0x80) {
+      break;
     }
+    unsigned int v = (a << 18) | (b << 12) | (c << 6) | d;
+    out[o++] = static_cast<unsigned char>(v >> 16);
+    out[o++] = static_cast<unsigned char>(v >> 8);
+    out[o++] = static_cast<unsigned char>(v);
   }
 
-  if (i) {
-    for (j = i; j < 4; j++) char_array_4[j] = 0;
+  // Trailing group of 1-3 valid characters (stopped by padding, an invalid
+  // character or the end of input). Like base64_decode() has always done, `k`
+  // characters give `k - 1` bytes.
+  unsigned int group[4] = {0, 0, 0, 0};
+  size_t k = 0;
+  while (k < 4 && i + k < len && base64_values[src[i + k]] != 0xff) {
+    group[k] = base64_values[src[i + k]];
+    k++;
+  }
+  if (k > 1) {
+    unsigned int v =
+        (group[0] << 18) | (group[1] << 12) | (group[2] << 6) | group[3];
+    out[o++] = static_cast<unsigned char>(v >> 16);
+    if (k > 2) out[o++] = static_cast<unsigned char>(v >> 8);
+    if (k > 3) out[o++] = static_cast<unsigned char>(v);
+  }
+
+  *written = o;
+  return i + k;
+}
 
-    for (j = 0; j < 4; j++)
-      char_array_4[j] =
-          static_cast<unsigned char>(base64_chars.find(char_array_4[j]));
+#ifdef TINYGLTF_BASE64_X86
+// Vectorized decoding after W. Mula and D. Lemire, "Faster Base64 Encoding
+// and Decoding Using AVX2 Instructions" (2018). Each character is classified
+// by range, translated to its sextet with a per-range offset, and four sextets
+// are merged into three bytes with multiply-adds and a byte shuffle. A block
+// containing anything that is not a base64 character (padding included) is
+// left to the scalar decoder, which knows where to stop.
+
+__attribute__((target("sse4.1"))) static size_t base64_decode_sse41(
+    const char *in, size_t len, unsigned char *out, size_t *written) {
+  const __m128i merge_ab_bc = _mm_set1_epi32(0x01400140);
+  const __m128i merge_abc_d = _mm_set1_epi32(0x00011000);
+  const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12,
+                                     -1, -1, -1, -1);
+
+  size_t i = 0;
+  size_t o = 0;
+  // 16 characters produce 12 bytes, but the store writes 16.
+  for (; i + 24 <= len; i += 16, o += 12) {
+    __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + i));
+
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('A' - 1)),
+                                  _mm_cmplt_epi8(c, _mm_set1_epi8('Z' + 1)));
+    __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('a' - 1)),
+                                  _mm_cmplt_epi8(c, _mm_set1_epi8('z' + 1)));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)),
+                                  _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+    __m128i plus = _mm_cmpeq_epi8(c, _mm_set1_epi8('+'));
+    __m128i slash = _mm_cmpeq_epi8(c, _mm_set1_epi8('/'));
+
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower),
+                                 _mm_or_si128(digit, _mm_or_si128(plus, slash)));
+    if (_mm_movemask_epi8(valid) != 0xffff) {
+      break;
+    }
 
-    char_array_3[0] = (char_array_4[0] << 2) + ((char_array_4[1] & 0x30) >> 4);
-    char_array_3[1] =
-        ((char_array_4[1] & 0xf) << 4) + ((char_array_4[2] & 0x3c) >> 2);
-    char_array_3[2] = ((char_array_4[2] & 0x3) << 6) + char_array_4[3];
+    __m128i shift = _mm_and_si128(upper, _mm_set1_epi8(-65));
+    shift = _mm_or_si128(shift, _mm_and_si128(lower, _mm_set1_epi8(-71)));
+    shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(4)));
+    shift = _mm_or_si128(shift, _mm_and_si128(plus, _mm_set1_epi8(19)));
+    shift = _mm_or_si128(shift, _mm_and_si128(slash, _mm_set1_epi8(16)));
+    __m128i sextets = _mm_add_epi8(c, shift);
 
-    for (j = 0; (j < i - 1); j++) ret += char_array_3[j];
+    __m128i merged = _mm_maddubs_epi16(sextets, merge_ab_bc);
+    merged = _mm_madd_epi16(merged, merge_abc_d);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + o),
+                     _mm_shuffle_epi8(merged, pack));
   }
 
-  return ret;
+  size_t tail_written = 0;
+  size_t consumed = i + base64_decode_scalar(in + i, len - i, out + o,
+                                             &tail_written);
+  *written = o + tail_written;
+  return consumed;
+}
+
+__attribute__((target("avx2"))) static size_t base64_decode_avx2(
+    const char *in, size_t len, unsigned char *out, size_t *written) {
+  const __m256i merge_ab_bc = _mm256_set1_epi32(0x01400140);
+  const __m256i merge_abc_d = _mm256_set1_epi32(0x00011000);
+  const __m256i pack = _mm256_setr_epi8(
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,  //
+      2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+  const __m256i compact = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+  size_t i = 0;
+  size_t o = 0;
+  // 32 characters produce 24 bytes, but the store writes 32.
+  for (; i + 44 <= len; i += 32, o += 24) {
+    __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + i));
+
+    __m256i upper =
+        _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('A' - 1)),
+                         _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), c));
+    __m256i lower =
+        _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('a' - 1)),
+                         _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), c));
+    __m256i digit =
+        _mm256_and_si256(_mm256_cmpgt_epi8(c, _mm256_set1_epi8('0' - 1)),
+                         _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), c));
+    __m256i plus = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('+'));
+    __m256i slash = _mm256_cmpeq_epi8(c, _mm256_set1_epi8('/'));
+
+    __m256i valid =
+        _mm256_or_si256(_mm256_or_si256(upper, lower),
+                        _mm256_or_si256(digit, _mm256_or_si256(plus, slash)));
+    if (_mm256_movemask_epi8(valid) != -1) {
+      break;
+    }
+
+    __m256i shift = _mm256_and_si256(upper, _mm256_set1_epi8(-65));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(lower, _mm256_set1_epi8(-71)));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(digit, _mm256_set1_epi8(4)));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(plus, _mm256_set1_epi8(19)));
+    shift = _mm256_or_si256(shift, _mm256_and_si256(slash, _mm256_set1_epi8(16)));
+    __m256i sextets = _mm256_add_epi8(c, shift);
+
+    __m256i merged = _mm256_maddubs_epi16(sextets, merge_ab_bc);
+    merged = _mm256_madd_epi16(merged, merge_abc_d);
+    merged = _mm256_shuffle_epi8(merged, pack);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + o),
+                        _mm256_permutevar8x32_epi32(merged, compact));
+  }
+
+  size_t tail_written = 0;
+  size_t consumed = i + base64_decode_sse41(in + i, len - i, out + o,
+                                            &tail_written);
+  *written = o + tail_written;
+  return consumed;
+}
+#endif  // TINYGLTF_BASE64_X86
+
+typedef size_t (*Base64DecodeFunction)(const char *, size_t, unsigned char *,
+                                       size_t *);
+
+static Base64DecodeFunction SelectBase64Decoder() {
+#ifdef TINYGLTF_BASE64_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return &base64_decode_avx2;
+  }
+  if (__builtin_cpu_supports("sse4.1")) {
+    return &base64_decode_sse41;
+  }
+#endif
+  return &base64_decode_scalar;
+}
+
+// Decodes base64 text straight into `out`, which must have room for
+// `len / 4 * 3 + 3` bytes. Decoding stops at the first '=' or non-base64
+// character. Returns the number of bytes written.
+size_t base64_decode_into(const char *in, size_t len, unsigned char *out) {
+  static const Base64DecodeFunction decode = SelectBase64Decoder();
+  size_t written = 0;
+  decode(in, len, out, &written);
+  return written;
 }
 #ifdef __clang__
 #pragma clang diagnostic pop
 #endif
 
+// Adds the time spent inside it to one field of the `LoadStageTimes` of the
+// Load*() call running on this thread, less the time of the scopes nested in
+// it. Outside of Load*() (DecodeDataURI() called directly, image decoding
+// threads) it records nothing.
+class LoadStageScope {
+ public:
+  explicit LoadStageScope(double LoadStageTimes::*stage,
+                          LoadStageTimes *times = nullptr)
+      : times_(times ? times : (Current() ? Current()->times_ : nullptr)),
+        stage_(stage),
+        parent_(Current()),
+        nested_ms_(0.0),
+        start_(std::chrono::steady_clock::now()) {
+    Current() = this;
+  }
+
+  ~LoadStageScope() {
+    double ms = std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start_)
+                    .count();
+    if (times_) {
+      (times_->*stage_) += ms - nested_ms_;
+    }
+    if (parent_) {
+      parent_->nested_ms_ += ms;
+    }
+    Current() = parent_;
+  }
+
+  // The outermost Load*() call clears `times` before timing into it.
+  static LoadStageTimes *Begin(LoadStageTimes *times) {
+    if (!Current()) {
+      (*times) = LoadStageTimes();
+    }
+    return times;
+  }
+
+ private:
+  LoadStageScope(const LoadStageScope &);
+  LoadStageScope &operator=(const LoadStageScope &);
+
+  static LoadStageScope *&Current() {
+    static thread_local LoadStageScope *current = nullptr;
+    return current;
+  }
+
+  LoadStageTimes *times_;
+  double LoadStageTimes::*stage_;
+  LoadStageScope *parent_;
+  double nested_ms_;
+  std::chrono::steady_clock::time_point start_;
+};
+
 static bool LoadExternalFile(std::vector<unsigned char> *out, std::string *err,
                              std::string *warn, const std::string &filename,
                              const std::string &basedir, bool required,
@@ -1628,8 +1981,11 @@ static bool LoadExternalFile(std::vector<unsigned char> *out, std::string *err,
 
   std::vector<unsigned char> buf;
   std::string fileReadErr;
-  bool fileRead =
-      fs->ReadWholeFile(&buf, &fileReadErr, filepath, fs->user_data);
+  bool fileRead;
+  {
+    LoadStageScope stage(&LoadStageTimes::file_io);
+    fileRead = fs->ReadWholeFile(&buf, &fileReadErr, filepath, fs->user_data);
+  }
   if (!fileRead) {
     if (failMsgOut) {
       (*failMsgOut) +=
@@ -1665,6 +2021,59 @@ static bool LoadExternalFile(std::vector<unsigned char> *out, std::string *err,
   return true;
 }
 
+// Same as LoadExternalFile, but maps the file with fs->MapWholeFile.
+static bool MapExternalFile(MappedFile *out, std::string *err,
+                            const std::string &filename,
+                            const std::string &basedir, size_t reqBytes,
+                            bool checkSize, FsCallbacks *fs) {
+  if (fs == nullptr || fs->FileExists == nullptr ||
+      fs->ExpandFilePath == nullptr || fs->MapWholeFile == nullptr) {
+    if (err) {
+      (*err) += "FS callback[s] not set\n";
+    }
+    return false;
+  }
+
+  std::vector<std::string> paths;
+  paths.push_back(basedir);
+  paths.push_back(".");
+
+  std::string filepath = FindFile(paths, filename, fs);
+  if (filepath.empty() || filename.empty()) {
+    if (err) {
+      (*err) += "File not found : " + filename + "\n";
+    }
+    return false;
+  }
+
+  MappedFile file;
+  std::string fileMapErr;
+  bool fileMapped;
+  {
+    LoadStageScope stage(&LoadStageTimes::file_io);
+    fileMapped = fs->MapWholeFile(&file, &fileMapErr, filepath, fs->user_data);
+  }
+  if (!fileMapped) {
+    if (err) {
+      (*err) += "File map error : " + filepath + " : " + fileMapErr + "\n";
+    }
+    return false;
+  }
+
+  if (checkSize && reqBytes != file.size) {
+    std::stringstream ss;
+    ss << "File size mismatch : " << filepath << ", requestedBytes "
+       << reqBytes << ", but got " << file.size << std::endl;
+    if (err) {
+      (*err) += ss.str();
+    }
+    return false;
+  }
+
+  (*out) = file;
+  return true;
+}
+
 void TinyGLTF::SetImageLoader(LoadImageDataFunction func, void *user_data) {
   LoadImageData = func;
   load_image_user_data_ = user_data;
@@ -1768,6 +2177,29 @@ bool LoadImageData(Image *image, const int image_idx, std::string *err,
 }
 #endif
 
+// Calls the image loader callback and reports how long it took.
+static bool DecodeImage(LoadImageDataFunction LoadImageData, Image *image,
+                        const int image_idx, std::string *err,
+                        std::string *warn, int req_width, int req_height,
+                        const unsigned char *bytes, int size,
+                        void *load_image_user_data, double *decode_ms) {
+  std::chrono::steady_clock::time_point start =
+      std::chrono::steady_clock::now();
+  bool ret = LoadImageData(image, image_idx, err, warn, req_width, req_height,
+                           bytes, size, load_image_user_data);
+  if (decode_ms) {
+    (*decode_ms) = std::chrono::duration<double, std::milli>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+  }
+  return ret;
+}
+
+void TinyGLTF::SetParallelImageDecoding(bool enabled, int num_threads) {
+  parallel_image_decoding_ = enabled;
+  image_decode_threads_ = num_threads;
+}
+
 void TinyGLTF::SetImageWriter(WriteImageDataFunction func, void *user_data) {
   WriteImageData = func;
   write_image_user_data_ = user_data;
@@ -1800,21 +2232,21 @@ bool WriteImageData(const std::string *basepath, const std::string *filename,
 
     if (!stbi_write_png_to_func(WriteToMemory_stbi, &data, image->width,
                                 image->height, image->component,
-                                &image->image[0], 0)) {
+                                image->Pixels(), 0)) {
       return false;
     }
     header = "data:image/png;base64,";
   } else if (ext == "jpg") {
     if (!stbi_write_jpg_to_func(WriteToMemory_stbi, &data, image->width,
                                 image->height, image->component,
-                                &image->image[0], 100)) {
+                                image->Pixels(), 100)) {
       return false;
     }
     header = "data:image/jpeg;base64,";
   } else if (ext == "bmp") {
     if (!stbi_write_bmp_to_func(WriteToMemory_stbi, &data, image->width,
                                 image->height, image->component,
-                                &image->image[0])) {
+                                image->Pixels())) {
       return false;
     }
     header = "data:image/bmp;base64,";
@@ -2004,6 +2436,104 @@ bool ReadWholeFile(std::vector<unsigned char> *out, std::string *err,
 #endif
 }
 
+bool MapWholeFile(MappedFile *out, std::string *err,
+                  const std::string &filepath, void *) {
+#if defined(TINYGLTF_ANDROID_LOAD_FROM_ASSETS)
+  (void)out;
+  if (err) {
+    (*err) += "Memory mapping is not supported for assets : " + filepath +
+              "\n";
+  }
+  return false;
+#elif defined(_WIN32)
+  HANDLE file = CreateFileA(filepath.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                            nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                            nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    if (err) {
+      (*err) += "File open error : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+    CloseHandle(file);
+    if (err) {
+      (*err) += "File is empty : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(file);
+  if (mapping == nullptr) {
+    if (err) {
+      (*err) += "File mapping error : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  const void *addr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if (addr == nullptr) {
+    if (err) {
+      (*err) += "File mapping error : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  out->data = static_cast<const unsigned char *>(addr);
+  out->size = static_cast<size_t>(file_size.QuadPart);
+  out->mapping = std::shared_ptr<const void>(
+      addr, [](const void *p) { UnmapViewOfFile(p); });
+  return true;
+#else
+  int fd = open(filepath.c_str(), O_RDONLY);
+  if (fd < 0) {
+    if (err) {
+      (*err) += "File open error : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    if (err) {
+      (*err) += "Invalid file size : " + filepath +
+                " (does the path point to a directory?)";
+    }
+    return false;
+  }
+
+  size_t sz = static_cast<size_t>(st.st_size);
+  if (sz == 0) {
+    close(fd);
+    if (err) {
+      (*err) += "File is empty : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  void *addr = mmap(nullptr, sz, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);  // The mapping keeps its own reference to the file.
+  if (addr == MAP_FAILED) {
+    if (err) {
+      (*err) += "File mapping error : " + filepath + "\n";
+    }
+    return false;
+  }
+
+  out->data = static_cast<const unsigned char *>(addr);
+  out->size = sz;
+  out->mapping = std::shared_ptr<const void>(
+      addr, [sz](const void *p) { munmap(const_cast<void *>(p), sz); });
+  return true;
+#endif
+}
+
 bool WriteWholeFile(std::string *err, const std::string &filepath,
                     const std::vector<unsigned char> &contents, void *) {
   std::ofstream f(filepath.c_str(), std::ofstream::binary);
@@ -2072,113 +2602,70 @@ static void UpdateImageObject(Image &image, std::string &baseDir, int index,
   }
 }
 
-bool IsDataURI(const std::string &in) {
-  std::string header = "data:application/octet-stream;base64,";
-  if (in.find(header) == 0) {
-    return true;
-  }
-
-  header = "data:image/jpeg;base64,";
-  if (in.find(header) == 0) {
-    return true;
-  }
-
-  header = "data:image/png;base64,";
-  if (in.find(header) == 0) {
-    return true;
-  }
+namespace {
 
-  header = "data:image/bmp;base64,";
-  if (in.find(header) == 0) {
-    return true;
-  }
+struct DataURIHeader {
+  const char *header;
+  const char *mime_type;  // nullptr leaves the mime type untouched
+};
 
-  header = "data:image/gif;base64,";
-  if (in.find(header) == 0) {
-    return true;
-  }
+const DataURIHeader data_uri_headers[] = {
+    {"data:application/octet-stream;base64,", nullptr},
+    {"data:image/jpeg;base64,", "image/jpeg"},
+    {"data:image/png;base64,", "image/png"},
+    {"data:image/bmp;base64,", "image/bmp"},
+    {"data:image/gif;base64,", "image/gif"},
+    {"data:text/plain;base64,", "text/plain"},
+    {"data:application/gltf-buffer;base64,", nullptr},
+};
 
-  header = "data:text/plain;base64,";
-  if (in.find(header) == 0) {
-    return true;
+// Only looks at the beginning of `in`, so large URIs are not scanned.
+const DataURIHeader *FindDataURIHeader(const std::string &in) {
+  for (const DataURIHeader &h : data_uri_headers) {
+    size_t n = strlen(h.header);
+    if (in.size() >= n && in.compare(0, n, h.header) == 0) {
+      return &h;
+    }
   }
+  return nullptr;
+}
 
-  header = "data:application/gltf-buffer;base64,";
-  if (in.find(header) == 0) {
-    return true;
-  }
+}  // namespace
 
-  return false;
+bool IsDataURI(const std::string &in) {
+  return FindDataURIHeader(in) != nullptr;
 }
 
 bool DecodeDataURI(std::vector<unsigned char> *out, std::string &mime_type,
                    const std::string &in, size_t reqBytes, bool checkSize) {
-  std::string header = "data:application/octet-stream;base64,";
-  std::string data;
-  if (in.find(header) == 0) {
-    data = base64_decode(in.substr(header.size()));  // cut mime string.
-  }
+  LoadStageScope stage(&LoadStageTimes::base64_decode);
 
-  if (data.empty()) {
-    header = "data:image/jpeg;base64,";
-    if (in.find(header) == 0) {
-      mime_type = "image/jpeg";
-      data = base64_decode(in.substr(header.size()));  // cut mime string.
-    }
-  }
-
-  if (data.empty()) {
-    header = "data:image/png;base64,";
-    if (in.find(header) == 0) {
-      mime_type = "image/png";
-      data = base64_decode(in.substr(header.size()));  // cut mime string.
-    }
-  }
-
-  if (data.empty()) {
-    header = "data:image/bmp;base64,";
-    if (in.find(header) == 0) {
-      mime_type = "image/bmp";
-      data = base64_decode(in.substr(header.size()));  // cut mime string.
-    }
-  }
-
-  if (data.empty()) {
-    header = "data:image/gif;base64,";
-    if (in.find(header) == 0) {
-      mime_type = "image/gif";
-      data = base64_decode(in.substr(header.size()));  // cut mime string.
-    }
+  const DataURIHeader *h = FindDataURIHeader(in);
+  if (!h) {
+    return false;
   }
 
-  if (data.empty()) {
-    header = "data:text/plain;base64,";
-    if (in.find(header) == 0) {
-      mime_type = "text/plain";
-      data = base64_decode(in.substr(header.size()));
-    }
-  }
+  // Decode the payload in place of the URI string straight into `out`.
+  size_t header_size = strlen(h->header);
+  const char *payload = in.data() + header_size;
+  size_t payload_size = in.size() - header_size;
 
-  if (data.empty()) {
-    header = "data:application/gltf-buffer;base64,";
-    if (in.find(header) == 0) {
-      data = base64_decode(in.substr(header.size()));
-    }
+  out->resize(payload_size / 4 * 3 + 3);
+  size_t n = base64_decode_into(payload, payload_size, out->data());
+  if (n == 0) {
+    out->clear();
+    return false;
   }
 
-  if (data.empty()) {
+  if (checkSize && n != reqBytes) {
+    out->clear();
     return false;
   }
+  out->resize(n);
 
-  if (checkSize) {
-    if (data.size() != reqBytes) {
-      return false;
-    }
-    out->resize(reqBytes);
-  } else {
-    out->resize(data.size());
+  if (h->mime_type) {
+    mime_type = h->mime_type;
   }
-  std::copy(data.begin(), data.end(), out->begin());
   return true;
 }
 
@@ -2671,11 +3158,15 @@ static bool ParseAsset(Asset *asset, std::string *err, const json &o) {
   return true;
 }
 
+// When `deferred_bytes` is given, the encoded image is returned there instead
+// of being decoded, so that the caller can decode it later.
 static bool ParseImage(Image *image, const int image_idx, std::string *err,
                        std::string *warn, const json &o,
                        const std::string &basedir, FsCallbacks *fs,
                        LoadImageDataFunction *LoadImageData = nullptr,
-                       void *load_image_user_data = nullptr) {
+                       void *load_image_user_data = nullptr,
+                       std::vector<unsigned char> *deferred_bytes = nullptr,
+                       double *decode_ms = nullptr) {
   // A glTF image must either reference a bufferView or an image uri
 
   // schema says oneOf [`bufferView`, `uri`]
@@ -2794,8 +3285,91 @@ static bool ParseImage(Image *image, const int image_idx, std::string *err,
     }
     return false;
   }
-  return (*LoadImageData)(image, image_idx, err, warn, 0, 0, &img.at(0),
-                          static_cast<int>(img.size()), load_image_user_data);
+
+  if (deferred_bytes) {
+    deferred_bytes->swap(img);
+    return true;
+  }
+
+  return DecodeImage(*LoadImageData, image, image_idx, err, warn, 0, 0,
+                     &img.at(0), static_cast<int>(img.size()),
+                     load_image_user_data, decode_ms);
+}
+
+namespace {
+
+// An image whose encoded bytes were collected while parsing and that is
+// decoded after the whole document has been parsed.
+struct ImageDecodeJob {
+  int image_idx = -1;
+  int req_width = 0;
+  int req_height = 0;
+  std::vector<unsigned char> owned_bytes;  // data URI or external file
+  const unsigned char *bytes = nullptr;    // points into a buffer otherwise
+  size_t size = 0;
+
+  std::string err;
+  std::string warn;
+  bool ok = false;
+};
+
+}  // namespace
+
+// Decodes `jobs` into `images` on up to `num_threads` threads and appends the
+// errors and warnings in image order. stb_image keeps its failure reason in a
+// global, so concurrent failures may report each other's reason.
+static bool DecodeImagesInParallel(std::vector<ImageDecodeJob> *jobs,
+                                   std::vector<Image> *images,
+                                   LoadImageDataFunction LoadImageData,
+                                   void *load_image_user_data, int num_threads,
+                                   std::vector<double> *decode_times,
+                                   std::string *err, std::string *warn) {
+  if (jobs->empty()) {
+    return true;
+  }
+
+  size_t thread_count = num_threads > 0
+                            ? size_t(num_threads)
+                            : size_t(std::thread::hardware_concurrency());
+  thread_count = std::max(size_t(1), std::min(thread_count, jobs->size()));
+
+  std::atomic<size_t> next_job(0);
+  auto worker = [&]() {
+    for (;;) {
+      size_t i = next_job.fetch_add(1);
+      if (i >= jobs->size()) {
+        break;
+      }
+      ImageDecodeJob &job = (*jobs)[i];
+      job.ok = DecodeImage(LoadImageData, &(*images)[size_t(job.image_idx)],
+                           job.image_idx, &job.err, &job.warn, job.req_width,
+                           job.req_height, job.bytes, int(job.size),
+                           load_image_user_data,
+                           &(*decode_times)[size_t(job.image_idx)]);
+      std::vector<unsigned char>().swap(job.owned_bytes);
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t t = 1; t < thread_count; t++) {
+    threads.push_back(std::thread(worker));
+  }
+  worker();
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  bool ret = true;
+  for (const ImageDecodeJob &job : *jobs) {
+    if (err) {
+      (*err) += job.err;
+    }
+    if (warn) {
+      (*warn) += job.warn;
+    }
+    ret = ret && job.ok;
+  }
+  return ret;
 }
 
 static bool ParseTexture(Texture *texture, std::string *err, const json &o,
@@ -2818,11 +3392,17 @@ static bool ParseTexture(Texture *texture, std::string *err, const json &o,
   return true;
 }
 
+// When `bin_mapping` owns `bin_data`, the GLB BIN chunk is referenced in
+// place through `Buffer::mapped` instead of being copied into `Buffer::data`.
 static bool ParseBuffer(Buffer *buffer, std::string *err, const json &o,
                         FsCallbacks *fs, const std::string &basedir,
                         bool is_binary = false,
                         const unsigned char *bin_data = nullptr,
-                        size_t bin_size = 0) {
+                        size_t bin_size = 0,
+                        const std::shared_ptr<const void> &bin_mapping =
+                            std::shared_ptr<const void>()) {
+  LoadStageScope stage(&LoadStageTimes::buffer_materialization);
+
   size_t byteLength;
   if (!ParseUnsignedProperty(&byteLength, err, o, "byteLength", true,
                              "Buffer")) {
@@ -2864,6 +3444,12 @@ static bool ParseBuffer(Buffer *buffer, std::string *err, const json &o,
           }
           return false;
         }
+      } else if (fs->MapWholeFile) {
+        // External .bin file, mapped in place.
+        if (!MapExternalFile(&buffer->mapped, err, buffer->uri, basedir,
+                             byteLength, true, fs)) {
+          return false;
+        }
       } else {
         // External .bin file.
         if (!LoadExternalFile(&buffer->data, err, /* warn */ nullptr,
@@ -2893,9 +3479,16 @@ static bool ParseBuffer(Buffer *buffer, std::string *err, const json &o,
         return false;
       }
 
-      // Read buffer data
-      buffer->data.resize(static_cast<size_t>(byteLength));
-      memcpy(&(buffer->data.at(0)), bin_data, static_cast<size_t>(byteLength));
+      if (bin_mapping) {
+        buffer->mapped.data = bin_data;
+        buffer->mapped.size = static_cast<size_t>(byteLength);
+        buffer->mapped.mapping = bin_mapping;
+      } else {
+        // Read buffer data
+        buffer->data.resize(static_cast<size_t>(byteLength));
+        memcpy(&(buffer->data.at(0)), bin_data,
+               static_cast<size_t>(byteLength));
+      }
     }
 
   } else {
@@ -2908,6 +3501,12 @@ static bool ParseBuffer(Buffer *buffer, std::string *err, const json &o,
         }
         return false;
       }
+    } else if (fs->MapWholeFile) {
+      // Assume external .bin file, mapped in place.
+      if (!MapExternalFile(&buffer->mapped, err, buffer->uri, basedir,
+                           byteLength, true, fs)) {
+        return false;
+      }
     } else {
       // Assume external .bin file.
       if (!LoadExternalFile(&buffer->data, err, /* warn */ nullptr, buffer->uri,
@@ -3229,7 +3828,7 @@ static bool ParseDracoExtension(Primitive *primitive, Model *model,
   view.dracoDecoded = true;
 
   const char *bufferViewData =
-      reinterpret_cast<const char *>(buffer.data.data() + view.byteOffset);
+      reinterpret_cast<const char *>(buffer.Data() + view.byteOffset);
   size_t bufferViewSize = view.byteLength;
 
   // decode draco
@@ -3354,6 +3953,7 @@ static bool ParsePrimitive(Primitive *primitive, Model *model, std::string *err,
   auto dracoExtension =
       primitive->extensions.find("KHR_draco_mesh_compression");
   if (dracoExtension != primitive->extensions.end()) {
+    LoadStageScope stage(&LoadStageTimes::buffer_materialization);
     ParseDracoExtension(primitive, model, err, dracoExtension->second);
   }
 #else
@@ -3747,6 +4347,186 @@ static bool ParseCamera(Camera *camera, std::string *err, const json &o) {
   return true;
 }
 
+static bool ParseScene(Scene *scene, std::string *err, const json &o) {
+  std::vector<int> nodes;
+  if (!ParseIntegerArrayProperty(&nodes, err, o, "nodes", false)) {
+    return false;
+  }
+
+  scene->nodes = std::move(nodes);
+
+  ParseStringProperty(&scene->name, err, o, "name", false);
+
+  ParseExtensionsProperty(&scene->extensions, err, o);
+  ParseExtrasProperty(&scene->extras, o);
+
+  return true;
+}
+
+namespace {
+
+// Top-level arrays whose elements LoadFromString() can turn into Model
+// entries without looking at the rest of the document. Images need the
+// buffers and bufferViews (and Draco meshes the accessors), which may come
+// later in the file, so they stay in the DOM.
+enum StreamedSection {
+  STREAMED_BUFFERS,
+  STREAMED_BUFFER_VIEWS,
+  STREAMED_ACCESSORS,
+  STREAMED_MESHES,
+  STREAMED_NODES,
+  STREAMED_SCENES,
+  STREAMED_MATERIALS,
+  STREAMED_TEXTURES,
+  STREAMED_ANIMATIONS,
+  STREAMED_SKINS,
+  STREAMED_SAMPLERS,
+  STREAMED_CAMERAS,
+  NUM_STREAMED_SECTIONS
+};
+
+const char *const streamed_section_names[NUM_STREAMED_SECTIONS] = {
+    "buffers",    "bufferViews", "accessors",  "meshes",
+    "nodes",      "scenes",      "materials",  "textures",
+    "animations", "skins",       "samplers",   "cameras"};
+
+bool IsStreamedSection(StreamedSection section) {
+#ifdef TINYGLTF_ENABLE_DRACO
+  if (section == STREAMED_MESHES) {
+    return false;
+  }
+#endif
+  (void)section;
+  return true;
+}
+
+// nlohmann::json SAX consumer. Builds a DOM for everything except the
+// elements of the streamed top-level arrays, which are built one at a time
+// and handed to `on_element(section, &element)`; returning false from it
+// stops the parse. Streamed arrays are left in the DOM as empty arrays so
+// section checks still see them.
+template <typename ElementCallback>
+class StreamingJsonHandler {
+ public:
+  explicit StreamingJsonHandler(ElementCallback on_element)
+      : on_element_(on_element) {}
+
+  json &root() { return root_; }
+  const std::string &parse_error_message() const { return error_; }
+
+  bool null() { return Value(json(nullptr)); }
+  bool boolean(bool val) { return Value(json(val)); }
+  bool number_integer(json::number_integer_t val) { return Value(json(val)); }
+  bool number_unsigned(json::number_unsigned_t val) {
+    return Value(json(val));
+  }
+  bool number_float(json::number_float_t val, const std::string &) {
+    return Value(json(val));
+  }
+  bool string(std::string &val) { return Value(json(std::move(val))); }
+
+  bool key(std::string &val) {
+    key_ = std::move(val);
+    return true;
+  }
+
+  bool start_object(std::size_t) {
+    stack_.push_back(Insert(json(json::value_t::object)));
+    return true;
+  }
+
+  bool end_object() { return Close(); }
+
+  bool start_array(std::size_t) {
+    if (stack_.size() == 1 && stack_.back()->is_object()) {
+      for (int i = 0; i < NUM_STREAMED_SECTIONS; i++) {
+        StreamedSection section = static_cast<StreamedSection>(i);
+        if (key_ == streamed_section_names[i] && IsStreamedSection(section)) {
+          (*stack_.back())[key_] = json::array();
+          section_ = section;
+          stack_.push_back(nullptr);  // elements go to `element_`
+          return true;
+        }
+      }
+    }
+    stack_.push_back(Insert(json(json::value_t::array)));
+    return true;
+  }
+
+  bool end_array() {
+    if (stack_.back() == nullptr) {
+      stack_.pop_back();
+      return true;
+    }
+    return Close();
+  }
+
+  bool parse_error(std::size_t, const std::string &,
+                   const nlohmann::detail::exception &ex) {
+    error_ = ex.what();
+    return false;
+  }
+
+ private:
+  json *Insert(json &&val) {
+    if (stack_.empty()) {
+      root_ = std::move(val);
+      return &root_;
+    }
+
+    json *parent = stack_.back();
+    if (parent == nullptr) {
+      element_ = std::move(val);
+      return &element_;
+    }
+
+    if (parent->is_object()) {
+      json &slot = (*parent)[key_];
+      slot = std::move(val);
+      return &slot;
+    }
+
+    parent->push_back(std::move(val));
+    return &parent->back();
+  }
+
+  bool Value(json &&val) {
+    bool is_element = !stack_.empty() && stack_.back() == nullptr;
+    Insert(std::move(val));
+    return is_element ? Emit() : true;
+  }
+
+  bool Close() {
+    stack_.pop_back();
+    if (!stack_.empty() && stack_.back() == nullptr) {
+      return Emit();
+    }
+    return true;
+  }
+
+  bool Emit() {
+    bool ok = on_element_(section_, &element_);
+    element_ = json();
+    return ok;
+  }
+
+  ElementCallback on_element_;
+  json root_;
+  json element_;
+  std::vector<json *> stack_;  // nullptr marks a streamed array
+  std::string key_;
+  StreamedSection section_ = NUM_STREAMED_SECTIONS;
+  std::string error_;
+};
+
+template <typename ElementCallback>
+StreamingJsonHandler<ElementCallback> MakeStreamingJsonHandler(
+    ElementCallback on_element) {
+  return StreamingJsonHandler<ElementCallback>(on_element);
+}
+
+}  // namespace
+
 bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
                               const char *str, unsigned int length,
                               const std::string &base_dir,
@@ -3758,33 +4538,171 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
     return false;
   }
 
+  model->buffers.clear();
+  model->bufferViews.clear();
+  model->accessors.clear();
+  model->meshes.clear();
+  model->cameras.clear();
+  model->nodes.clear();
+  model->extensionsUsed.clear();
+  model->extensionsRequired.clear();
+  model->extensions.clear();
+  model->defaultScene = -1;
+
   json v;
 
+  if (streaming_json_parse_) {
+    // Elements of the large arrays go straight into `model`; `v` receives
+    // the rest of the document.
+    auto parse_element = [&](StreamedSection section, json *o) -> bool {
+      if (!o->is_object()) {
+        if (err) {
+          (*err) += std::string("`") + streamed_section_names[section] +
+                    "' does not contain an JSON object.";
+        }
+        return false;
+      }
+
+      switch (section) {
+        case STREAMED_BUFFERS: {
+          Buffer buffer;
+          if (!ParseBuffer(&buffer, err, *o, &fs, base_dir, is_binary_,
+                           bin_data_, bin_size_, bin_file_.mapping)) {
+            return false;
+          }
+          model->buffers.push_back(std::move(buffer));
+          break;
+        }
+        case STREAMED_BUFFER_VIEWS: {
+          BufferView bufferView;
+          if (!ParseBufferView(&bufferView, err, *o)) {
+            return false;
+          }
+          model->bufferViews.push_back(std::move(bufferView));
+          break;
+        }
+        case STREAMED_ACCESSORS: {
+          Accessor accessor;
+          if (!ParseAccessor(&accessor, err, *o)) {
+            return false;
+          }
+          model->accessors.push_back(std::move(accessor));
+          break;
+        }
+        case STREAMED_MESHES: {
+          Mesh mesh;
+          if (!ParseMesh(&mesh, model, err, *o)) {
+            return false;
+          }
+          model->meshes.push_back(std::move(mesh));
+          break;
+        }
+        case STREAMED_NODES: {
+          Node node;
+          if (!ParseNode(&node, err, *o)) {
+            return false;
+          }
+          model->nodes.push_back(std::move(node));
+          break;
+        }
+        case STREAMED_SCENES: {
+          Scene scene;
+          if (!ParseScene(&scene, err, *o)) {
+            return false;
+          }
+          model->scenes.push_back(std::move(scene));
+          break;
+        }
+        case STREAMED_MATERIALS: {
+          Material material;
+          ParseStringProperty(&material.name, err, *o, "name", false);
+          if (!ParseMaterial(&material, err, *o)) {
+            return false;
+          }
+          model->materials.push_back(std::move(material));
+          break;
+        }
+        case STREAMED_TEXTURES: {
+          Texture texture;
+          if (!ParseTexture(&texture, err, *o, base_dir)) {
+            return false;
+          }
+          model->textures.push_back(std::move(texture));
+          break;
+        }
+        case STREAMED_ANIMATIONS: {
+          Animation animation;
+          if (!ParseAnimation(&animation, err, *o)) {
+            return false;
+          }
+          model->animations.push_back(std::move(animation));
+          break;
+        }
+        case STREAMED_SKINS: {
+          Skin skin;
+          if (!ParseSkin(&skin, err, *o)) {
+            return false;
+          }
+          model->skins.push_back(std::move(skin));
+          break;
+        }
+        case STREAMED_SAMPLERS: {
+          Sampler sampler;
+          if (!ParseSampler(&sampler, err, *o)) {
+            return false;
+          }
+          model->samplers.push_back(std::move(sampler));
+          break;
+        }
+        case STREAMED_CAMERAS: {
+          Camera camera;
+          if (!ParseCamera(&camera, err, *o)) {
+            return false;
+          }
+          model->cameras.push_back(std::move(camera));
+          break;
+        }
+        default:
+          break;
+      }
+      return true;
+    };
+
+    auto handler = MakeStreamingJsonHandler(parse_element);
+    if (!json::sax_parse(str, str + length, &handler)) {
+      if (err && !handler.parse_error_message().empty()) {
+        (*err) = handler.parse_error_message();
+      }
+      return false;
+    }
+    v = std::move(handler.root());
+  } else {
 #if (defined(__cpp_exceptions) || defined(__EXCEPTIONS) || \
      defined(_CPPUNWIND)) &&                               \
     not defined(TINYGLTF_NOEXCEPTION)
-  try {
-    v = json::parse(str, str + length);
+    try {
+      v = json::parse(str, str + length);
 
-  } catch (const std::exception &e) {
-    if (err) {
-      (*err) = e.what();
+    } catch (const std::exception &e) {
+      if (err) {
+        (*err) = e.what();
+      }
+      return false;
     }
-    return false;
-  }
 #else
-  {
-    v = json::parse(str, str + length, nullptr, /* exception */ false);
+    {
+      v = json::parse(str, str + length, nullptr, /* exception */ false);
 
-    if (!v.is_object()) {
-      // Assume parsing was failed.
-      if (err) {
-        (*err) = "Failed to parse JSON object\n";
+      if (!v.is_object()) {
+        // Assume parsing was failed.
+        if (err) {
+          (*err) = "Failed to parse JSON object\n";
+        }
+        return false;
       }
-      return false;
     }
-  }
 #endif
+  }
 
   if (!v.is_object()) {
     // root is not an object.
@@ -3876,17 +4794,6 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
     }
   }
 
-  model->buffers.clear();
-  model->bufferViews.clear();
-  model->accessors.clear();
-  model->meshes.clear();
-  model->cameras.clear();
-  model->nodes.clear();
-  model->extensionsUsed.clear();
-  model->extensionsRequired.clear();
-  model->extensions.clear();
-  model->defaultScene = -1;
-
   // 1. Parse Asset
   {
     json::const_iterator it = v.find("asset");
@@ -3935,7 +4842,8 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
         }
         Buffer buffer;
         if (!ParseBuffer(&buffer, err, it->get<json>(), &fs, base_dir,
-                         is_binary_, bin_data_, bin_size_)) {
+                         is_binary_, bin_data_, bin_size_,
+                         bin_file_.mapping)) {
           return false;
         }
 
@@ -4099,20 +5007,11 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
           }
           return false;
         }
-        const json &o = it->get<json>();
-        std::vector<int> nodes;
-        if (!ParseIntegerArrayProperty(&nodes, err, o, "nodes", false)) {
+        Scene scene;
+        if (!ParseScene(&scene, err, it.value())) {
           return false;
         }
 
-        Scene scene;
-        scene.nodes = std::move(nodes);
-
-        ParseStringProperty(&scene.name, err, o, "name", false);
-
-        ParseExtensionsProperty(&scene.extensions, err, o);
-        ParseExtrasProperty(&scene.extras, o);
-
         model->scenes.push_back(scene);
       }
     }
@@ -4158,11 +5057,17 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
   }
 
   // 11. Parse Image
+  image_decode_times_.clear();
   {
+    LoadStageScope stage(&LoadStageTimes::image_decode);
+
     json::const_iterator rootIt = v.find("images");
     if ((rootIt != v.end()) && rootIt.value().is_array()) {
       const json &root = rootIt.value();
 
+      std::vector<ImageDecodeJob> decode_jobs;
+      image_decode_times_.assign(root.size(), 0.0);
+
       json::const_iterator it(root.begin());
       json::const_iterator itEnd(root.end());
       int idx = 0;
@@ -4175,11 +5080,21 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
           return false;
         }
         Image image;
+        ImageDecodeJob job;
         if (!ParseImage(&image, idx, err, warn, it.value(), base_dir, &fs,
-                        &this->LoadImageData, load_image_user_data_)) {
+                        &this->LoadImageData, load_image_user_data_,
+                        parallel_image_decoding_ ? &job.owned_bytes : nullptr,
+                        &image_decode_times_[size_t(idx)])) {
           return false;
         }
 
+        if (!job.owned_bytes.empty()) {
+          job.image_idx = idx;
+          job.bytes = job.owned_bytes.data();
+          job.size = job.owned_bytes.size();
+          decode_jobs.push_back(std::move(job));
+        }
+
         if (image.bufferView != -1) {
           // Load image from the buffer view.
           if (size_t(image.bufferView) >= model->bufferViews.size()) {
@@ -4211,17 +5126,35 @@ bool TinyGLTF::LoadFromString(Model *model, std::string *err, std::string *warn,
             }
             return false;
           }
-          bool ret = LoadImageData(
-              &image, idx, err, warn, image.width, image.height,
-              &buffer.data[bufferView.byteOffset],
-              static_cast<int>(bufferView.byteLength), load_image_user_data_);
-          if (!ret) {
-            return false;
+
+          if (parallel_image_decoding_) {
+            ImageDecodeJob view_job;
+            view_job.image_idx = idx;
+            view_job.req_width = image.width;
+            view_job.req_height = image.height;
+            view_job.bytes = buffer.Data() + bufferView.byteOffset;
+            view_job.size = bufferView.byteLength;
+            decode_jobs.push_back(std::move(view_job));
+          } else {
+            bool ret = DecodeImage(
+                LoadImageData, &image, idx, err, warn, image.width,
+                image.height, buffer.Data() + bufferView.byteOffset,
+                static_cast<int>(bufferView.byteLength), load_image_user_data_,
+                &image_decode_times_[size_t(idx)]);
+            if (!ret) {
+              return false;
+            }
           }
         }
 
         model->images.push_back(image);
       }
+
+      if (!DecodeImagesInParallel(&decode_jobs, &model->images, LoadImageData,
+                                  load_image_user_data_, image_decode_threads_,
+                                  &image_decode_times_, err, warn)) {
+        return false;
+      }
     }
   }
 
@@ -4402,6 +5335,9 @@ bool TinyGLTF::LoadASCIIFromString(Model *model, std::string *err,
                                    unsigned int length,
                                    const std::string &base_dir,
                                    unsigned int check_sections) {
+  LoadStageScope stage(&LoadStageTimes::json_parse,
+                       LoadStageScope::Begin(&load_stage_times_));
+
   is_binary_ = false;
   bin_data_ = nullptr;
   bin_size_ = 0;
@@ -4413,6 +5349,9 @@ bool TinyGLTF::LoadASCIIFromString(Model *model, std::string *err,
 bool TinyGLTF::LoadASCIIFromFile(Model *model, std::string *err,
                                  std::string *warn, const std::string &filename,
                                  unsigned int check_sections) {
+  LoadStageScope stage(&LoadStageTimes::json_parse,
+                       LoadStageScope::Begin(&load_stage_times_));
+
   std::stringstream ss;
 
   if (fs.ReadWholeFile == nullptr) {
@@ -4425,9 +5364,39 @@ bool TinyGLTF::LoadASCIIFromFile(Model *model, std::string *err,
     return false;
   }
 
+  std::string basedir = GetBaseDir(filename);
+
+  if (fs.MapWholeFile) {
+    // The JSON text is only needed while parsing, so map it and let the
+    // mapping go when we return.
+    MappedFile file;
+    std::string fileerr;
+    bool filemapped;
+    {
+      LoadStageScope io(&LoadStageTimes::file_io);
+      filemapped = fs.MapWholeFile(&file, &fileerr, filename, fs.user_data);
+    }
+    if (!filemapped) {
+      ss << "Failed to map file: " << filename << ": " << fileerr << std::endl;
+      if (err) {
+        (*err) = ss.str();
+      }
+      return false;
+    }
+
+    return LoadASCIIFromString(model, err, warn,
+                               reinterpret_cast<const char *>(file.data),
+                               static_cast<unsigned int>(file.size), basedir,
+                               check_sections);
+  }
+
   std::vector<unsigned char> data;
   std::string fileerr;
-  bool fileread = fs.ReadWholeFile(&data, &fileerr, filename, fs.user_data);
+  bool fileread;
+  {
+    LoadStageScope io(&LoadStageTimes::file_io);
+    fileread = fs.ReadWholeFile(&data, &fileerr, filename, fs.user_data);
+  }
   if (!fileread) {
     ss << "Failed to read file: " << filename << ": " << fileerr << std::endl;
     if (err) {
@@ -4444,8 +5413,6 @@ bool TinyGLTF::LoadASCIIFromFile(Model *model, std::string *err,
     return false;
   }
 
-  std::string basedir = GetBaseDir(filename);
-
   bool ret = LoadASCIIFromString(
       model, err, warn, reinterpret_cast<const char *>(&data.at(0)),
       static_cast<unsigned int>(data.size()), basedir, check_sections);
@@ -4459,6 +5426,9 @@ bool TinyGLTF::LoadBinaryFromMemory(Model *model, std::string *err,
                                     unsigned int size,
                                     const std::string &base_dir,
                                     unsigned int check_sections) {
+  LoadStageScope stage(&LoadStageTimes::json_parse,
+                       LoadStageScope::Begin(&load_stage_times_));
+
   if (size < 20) {
     if (err) {
       (*err) = "Too short data size for glTF Binary.";
@@ -4526,6 +5496,9 @@ bool TinyGLTF::LoadBinaryFromFile(Model *model, std::string *err,
                                   std::string *warn,
                                   const std::string &filename,
                                   unsigned int check_sections) {
+  LoadStageScope stage(&LoadStageTimes::json_parse,
+                       LoadStageScope::Begin(&load_stage_times_));
+
   std::stringstream ss;
 
   if (fs.ReadWholeFile == nullptr) {
@@ -4538,9 +5511,39 @@ bool TinyGLTF::LoadBinaryFromFile(Model *model, std::string *err,
     return false;
   }
 
+  std::string basedir = GetBaseDir(filename);
+
+  if (fs.MapWholeFile) {
+    // Map the whole GLB and let the buffer of the BIN chunk point into it.
+    std::string fileerr;
+    bool filemapped;
+    {
+      LoadStageScope io(&LoadStageTimes::file_io);
+      filemapped = fs.MapWholeFile(&bin_file_, &fileerr, filename, fs.user_data);
+    }
+    if (!filemapped) {
+      ss << "Failed to map file: " << filename << ": " << fileerr << std::endl;
+      if (err) {
+        (*err) = ss.str();
+      }
+      return false;
+    }
+
+    bool ret = LoadBinaryFromMemory(model, err, warn, bin_file_.data,
+                                    static_cast<unsigned int>(bin_file_.size),
+                                    basedir, check_sections);
+    bin_file_ = MappedFile();
+
+    return ret;
+  }
+
   std::vector<unsigned char> data;
   std::string fileerr;
-  bool fileread = fs.ReadWholeFile(&data, &fileerr, filename, fs.user_data);
+  bool fileread;
+  {
+    LoadStageScope io(&LoadStageTimes::file_io);
+    fileread = fs.ReadWholeFile(&data, &fileerr, filename, fs.user_data);
+  }
   if (!fileread) {
     ss << "Failed to read file: " << filename << ": " << fileerr << std::endl;
     if (err) {
@@ -4549,8 +5552,6 @@ bool TinyGLTF::LoadBinaryFromFile(Model *model, std::string *err,
     return false;
   }
 
-  std::string basedir = GetBaseDir(filename);
-
   bool ret = LoadBinaryFromMemory(model, err, warn, &data.at(0),
                                   static_cast<unsigned int>(data.size()),
                                   basedir, check_sections);
@@ -4657,20 +5658,19 @@ static void SerializeValue(const std::string &key, const Value &value,
   if (ValueToJson(value, &ret)) obj[key] = ret;
 }
 
-static void SerializeGltfBufferData(const std::vector<unsigned char> &data,
-                                    json &o) {
+static void SerializeGltfBufferData(const Buffer &buffer, json &o) {
   std::string header = "data:application/octet-stream;base64,";
   std::string encodedData =
-      base64_encode(&data[0], static_cast<unsigned int>(data.size()));
+      base64_encode(buffer.Data(), static_cast<unsigned int>(buffer.Size()));
   SerializeStringProperty("uri", header + encodedData, o);
 }
 
-static bool SerializeGltfBufferData(const std::vector<unsigned char> &data,
+static bool SerializeGltfBufferData(const Buffer &buffer,
                                     const std::string &binFilename) {
   std::ofstream output(binFilename.c_str(), std::ofstream::binary);
   if (!output.is_open()) return false;
-  output.write(reinterpret_cast<const char *>(&data[0]),
-               std::streamsize(data.size()));
+  output.write(reinterpret_cast<const char *>(buffer.Data()),
+               std::streamsize(buffer.Size()));
   output.close();
   return true;
 }
@@ -4839,8 +5839,8 @@ static void SerializeGltfAsset(Asset &asset, json &o) {
 }
 
 static void SerializeGltfBuffer(Buffer &buffer, json &o) {
-  SerializeNumberProperty("byteLength", buffer.data.size(), o);
-  SerializeGltfBufferData(buffer.data, o);
+  SerializeNumberProperty("byteLength", buffer.Size(), o);
+  SerializeGltfBufferData(buffer, o);
 
   if (buffer.name.size()) SerializeStringProperty("name", buffer.name, o);
 
@@ -4852,8 +5852,8 @@ static void SerializeGltfBuffer(Buffer &buffer, json &o) {
 static bool SerializeGltfBuffer(Buffer &buffer, json &o,
                                 const std::string &binFilename,
                                 const std::string &binBaseFilename) {
-  if (!SerializeGltfBufferData(buffer.data, binFilename)) return false;
-  SerializeNumberProperty("byteLength", buffer.data.size(), o);
+  if (!SerializeGltfBufferData(buffer, binFilename)) return false;
+  SerializeNumberProperty("byteLength", buffer.Size(), o);
   SerializeStringProperty("uri", binBaseFilename, o);
 
   if (buffer.name.size()) SerializeStringProperty("name", buffer.name, o);